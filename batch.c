@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "defs.h"
+#include "helpers.h"
+#include "batch.h"
+#include "metrics.h"
+#include "pool.h"
+#include "snapshot.h"
+
+#define BATCH_POOL_HOUSES_PER_WORKER 4  // Hunts in flight per pool worker (--engine pool)
+
+// One batch worker thread (threads and des engines)
+struct BatchWorker {
+    struct BatchShared* shared;
+    pthread_t thread;
+    atomic_llong busy_ns;       // Time spent in finished hunts
+    atomic_llong busy_since;    // CLOCK_MONOTONIC ns the current hunt started, 0 between hunts
+};
+
+// Shared between the batch worker threads
+struct BatchShared {
+    const struct BatchConfig* config;
+    struct BatchStats* stats;
+    struct StepPool* pool;  // Only with --engine pool
+    struct BatchWorker* workers;    // Only with the threads and des engines
+    int next_run;       // Next run index to hand out
+    sem_t mutex;        // Protects next_run
+    long long start_ns; // CLOCK_MONOTONIC when the batch started
+    // totals so far, also read by the metrics thread while the batch runs
+    atomic_int hunts;
+    atomic_int won;
+    atomic_int exits[3];
+    atomic_llong steps;
+    atomic_int failed;      // Hunts that could not be set up; once set, no more runs are handed out
+    // metrics exporter (config->metrics_path)
+    pthread_t metrics_thread;
+    bool metrics_running;
+    sem_t metrics_stop;     // Posted to end the exporter
+};
+
+static long long batch_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @brief Hands out the next run index to a worker
+ *
+ * @param shared Pointer to the shared batch state
+ * @return Run index, or -1 when every run has been claimed or a hunt has failed
+ */
+static int batch_claim_run(struct BatchShared* shared) {
+    sem_wait(&shared->mutex);
+    int run = -1;
+    if (shared->next_run < shared->config->runs && atomic_load(&shared->failed) == 0) {
+        run = shared->next_run++;
+    }
+    sem_post(&shared->mutex);
+    return run;
+}
+
+/**
+ * @brief Sets up the house of one hunt with generated hunter names
+ *
+ * @param config Batch settings
+ * @param run Run index of this hunt
+ * @param house Pointer to the House to set up
+ * @return 0 on success, -1 if out of memory (the reason is printed and the house cleaned up)
+ */
+static int batch_setup_house(const struct BatchConfig* config, int run, struct House* house) {
+    house_init(house, config->map, config->first_run + run, config->seed);
+
+    char name_buffer[MAX_HUNTER_NAME];
+    for (int i = 0; i < config->hunter_count; i++) {
+        snprintf(name_buffer, sizeof(name_buffer), "hunter%d", i + 1);
+        if (!house_add_hunter(house, name_buffer, i + 1)) {
+            // a hunt with fewer hunters would still run, but not the one asked for
+            fprintf(stderr, "Out of memory adding hunter %d to run %d\n", i + 1, config->first_run + run);
+            house_cleanup(house);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Simulates a single hunt with generated hunter names
+ *
+ * @param config Batch settings
+ * @param run Run index of this hunt
+ * @param result Pointer to the HuntResult to fill in
+ * @return true if the hunt ran, false if it could not be set up or a fork branch could not be run (the reason is printed)
+ */
+static bool batch_simulate_one(const struct BatchConfig* config, int run, struct HuntResult* result) {
+    struct House house;
+    if (config->snapshot) {
+        // a branch: the snapshot's state with streams of its own (main checked the layout)
+        char error[256];
+        if (snapshot_restore(config->snapshot, config->map, config->seed, config->first_run + run, true,
+                             &house, error, sizeof(error)) != 0) {
+            fprintf(stderr, "Branch %d: %s\n", config->first_run + run, error);
+            return false;
+        }
+        if (house_resume_des(&house, config->snapshot) != 0) {
+            fprintf(stderr, "Branch %d: out of memory\n", config->first_run + run);
+            house_cleanup(&house);
+            return false;
+        }
+        house_get_result(&house, result);
+        house_cleanup(&house);
+        return true;
+    }
+    if (batch_setup_house(config, run, &house) != 0) {
+        return false;
+    }
+
+    if (config->engine == ENGINE_DES) {
+        house_run_des(&house);
+    } else {
+        house_run(&house);
+    }
+    house_get_result(&house, result);
+    house_cleanup(&house);
+    return true;
+}
+
+/**
+ * @brief Adds a finished hunt to the totals
+ *
+ * @param shared Pointer to the shared batch state
+ * @param run Run index of the hunt
+ * @param result Its HuntResult
+ */
+static void batch_record(struct BatchShared* shared, int run, const struct HuntResult* result) {
+    // every run owns its own slot, so no lock needed here
+    shared->stats->lengths[run] = result->length;
+    if (result->won) {
+        atomic_fetch_add_explicit(&shared->won, 1, memory_order_relaxed);
+    }
+    for (int i = 0; i < 3; i++) {
+        atomic_fetch_add_explicit(&shared->exits[i], result->exits[i], memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&shared->steps, result->steps, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shared->hunts, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief The thread function for a batch worker. Keeps claiming and simulating hunts until none are left
+ *
+ * @param arg Void pointer to the worker's BatchWorker
+ * @return NULL after every run has been claimed
+ */
+static void* batch_worker(void* arg) {
+    struct BatchWorker* worker = (struct BatchWorker*)arg;
+    struct BatchShared* shared = worker->shared;
+
+    int run;
+    while ((run = batch_claim_run(shared)) != -1) {
+        long long start = batch_now_ns();
+        atomic_store_explicit(&worker->busy_since, start, memory_order_relaxed);
+
+        struct HuntResult result;
+        bool ran = batch_simulate_one(shared->config, run, &result);
+
+        atomic_fetch_add_explicit(&worker->busy_ns, batch_now_ns() - start, memory_order_relaxed);
+        atomic_store_explicit(&worker->busy_since, 0, memory_order_relaxed);
+        if (ran) {
+            batch_record(shared, run, &result);
+        } else {
+            atomic_fetch_add_explicit(&shared->failed, 1, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Takes a MetricsSample of the totals so far
+ *
+ * @param shared Pointer to the shared batch state
+ * @param sample Sample to fill in; its busy_seconds must hold config->jobs entries
+ * @param finished Whether the batch is over
+ */
+static void batch_metrics_sample(struct BatchShared* shared, struct MetricsSample* sample, bool finished) {
+    long long now = batch_now_ns();
+    long long elapsed = now - shared->start_ns;
+    sample->elapsed_seconds = elapsed / 1e9;
+    sample->runs = shared->config->runs;
+    sample->hunts = atomic_load_explicit(&shared->hunts, memory_order_relaxed);
+    sample->won = atomic_load_explicit(&shared->won, memory_order_relaxed);
+    for (int i = 0; i < 3; i++) {
+        sample->exits[i] = atomic_load_explicit(&shared->exits[i], memory_order_relaxed);
+    }
+    sample->steps = atomic_load_explicit(&shared->steps, memory_order_relaxed);
+
+    struct LogQueueStats queue;
+    log_get_queue_stats(&queue);
+    sample->log_events = queue.pushed;
+    sample->log_dropped = queue.dropped;
+
+    sample->worker_count = shared->config->jobs;
+    for (int i = 0; i < sample->worker_count; i++) {
+        long long busy;
+        if (shared->pool) {
+            busy = elapsed - step_pool_idle_ns(shared->pool, i);
+        } else {
+            struct BatchWorker* worker = &shared->workers[i];
+            busy = atomic_load_explicit(&worker->busy_ns, memory_order_relaxed);
+            long long since = atomic_load_explicit(&worker->busy_since, memory_order_relaxed);
+            if (since != 0 && now > since) {
+                busy += now - since;
+            }
+        }
+        sample->busy_seconds[i] = busy > 0 ? busy / 1e9 : 0.0;
+    }
+    sample->finished = finished;
+}
+
+/**
+ * @brief The thread function of the metrics exporter. Rewrites the metrics file every interval,
+ * and once more when told to stop
+ *
+ * @param arg Void pointer to the BatchShared struct
+ * @return NULL once stopped
+ */
+static void* batch_metrics_thread(void* arg) {
+    struct BatchShared* shared = (struct BatchShared*)arg;
+    const struct BatchConfig* config = shared->config;
+    struct MetricsSample samples[2];
+    samples[0].busy_seconds = calloc(config->jobs, sizeof(double));
+    samples[1].busy_seconds = calloc(config->jobs, sizeof(double));
+    struct MetricsSample* previous = NULL;
+    struct MetricsSample* current = &samples[0];
+    bool warned = false;
+
+    bool stopping = false;
+    while (!stopping && samples[0].busy_seconds && samples[1].busy_seconds) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        long long interval_ns = (long long)(config->metrics_interval * 1e9);
+        deadline.tv_sec += interval_ns / 1000000000LL;
+        deadline.tv_nsec += interval_ns % 1000000000LL;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        int waited;
+        while ((waited = sem_timedwait(&shared->metrics_stop, &deadline)) != 0 && errno == EINTR) {
+            // interrupted by a signal, keep waiting for the same deadline
+        }
+        stopping = (waited == 0);
+
+        batch_metrics_sample(shared, current, stopping);
+        if (metrics_write(config->metrics_path, current, previous) != 0 && !warned) {
+            fprintf(stderr, "Could not write the metrics file %s\n", config->metrics_path);
+            warned = true;
+        }
+        previous = current;
+        current = (current == &samples[0]) ? &samples[1] : &samples[0];
+    }
+    free(samples[0].busy_seconds);
+    free(samples[1].busy_seconds);
+    return NULL;
+}
+
+/**
+ * @brief Starts the metrics exporter if the batch asks for one (a failure only costs the metrics)
+ *
+ * @param shared Pointer to the shared batch state, with its workers or pool in place
+ */
+static void batch_metrics_start(struct BatchShared* shared) {
+    shared->metrics_running = false;
+    if (!shared->config->metrics_path) {
+        return;
+    }
+    sem_init(&shared->metrics_stop, 0, 0);
+    if (pthread_create(&shared->metrics_thread, NULL, batch_metrics_thread, shared) != 0) {
+        fprintf(stderr, "Could not start the metrics exporter\n");
+        sem_destroy(&shared->metrics_stop);
+        return;
+    }
+    shared->metrics_running = true;
+}
+
+/**
+ * @brief Stops the metrics exporter after it has written the final sample
+ *
+ * @param shared Pointer to the shared batch state, workers or pool still in place
+ */
+static void batch_metrics_stop(struct BatchShared* shared) {
+    if (!shared->metrics_running) {
+        return;
+    }
+    sem_post(&shared->metrics_stop);
+    pthread_join(shared->metrics_thread, NULL);
+    sem_destroy(&shared->metrics_stop);
+    shared->metrics_running = false;
+}
+
+/**
+ * @brief Starts the next unclaimed hunt on the step pool, if any are left. A hunt that cannot be
+ * started fails the batch: no more runs are claimed and the hunts in flight drain the pool
+ *
+ * @param shared Pointer to the shared batch state
+ */
+static void batch_pool_start_next(struct BatchShared* shared) {
+    int run = batch_claim_run(shared);
+    if (run == -1) {
+        return;
+    }
+    struct House* house = malloc(sizeof(struct House));
+    if (!house) {
+        fprintf(stderr, "Out of memory starting run %d\n", shared->config->first_run + run);
+        atomic_fetch_add(&shared->failed, 1);
+        return;
+    }
+    if (batch_setup_house(shared->config, run, house) != 0) {
+        free(house);
+        atomic_fetch_add(&shared->failed, 1);
+        return;
+    }
+    if (step_pool_add(shared->pool, house) != 0) {
+        fprintf(stderr, "Out of memory adding run %d to the step pool\n", shared->config->first_run + run);
+        house_cleanup(house);
+        free(house);
+        atomic_fetch_add(&shared->failed, 1);
+    }
+}
+
+/**
+ * @brief Step pool callback: records a finished hunt and starts the next one in its place
+ *
+ * @param house Pointer to the finished House (freed here)
+ * @param context Void pointer to the BatchShared struct
+ */
+static void batch_pool_done(struct House* house, void* context) {
+    struct BatchShared* shared = (struct BatchShared*)context;
+    struct HuntResult result;
+    house_get_result(house, &result);
+    int run = house->run_id - shared->config->first_run;
+    house_cleanup(house);
+    free(house);
+
+    batch_record(shared, run, &result);
+    batch_pool_start_next(shared);
+}
+
+/**
+ * @brief Runs the batch on a step pool of config->jobs workers, a few hunts per worker at a time
+ *
+ * @param shared Pointer to the shared batch state
+ * @return 0 on success, -1 if the pool could not be started
+ */
+static int batch_run_pool(struct BatchShared* shared) {
+    struct StepPool pool;
+    if (step_pool_start(&pool, shared->config->jobs, batch_pool_done, shared) != 0) {
+        return -1;
+    }
+    shared->pool = &pool;
+    batch_metrics_start(shared);
+    for (int i = 0; i < shared->config->jobs * BATCH_POOL_HOUSES_PER_WORKER; i++) {
+        batch_pool_start_next(shared);
+    }
+    step_pool_wait(&pool);
+    batch_metrics_stop(shared);
+    step_pool_stop(&pool);
+    shared->pool = NULL;
+    return 0;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+int batch_run(const struct BatchConfig* config, struct BatchStats* stats) {
+    stats->runs = config->runs;
+    stats->won = 0;
+    for (int i = 0; i < 3; i++) {
+        stats->exits[i] = 0;
+    }
+    stats->steps = 0;
+    stats->wall_seconds = 0.0;
+    stats->lengths = calloc(config->runs > 0 ? config->runs : 1, sizeof(int));
+    if (!stats->lengths) {
+        return -1;
+    }
+
+    struct BatchShared shared;
+    shared.config = config;
+    shared.stats = stats;
+    shared.pool = NULL;
+    shared.workers = NULL;
+    shared.next_run = 0;
+    sem_init(&shared.mutex, 0, 1);
+    atomic_init(&shared.hunts, 0);
+    atomic_init(&shared.won, 0);
+    for (int i = 0; i < 3; i++) {
+        atomic_init(&shared.exits[i], 0);
+    }
+    atomic_init(&shared.steps, 0);
+    atomic_init(&shared.failed, 0);
+    shared.metrics_running = false;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    shared.start_ns = (long long)start.tv_sec * 1000000000LL + start.tv_nsec;
+
+    if (config->engine == ENGINE_POOL) {
+        if (batch_run_pool(&shared) != 0) {
+            sem_destroy(&shared.mutex);
+            batch_stats_free(stats);
+            return -1;
+        }
+    } else {
+        struct BatchWorker* workers = malloc(sizeof(struct BatchWorker) * config->jobs);
+        if (!workers) {
+            sem_destroy(&shared.mutex);
+            batch_stats_free(stats);
+            return -1;
+        }
+        for (int i = 0; i < config->jobs; i++) {
+            workers[i].shared = &shared;
+            atomic_init(&workers[i].busy_ns, 0);
+            atomic_init(&workers[i].busy_since, 0);
+        }
+        shared.workers = workers;
+        batch_metrics_start(&shared);
+        for (int i = 0; i < config->jobs; i++) {
+            pthread_create(&workers[i].thread, NULL, batch_worker, &workers[i]);
+        }
+        for (int i = 0; i < config->jobs; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        batch_metrics_stop(&shared);
+        shared.workers = NULL;
+        free(workers);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->wall_seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    sem_destroy(&shared.mutex);
+
+    // a hunt that never ran would leave a hole in the totals
+    int failed = atomic_load(&shared.failed);
+    if (failed > 0) {
+        fprintf(stderr, "%d of %d hunts could not be set up; the batch was stopped\n", failed, config->runs);
+        batch_stats_free(stats);
+        return -1;
+    }
+
+    stats->won = atomic_load(&shared.won);
+    for (int i = 0; i < 3; i++) {
+        stats->exits[i] = atomic_load(&shared.exits[i]);
+    }
+    stats->steps = atomic_load(&shared.steps);
+    qsort(stats->lengths, stats->runs, sizeof(int), compare_ints);
+    return 0;
+}
+
+/**
+ * @brief Name of an engine as given to --engine
+ *
+ * @param engine The SimEngine
+ * @return Static string such as "des"
+ */
+static const char* batch_engine_name(enum SimEngine engine) {
+    switch (engine) {
+        case ENGINE_DES: return "des";
+        case ENGINE_POOL: return "pool";
+        default: return "threads";
+    }
+}
+
+/**
+ * @brief Nearest-rank percentile of the sorted hunt lengths
+ *
+ * @param stats Pointer to the batch totals (lengths already sorted)
+ * @param percent Percentile between 0 and 100
+ * @return Hunt length at that percentile
+ */
+static int batch_percentile(const struct BatchStats* stats, int percent) {
+    int index = (stats->runs * percent + 99) / 100 - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    if (index >= stats->runs) {
+        index = stats->runs - 1;
+    }
+    return stats->lengths[index];
+}
+
+void batch_print_report(const struct BatchConfig* config, const struct BatchStats* stats) {
+    printf("\n--- Batch Results ---\n");
+    printf("Runs: %d (jobs=%d, hunters=%d, engine=%s)\n",
+           stats->runs,
+           config->jobs,
+           config->hunter_count,
+           batch_engine_name(config->engine));
+    printf("Seed: %llu (runs %d to %d)\n",
+           (unsigned long long)config->seed,
+           config->first_run,
+           config->first_run + stats->runs - 1);
+    if (stats->runs == 0) {
+        return;
+    }
+
+    printf("Won: %d  Failed: %d  Win rate: %.2f%%\n",
+           stats->won,
+           stats->runs - stats->won,
+           100.0 * stats->won / stats->runs);
+
+    int total_exits = stats->exits[LR_EVIDENCE] + stats->exits[LR_BORED] + stats->exits[LR_AFRAID];
+    printf("Hunter exits:");
+    for (int i = 0; i < 3; i++) {
+        printf(" %s=%d (%.1f%%)",
+               exit_reason_to_string((enum LogReason)i),
+               stats->exits[i],
+               total_exits ? 100.0 * stats->exits[i] / total_exits : 0.0);
+    }
+    printf("\n");
+
+    long long sum = 0;
+    for (int i = 0; i < stats->runs; i++) {
+        sum += stats->lengths[i];
+    }
+    int min = stats->lengths[0];
+    int max = stats->lengths[stats->runs - 1];
+    printf("Hunt length (hunter steps): min=%d mean=%.1f p50=%d p90=%d p99=%d max=%d\n",
+           min,
+           (double)sum / stats->runs,
+           batch_percentile(stats, 50),
+           batch_percentile(stats, 90),
+           batch_percentile(stats, 99),
+           max);
+
+    // fixed width buckets between min and max
+    const int buckets = 10;
+    int width = (max - min) / buckets + 1;
+    int counts[10] = {0};
+    for (int i = 0; i < stats->runs; i++) {
+        counts[(stats->lengths[i] - min) / width]++;
+    }
+    for (int b = 0; b < buckets; b++) {
+        if (counts[b] == 0) {
+            continue;
+        }
+        printf("  [%5d, %5d) %6d\n", min + b * width, min + (b + 1) * width, counts[b]);
+    }
+
+    printf("Wall time: %.2fs (%.1f hunts/s, %lld steps, %.0f steps/s)\n",
+           stats->wall_seconds,
+           stats->wall_seconds > 0 ? stats->runs / stats->wall_seconds : 0.0,
+           stats->steps,
+           stats->wall_seconds > 0 ? stats->steps / stats->wall_seconds : 0.0);
+}
+
+int batch_take_snapshot(const struct BatchConfig* config, const struct SnapshotTrigger* trigger, struct HuntSnapshot* snapshot) {
+    struct House house;
+    if (batch_setup_house(config, 0, &house) != 0) {
+        return -1;
+    }
+    int status = house_run_des_until(&house, trigger, snapshot);
+    if (status == 1) {
+        snapshot_print(stdout, snapshot, &house);
+    }
+    house_cleanup(&house);
+    return status;
+}
+
+void batch_stats_free(struct BatchStats* stats) {
+    free(stats->lengths);
+    stats->lengths = NULL;
+}
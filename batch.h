@@ -0,0 +1,65 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "defs.h"
+
+#define BATCH_DEFAULT_HUNTERS 4
+
+struct HuntSnapshot;
+struct SnapshotTrigger;
+
+// Settings for a headless batch of hunts (see main.c for the command line flags)
+struct BatchConfig {
+    int runs;           // Number of independent hunts to simulate
+    int jobs;           // Number of hunts simulated at the same time
+    int hunter_count;   // Hunters per hunt
+    enum SimEngine engine;
+    const struct HouseMap* map; // Layout of every house, NULL for the built-in Willow layout
+    int first_run;      // Index of the first run, so a sweep can be split across processes
+    uint64_t seed;      // Master seed; run r of the batch is fixed by (seed, first_run + r)
+    const char* metrics_path;   // Prometheus text file rewritten while the batch runs, NULL for none (see metrics.h)
+    double metrics_interval;    // Seconds between rewrites
+    const struct HuntSnapshot* snapshot;    // Fork every run from this snapshot (des engine only), NULL for fresh hunts
+};
+
+// Totals over every hunt in a batch
+struct BatchStats {
+    int runs;
+    int won;
+    int exits[3];       // Hunter exits indexed by LogReason
+    int* lengths;       // Hunt length of every run, sorted once the batch is done
+    long long steps;    // Turns taken by every hunter and ghost of every run
+    double wall_seconds;
+};
+
+/**
+ * @brief Runs a whole batch of hunts across the worker threads and gathers the totals.
+ * @param[in] config Batch settings.
+ * @param[out] stats Totals; lengths is heap allocated and released by batch_stats_free().
+ * @return 0 on success, -1 if the batch could not be started or one of its hunts could not be set up.
+ */
+int batch_run(const struct BatchConfig* config, struct BatchStats* stats);
+
+/**
+ * @brief Print the win rate, exit reasons and hunt length distribution of a batch.
+ * @param[in] config Batch settings used for the run.
+ * @param[in] stats Totals returned by batch_run().
+ */
+void batch_print_report(const struct BatchConfig* config, const struct BatchStats* stats);
+
+/**
+ * @brief Release memory owned by the stats.
+ * @param[in,out] stats Totals returned by batch_run().
+ */
+void batch_stats_free(struct BatchStats* stats);
+
+/**
+ * @brief Run the first hunt of a batch on the des engine up to a trigger and snapshot it.
+ * @param[in] config Batch settings; the hunt is run config->first_run of the seeded sweep.
+ * @param[in] trigger When to take the snapshot.
+ * @param[out] snapshot Filled when the trigger fired; release it with snapshot_free().
+ * @return 1 if the snapshot was taken (and printed), 0 if the hunt ended first, -1 on error.
+ */
+int batch_take_snapshot(const struct BatchConfig* config, const struct SnapshotTrigger* trigger, struct HuntSnapshot* snapshot);
+
+#endif // BATCH_H
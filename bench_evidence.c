@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "defs.h"
+
+/*
+    Contention benchmark for the per-room evidence byte.
+
+    Every thread plays ghost and hunter in turn on the same few rooms: it drops its own
+    evidence bit (ghost haunt) and then tries to collect it again (hunter pickup). The
+    "semaphore" variant does both under the room's sem_t like hunter.c/ghost.c used to,
+    the "atomic" variant uses atomic_fetch_or/atomic_fetch_and like they do now.
+
+    Usage: ./bench_evidence [--ops N] [--rooms R] [--threads T]...
+           (default: 2000000 ops per thread, 1 room, 1 2 4 8 threads)
+*/
+
+#define BENCH_MAX_THREADS 64
+
+// One room per cache line so only real sharing is measured
+struct SemRoom {
+    sem_t mutex;
+    EvidenceByte evidence;
+} __attribute__((aligned(64)));
+
+struct AtomicRoom {
+    _Atomic EvidenceByte evidence;
+} __attribute__((aligned(64)));
+
+struct BenchShared {
+    bool use_atomic;
+    int room_count;
+    long ops;
+    struct SemRoom* sem_rooms;
+    struct AtomicRoom* atomic_rooms;
+    pthread_barrier_t start;
+};
+
+struct BenchWorker {
+    struct BenchShared* shared;
+    EvidenceByte device;
+    long collected;     // Pickups that found the bit still set
+    pthread_t thread;
+};
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void* bench_worker(void* arg) {
+    struct BenchWorker* worker = (struct BenchWorker*)arg;
+    struct BenchShared* shared = worker->shared;
+    EvidenceByte device = worker->device;
+    long collected = 0;
+
+    pthread_barrier_wait(&shared->start);
+    for (long i = 0; i < shared->ops; i++) {
+        int r = (int)(i % shared->room_count);
+        if (shared->use_atomic) {
+            struct AtomicRoom* room = &shared->atomic_rooms[r];
+            atomic_fetch_or_explicit(&room->evidence, device, memory_order_relaxed);
+            EvidenceByte found = atomic_fetch_and_explicit(&room->evidence, (EvidenceByte)~device, memory_order_relaxed);
+            collected += (found & device) != 0;
+        } else {
+            struct SemRoom* room = &shared->sem_rooms[r];
+            sem_wait(&room->mutex);
+            room->evidence |= device;
+            sem_post(&room->mutex);
+
+            sem_wait(&room->mutex);
+            if (room->evidence & device) {
+                room->evidence &= ~device;
+                collected++;
+            }
+            sem_post(&room->mutex);
+        }
+    }
+    worker->collected = collected;
+    return NULL;
+}
+
+/**
+ * @brief Runs one variant at one thread count and prints a result line
+ *
+ * @param use_atomic true for the atomic variant, false for the semaphore one
+ * @param threads Number of threads hammering the rooms
+ * @param room_count Number of rooms shared by the threads
+ * @param ops Drop + pickup pairs per thread
+ */
+static void bench_run(bool use_atomic, int threads, int room_count, long ops) {
+    struct BenchShared shared;
+    shared.use_atomic = use_atomic;
+    shared.room_count = room_count;
+    shared.ops = ops;
+    shared.sem_rooms = aligned_alloc(64, sizeof(struct SemRoom) * room_count);
+    shared.atomic_rooms = aligned_alloc(64, sizeof(struct AtomicRoom) * room_count);
+    for (int r = 0; r < room_count; r++) {
+        sem_init(&shared.sem_rooms[r].mutex, 0, 1);
+        shared.sem_rooms[r].evidence = 0;
+        atomic_init(&shared.atomic_rooms[r].evidence, 0);
+    }
+    pthread_barrier_init(&shared.start, NULL, threads + 1);
+
+    struct BenchWorker workers[BENCH_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        workers[t].shared = &shared;
+        workers[t].device = (EvidenceByte)(1 << (t % 7));
+        pthread_create(&workers[t].thread, NULL, bench_worker, &workers[t]);
+    }
+
+    pthread_barrier_wait(&shared.start);
+    double start = now_seconds();
+    long collected = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        collected += workers[t].collected;
+    }
+    double seconds = now_seconds() - start;
+
+    double total = 2.0 * (double)ops * threads;   // a drop and a pickup per iteration
+    printf("%-10s %7d %6d %12.2f %10.1f %11.1f%%\n",
+           use_atomic ? "atomic" : "semaphore",
+           threads,
+           room_count,
+           total / seconds / 1e6,
+           seconds * 1e9 / total * threads,
+           100.0 * (double)collected / ((double)ops * threads));
+
+    pthread_barrier_destroy(&shared.start);
+    for (int r = 0; r < room_count; r++) {
+        sem_destroy(&shared.sem_rooms[r].mutex);
+    }
+    free(shared.sem_rooms);
+    free(shared.atomic_rooms);
+}
+
+int main(int argc, char* argv[]) {
+    long ops = 2000000;
+    int room_count = 1;
+    int thread_counts[BENCH_MAX_THREADS];
+    int thread_runs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--ops") == 0 && has_value) {
+            ops = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rooms") == 0 && has_value) {
+            room_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value && thread_runs < BENCH_MAX_THREADS) {
+            thread_counts[thread_runs++] = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [--ops N] [--rooms R] [--threads T]...\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (ops <= 0 || room_count <= 0) {
+        fprintf(stderr, "--ops and --rooms must be positive\n");
+        return 1;
+    }
+    if (thread_runs == 0) {
+        int defaults[] = {1, 2, 4, 8};
+        for (int i = 0; i < 4; i++) {
+            thread_counts[thread_runs++] = defaults[i];
+        }
+    }
+    for (int i = 0; i < thread_runs; i++) {
+        if (thread_counts[i] < 1 || thread_counts[i] > BENCH_MAX_THREADS) {
+            fprintf(stderr, "--threads must be 1 to %d\n", BENCH_MAX_THREADS);
+            return 1;
+        }
+    }
+
+    printf("%-10s %7s %6s %12s %10s %12s\n", "variant", "threads", "rooms", "Mops/s", "ns/op", "collected");
+    for (int i = 0; i < thread_runs; i++) {
+        bench_run(false, thread_counts[i], room_count, ops);
+        bench_run(true, thread_counts[i], room_count, ops);
+    }
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "lock.h"
+
+/*
+    Lock backend comparison under hunter-like contention.
+
+    Every thread acts as a hunter: it picks a room at random, takes the room lock, does a
+    little work inside (the occupancy/ghost checks) and a little more outside it, again and
+    again. All five backends of lock.h are measured in the same binary, whatever LOCK the
+    simulation was built with. Reports acquisitions per second and the time spent waiting
+    for the lock (p50/p99/p99.9/max).
+
+    Usage: ./bench_locks [--ops N] [--rooms R] [--threads T]... [--backend NAME]...
+           (default: 20000 acquisitions per thread, 13 rooms, 4 16 64 256 threads, every backend)
+*/
+
+#define BENCH_MAX_THREADS 1024
+#define BENCH_MAX_RUNS 16
+#define BENCH_WORK_INSIDE 20     // Spin iterations while holding the lock
+#define BENCH_WORK_OUTSIDE 200   // Spin iterations between acquisitions
+
+// Storage for any backend, one lock per cache line
+union BenchLock {
+    struct SemLock sem;
+    struct MutexLock mutex;
+    struct TicketLock ticket;
+    struct TtasLock ttas;
+    struct FutexLock futex;
+    char pad[64];
+} __attribute__((aligned(64)));
+
+struct BenchBackend {
+    const char* name;
+    void (*init)(void*);
+    void (*acquire)(void*);
+    void (*release)(void*);
+    void (*destroy)(void*);
+};
+
+#define BENCH_BACKEND(name, prefix) \
+    {name, (void (*)(void*))prefix##_init, (void (*)(void*))prefix##_acquire, \
+     (void (*)(void*))prefix##_release, (void (*)(void*))prefix##_destroy}
+
+static const struct BenchBackend backends[] = {
+    BENCH_BACKEND("sem", sem_lock),
+    BENCH_BACKEND("mutex", mutex_lock),
+    BENCH_BACKEND("ticket", ticket_lock),
+    BENCH_BACKEND("ttas", ttas_lock),
+    BENCH_BACKEND("futex", futex_lock),
+};
+#define BENCH_BACKEND_COUNT (int)(sizeof(backends) / sizeof(backends[0]))
+
+struct BenchShared {
+    const struct BenchBackend* backend;
+    union BenchLock* locks;
+    long* visits;           // Per room, only touched under the room lock
+    int room_count;
+    long ops;
+    pthread_barrier_t start;
+};
+
+struct BenchWorker {
+    struct BenchShared* shared;
+    uint32_t* waits;        // Nanoseconds spent in acquire, one per acquisition
+    uint64_t seed;
+    pthread_t thread;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void spin_work(int iterations) {
+    for (volatile int i = 0; i < iterations; i++) {
+    }
+}
+
+static void* bench_worker(void* arg) {
+    struct BenchWorker* worker = (struct BenchWorker*)arg;
+    struct BenchShared* shared = worker->shared;
+    const struct BenchBackend* backend = shared->backend;
+    uint64_t state = worker->seed;
+
+    pthread_barrier_wait(&shared->start);
+    for (long i = 0; i < shared->ops; i++) {
+        // xorshift64, cheap enough not to show up next to the lock
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int room = (int)(state % (uint64_t)shared->room_count);
+
+        uint64_t before = now_ns();
+        backend->acquire(&shared->locks[room]);
+        uint64_t waited = now_ns() - before;
+        shared->visits[room]++;
+        spin_work(BENCH_WORK_INSIDE);
+        backend->release(&shared->locks[room]);
+
+        worker->waits[i] = waited > UINT32_MAX ? UINT32_MAX : (uint32_t)waited;
+        spin_work(BENCH_WORK_OUTSIDE);
+    }
+    return NULL;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Runs one backend at one thread count and prints a result line
+ *
+ * @param backend Backend to measure
+ * @param threads Number of hunter threads
+ * @param room_count Number of rooms (locks) they share
+ * @param ops Acquisitions per thread
+ * @return 0 on success, -1 if out of memory or the locks let two threads in at once
+ */
+static int bench_run(const struct BenchBackend* backend, int threads, int room_count, long ops) {
+    struct BenchShared shared;
+    shared.backend = backend;
+    shared.room_count = room_count;
+    shared.ops = ops;
+    shared.locks = aligned_alloc(64, sizeof(union BenchLock) * room_count);
+    shared.visits = calloc(room_count, sizeof(long));
+    uint32_t* waits = malloc(sizeof(uint32_t) * ops * threads);
+    struct BenchWorker* workers = malloc(sizeof(struct BenchWorker) * threads);
+    if (!shared.locks || !shared.visits || !waits || !workers) {
+        free(shared.locks);
+        free(shared.visits);
+        free(waits);
+        free(workers);
+        return -1;
+    }
+    for (int r = 0; r < room_count; r++) {
+        backend->init(&shared.locks[r]);
+    }
+    pthread_barrier_init(&shared.start, NULL, threads + 1);
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].shared = &shared;
+        workers[t].waits = waits + (long)t * ops;
+        workers[t].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(t + 1);
+        pthread_create(&workers[t].thread, NULL, bench_worker, &workers[t]);
+    }
+
+    pthread_barrier_wait(&shared.start);
+    uint64_t start = now_ns();
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    double seconds = (double)(now_ns() - start) / 1e9;
+
+    // a lost update means the lock let two threads in at once
+    long visits = 0;
+    for (int r = 0; r < room_count; r++) {
+        visits += shared.visits[r];
+        backend->destroy(&shared.locks[r]);
+    }
+    long total = ops * threads;
+
+    qsort(waits, total, sizeof(uint32_t), compare_u32);
+    printf("%-8s %7d %6d %10.3f %9u %9u %9u %11u%s\n",
+           backend->name,
+           threads,
+           room_count,
+           (double)total / seconds / 1e6,
+           waits[total / 2],
+           waits[total * 99 / 100],
+           waits[total * 999 / 1000],
+           waits[total - 1],
+           visits == total ? "" : "  MUTUAL EXCLUSION BROKEN");
+    fflush(stdout);
+
+    pthread_barrier_destroy(&shared.start);
+    free(shared.locks);
+    free(shared.visits);
+    free(waits);
+    free(workers);
+    return visits == total ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    long ops = 20000;
+    int room_count = 13;
+    int thread_counts[BENCH_MAX_RUNS];
+    int thread_runs = 0;
+    const struct BenchBackend* selected[BENCH_BACKEND_COUNT];
+    int selected_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--ops") == 0 && has_value) {
+            ops = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rooms") == 0 && has_value) {
+            room_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value && thread_runs < BENCH_MAX_RUNS) {
+            thread_counts[thread_runs++] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--backend") == 0 && has_value && selected_count < BENCH_BACKEND_COUNT) {
+            const char* name = argv[++i];
+            int b = 0;
+            while (b < BENCH_BACKEND_COUNT && strcmp(backends[b].name, name) != 0) {
+                b++;
+            }
+            if (b == BENCH_BACKEND_COUNT) {
+                fprintf(stderr, "Unknown backend: %s (sem, mutex, ticket, ttas or futex)\n", name);
+                return 1;
+            }
+            selected[selected_count++] = &backends[b];
+        } else {
+            printf("Usage: %s [--ops N] [--rooms R] [--threads T]... [--backend NAME]...\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (ops <= 0 || room_count <= 0) {
+        fprintf(stderr, "--ops and --rooms must be positive\n");
+        return 1;
+    }
+    if (thread_runs == 0) {
+        int defaults[] = {4, 16, 64, 256};
+        for (int i = 0; i < 4; i++) {
+            thread_counts[thread_runs++] = defaults[i];
+        }
+    }
+    for (int i = 0; i < thread_runs; i++) {
+        if (thread_counts[i] < 1 || thread_counts[i] > BENCH_MAX_THREADS) {
+            fprintf(stderr, "--threads must be 1 to %d\n", BENCH_MAX_THREADS);
+            return 1;
+        }
+    }
+    if (selected_count == 0) {
+        for (int b = 0; b < BENCH_BACKEND_COUNT; b++) {
+            selected[selected_count++] = &backends[b];
+        }
+    }
+
+    printf("Simulation built with LOCK=%s\n", LOCK_BACKEND_NAME);
+    printf("%-8s %7s %6s %10s %9s %9s %9s %11s\n",
+           "backend", "threads", "rooms", "Macq/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    int status = 0;
+    for (int i = 0; i < thread_runs; i++) {
+        for (int b = 0; b < selected_count; b++) {
+            if (bench_run(selected[b], thread_counts[i], room_count, ops) != 0) {
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
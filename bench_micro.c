@@ -0,0 +1,432 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ftw.h>
+#include <pthread.h>
+#include "defs.h"
+#include "helpers.h"
+
+/*
+    Microbenchmarks for the primitives the hunter and ghost loops spend their time in.
+
+    Every benchmark calls its primitive `batch` times between two clock reads (one call is far
+    shorter than a clock read), first `warmup` times untimed and then `samples` times timed, and
+    reports the per-call time of the samples: min, p50, p90, p99, max and mean, in ns. Each
+    benchmark runs on a fresh thread so thread-local state (random stream, cached log writer)
+    starts the same way every time.
+
+    The log_* benchmarks write real binary logs into a scratch directory with a queue large
+    enough never to block, so they measure what the caller pays (stamp + queue push). They use a
+    fifth of the batch so a benchmark fits in that queue and below the per log file event cap of
+    helpers.c (every benchmark reopens the file, so each gets the whole cap).
+
+    Usage: ./bench_micro [--batch N] [--samples S] [--warmup W] [--filter TEXT] [--out FILE]
+           (default: 1000 calls per sample, 200 samples, 20 warmup batches, bench_micro.json)
+*/
+
+#define MICRO_LOG_CALL_LIMIT 90000  // Log calls per benchmark: the queue size, below LOG_EVENT_CAP
+
+// Everything the benchmarks work on, set up once
+struct MicroContext {
+    struct House house;
+    struct Hunter* hunter;
+    struct Room* rooms[2];      // The van and its first neighbour
+    struct PathStack stack;
+    struct RandStream stream;
+    unsigned mask;              // Cycles through every evidence mask
+    volatile int sink;          // Keeps results alive
+};
+
+typedef void (*MicroFunction)(struct MicroContext* context, int calls);
+
+struct MicroBench {
+    const char* name;
+    MicroFunction function;
+    bool logs;                  // Calls a log_* helper (smaller batches, see above)
+};
+
+struct MicroResult {
+    int calls;                  // Calls per sample
+    int samples;
+    double min, p50, p90, p99, max, mean;   // ns per call
+};
+
+// ---- benchmarks ----
+static void micro_rand_int_threadsafe(struct MicroContext* context, int calls) {
+    int sum = 0;
+    for (int i = 0; i < calls; i++) {
+        sum += rand_int_threadsafe(0, 100);
+    }
+    context->sink = sum;
+}
+
+static void micro_rand_stream_int(struct MicroContext* context, int calls) {
+    int sum = 0;
+    for (int i = 0; i < calls; i++) {
+        sum += rand_stream_int(&context->stream, 0, 100);
+    }
+    context->sink = sum;
+}
+
+static void micro_evidence_is_valid_ghost(struct MicroContext* context, int calls) {
+    int sum = 0;
+    unsigned mask = context->mask;
+    for (int i = 0; i < calls; i++) {
+        sum += evidence_is_valid_ghost((EvidenceByte)(mask++ & 127));
+    }
+    context->mask = mask;
+    context->sink = sum;
+}
+
+static void micro_evidence_has_three_unique(struct MicroContext* context, int calls) {
+    int sum = 0;
+    unsigned mask = context->mask;
+    for (int i = 0; i < calls; i++) {
+        sum += evidence_has_three_unique((EvidenceByte)(mask++ & 127));
+    }
+    context->mask = mask;
+    context->sink = sum;
+}
+
+static void micro_stack_push_pop(struct MicroContext* context, int calls) {
+    struct Room* room = NULL;
+    for (int i = 0; i < calls; i++) {
+        stack_push(&context->stack, context->rooms[i & 1]);
+        room = stack_pop(&context->stack, &context->house);
+    }
+    context->sink = room ? room->id : -1;
+}
+
+static void micro_room_add_remove_hunter(struct MicroContext* context, int calls) {
+    struct Room* room = context->hunter->room;
+    for (int i = 0; i < calls; i++) {
+        room_remove_hunter(room, context->hunter);
+        room_add_hunter(room, context->hunter);
+    }
+    context->sink = room->num_hunters;
+}
+
+// The move at the end of hunter_step: both room locks in address order, relink, unlock
+static void micro_locked_move(struct MicroContext* context, int calls) {
+    struct Hunter* h = context->hunter;
+    for (int i = 0; i < calls; i++) {
+        struct Room* curr = h->room;
+        struct Room* next = curr == context->rooms[0] ? context->rooms[1] : context->rooms[0];
+        struct Room* first = (curr < next) ? curr : next;
+        struct Room* second = (curr < next) ? next : curr;
+
+        lock_acquire(&first->mutex);
+        lock_acquire(&second->mutex);
+        if (next->is_exit || next->num_hunters < MAX_ROOM_OCCUPANCY) {
+            room_remove_hunter(curr, h);
+            room_add_hunter(next, h);
+            h->room = next;
+        }
+        lock_release(&second->mutex);
+        lock_release(&first->mutex);
+    }
+    context->sink = h->room->id;
+}
+
+static void micro_log_move(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_move(1, 2, 3, context->rooms[i & 1], context->rooms[(i + 1) & 1], EV_EMF);
+    }
+}
+
+static void micro_log_evidence(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_evidence(1, 2, 3, context->rooms[1], EV_ORBS);
+    }
+}
+
+static void micro_log_swap(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_swap(1, 2, 3, context->rooms[0], EV_EMF, EV_RADIO);
+    }
+}
+
+static void micro_log_exit(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_exit(1, 2, 3, context->rooms[0], EV_EMF, LR_BORED);
+    }
+}
+
+static void micro_log_return_to_van(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_return_to_van(1, 2, 3, context->rooms[1], EV_EMF, (i & 1) != 0);
+    }
+}
+
+static void micro_log_hunter_init(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_hunter_init(1, context->rooms[0], "bench", EV_EMF);
+    }
+}
+
+static void micro_log_ghost_move(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_ghost_move(DEFAULT_GHOST_ID, 2, context->rooms[i & 1], context->rooms[(i + 1) & 1]);
+    }
+}
+
+static void micro_log_ghost_evidence(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_ghost_evidence(DEFAULT_GHOST_ID, 2, context->rooms[1], EV_WRITING);
+    }
+}
+
+static void micro_log_ghost_idle(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_ghost_idle(DEFAULT_GHOST_ID, 2, context->rooms[1]);
+    }
+}
+
+static void micro_log_ghost_exit(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_ghost_exit(DEFAULT_GHOST_ID, 15, context->rooms[1]);
+    }
+}
+
+static void micro_log_ghost_init(struct MicroContext* context, int calls) {
+    for (int i = 0; i < calls; i++) {
+        log_ghost_init(DEFAULT_GHOST_ID, context->rooms[1], GH_BANSHEE);
+    }
+}
+
+static const struct MicroBench benches[] = {
+    {"rand_int_threadsafe",         micro_rand_int_threadsafe,          false},
+    {"rand_stream_int",             micro_rand_stream_int,              false},
+    {"evidence_is_valid_ghost",     micro_evidence_is_valid_ghost,      false},
+    {"evidence_has_three_unique",   micro_evidence_has_three_unique,    false},
+    {"stack_push+stack_pop",        micro_stack_push_pop,               false},
+    {"room_add+remove_hunter",      micro_room_add_remove_hunter,       false},
+    {"locked_two_room_move",        micro_locked_move,                  false},
+    {"log_move",                    micro_log_move,                     true},
+    {"log_evidence",                micro_log_evidence,                 true},
+    {"log_swap",                    micro_log_swap,                     true},
+    {"log_exit",                    micro_log_exit,                     true},
+    {"log_return_to_van",           micro_log_return_to_van,            true},
+    {"log_hunter_init",             micro_log_hunter_init,              true},
+    {"log_ghost_move",              micro_log_ghost_move,               true},
+    {"log_ghost_evidence",          micro_log_ghost_evidence,           true},
+    {"log_ghost_idle",              micro_log_ghost_idle,               true},
+    {"log_ghost_exit",              micro_log_ghost_exit,               true},
+    {"log_ghost_init",              micro_log_ghost_init,               true},
+};
+#define MICRO_BENCH_COUNT (int)(sizeof(benches) / sizeof(benches[0]))
+
+// ---- harness ----
+struct MicroRun {
+    const struct MicroBench* bench;
+    struct MicroContext* context;
+    int batch;
+    int samples;
+    int warmup;
+    double* times;              // ns per call, one per sample
+};
+
+static double now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void* micro_thread(void* arg) {
+    struct MicroRun* run = (struct MicroRun*)arg;
+    for (int i = 0; i < run->warmup; i++) {
+        run->bench->function(run->context, run->batch);
+    }
+    for (int i = 0; i < run->samples; i++) {
+        double start = now_ns();
+        run->bench->function(run->context, run->batch);
+        run->times[i] = (now_ns() - start) / run->batch;
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double micro_percentile(const double* sorted, int count, int percent) {
+    int index = (count * percent + 99) / 100 - 1;
+    return sorted[index < 0 ? 0 : index];
+}
+
+/**
+ * @brief Runs one benchmark on its own thread and summarises the samples
+ *
+ * @param bench Benchmark to run
+ * @param context Shared set-up state
+ * @param batch Calls per sample
+ * @param samples Timed samples
+ * @param warmup Untimed batches first
+ * @param result Filled in on success
+ * @return 0 on success, -1 if out of memory or the thread could not start
+ */
+static int micro_run(const struct MicroBench* bench, struct MicroContext* context, int batch, int samples, int warmup, struct MicroResult* result) {
+    struct MicroRun run = {bench, context, batch, samples, warmup, malloc(sizeof(double) * samples)};
+    pthread_t thread;
+    if (!run.times || pthread_create(&thread, NULL, micro_thread, &run) != 0) {
+        free(run.times);
+        return -1;
+    }
+    pthread_join(thread, NULL);
+
+    double sum = 0.0;
+    for (int i = 0; i < samples; i++) {
+        sum += run.times[i];
+    }
+    qsort(run.times, samples, sizeof(double), compare_doubles);
+    result->calls = batch;
+    result->samples = samples;
+    result->min = run.times[0];
+    result->p50 = micro_percentile(run.times, samples, 50);
+    result->p90 = micro_percentile(run.times, samples, 90);
+    result->p99 = micro_percentile(run.times, samples, 99);
+    result->max = run.times[samples - 1];
+    result->mean = sum / samples;
+    free(run.times);
+    return 0;
+}
+
+static int remove_entry(const char* path, const struct stat* info, int flag, struct FTW* ftw) {
+    (void)info;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Parses a positive integer option value
+ *
+ * @param text The argument text
+ * @param out Pointer to store the value in
+ * @return true if text was a positive integer
+ */
+static bool parse_positive(const char* text, int* out) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value <= 0 || value > 100000000L) {
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int batch = 1000;
+    int samples = 200;
+    int warmup = 20;
+    const char* filter = NULL;
+    const char* out_path = "bench_micro.json";
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        bool valid = true;
+        if (strcmp(argv[i], "--batch") == 0 && has_value) {
+            valid = parse_positive(argv[++i], &batch);
+        } else if (strcmp(argv[i], "--samples") == 0 && has_value) {
+            valid = parse_positive(argv[++i], &samples);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            valid = parse_positive(argv[++i], &warmup);
+        } else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else {
+            printf("Usage: %s [--batch N] [--samples S] [--warmup W] [--filter TEXT] [--out FILE]\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid %s value: %s\n", argv[i - 1], argv[i]);
+            return 1;
+        }
+    }
+
+    // logs go to a scratch directory, and the queue holds every event of a benchmark
+    char log_dir[] = "/tmp/ghost_micro_XXXXXX";
+    if (!mkdtemp(log_dir)) {
+        fprintf(stderr, "Cannot create a scratch directory for the logs\n");
+        return 1;
+    }
+    log_set_directory(log_dir);
+    log_set_outputs(LOG_OUTPUT_NONE);
+    log_set_queue_capacity(MICRO_LOG_CALL_LIMIT);
+
+    struct MicroContext* context = malloc(sizeof(struct MicroContext));
+    if (!context) {
+        return 1;
+    }
+    house_init(&context->house, NULL, -1, 1);
+    context->hunter = house_add_hunter(&context->house, "bench", 1);
+    context->rooms[0] = context->house.starting_room;
+    context->rooms[1] = room_neighbour(context->house.starting_room, 0);
+    stack_init(&context->stack, 16);
+    rand_stream_init(&context->stream, 1, 0, RNG_SLOT_HUNTER(0));
+    context->mask = 0;
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", out_path);
+        return 1;
+    }
+    fprintf(out, "{\n  \"lock\": \"%s\",\n  \"warmup\": %d,\n  \"benchmarks\": [", LOCK_BACKEND_NAME, warmup);
+
+    printf("%-28s %7s %9s %9s %9s %9s %9s %9s\n", "benchmark", "calls", "min ns", "p50 ns", "p90 ns", "p99 ns", "max ns", "mean ns");
+    int status = 0;
+    int reported = 0;
+    for (int b = 0; b < MICRO_BENCH_COUNT; b++) {
+        const struct MicroBench* bench = &benches[b];
+        if (filter && !strstr(bench->name, filter)) {
+            continue;
+        }
+        int bench_batch = batch;
+        int bench_samples = samples;
+        int bench_warmup = warmup;
+        if (bench->logs) {
+            bench_batch = batch / 5 > 0 ? batch / 5 : 1;
+            while ((long)bench_batch * (bench_samples + bench_warmup) > MICRO_LOG_CALL_LIMIT && bench_samples > 1) {
+                bench_samples--;
+            }
+            log_set_outputs(LOG_OUTPUT_BINARY);
+        }
+
+        struct MicroResult result;
+        if (micro_run(bench, context, bench_batch, bench_samples, bench_warmup, &result) != 0) {
+            fprintf(stderr, "%s: could not run\n", bench->name);
+            status = 1;
+            continue;
+        }
+        if (bench->logs) {
+            // drain the queue so the next benchmark starts with an idle writer
+            log_flush_all();
+            log_set_outputs(LOG_OUTPUT_NONE);
+        }
+
+        printf("%-28s %7d %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+               bench->name, result.calls, result.min, result.p50, result.p90, result.p99, result.max, result.mean);
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"calls_per_sample\": %d, \"samples\": %d, "
+                     "\"min_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"max_ns\": %.3f, \"mean_ns\": %.3f}",
+                reported++ == 0 ? "" : ",", bench->name, result.calls, result.samples,
+                result.min, result.p50, result.p90, result.p99, result.max, result.mean);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        status = 1;
+    }
+
+    stack_free(&context->stack);
+    house_cleanup(&context->house);
+    free(context);
+    log_flush_all();
+    nftw(log_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    printf("Results written to %s\n", out_path);
+    return status;
+}
@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "defs.h"
+#include "helpers.h"
+#include "batch.h"
+#include "map.h"
+#include "mapgen.h"
+
+/*
+    End-to-end throughput benchmark (make bench).
+
+    Runs a fixed list of seeded batch workloads that vary the hunter count, the house (built-in
+    Willow or generated), logging (off, or binary logs into a scratch directory) and sleeping
+    (the threaded engine sleeps between turns, des and pool do not). Every workload runs in its
+    own child process so peak RSS and CPU time belong to that workload alone.
+
+    Reports simulated steps per second, logged events per second, wall time per hunt, peak RSS
+    and CPU utilisation (CPU seconds per wall second, so 2.0 = two cores busy), as a table on
+    stdout and as JSON.
+
+    Usage: ./bench_sim [--out FILE] [--scale F] [--workload NAME]...
+           (default: bench_results.json, every workload at its normal size)
+*/
+
+#define BENCH_SEED 20251130ull
+#define BENCH_MAX_SELECTED 32
+
+struct BenchWorkload {
+    const char* name;
+    enum SimEngine engine;
+    int hunters;
+    const char* generate;   // --generate spec, NULL for the built-in Willow layout
+    bool logging;
+    int runs;
+};
+
+// Logged workloads write a directory of log files per hunt, so they run fewer hunts
+static const struct BenchWorkload workloads[] = {
+    {"willow-4h-des",         ENGINE_DES,     4,   NULL,                                       false, 20000},
+    {"willow-4h-des-log",     ENGINE_DES,     4,   NULL,                                       true,  2000},
+    {"willow-32h-des",        ENGINE_DES,     32,  NULL,                                       false, 4000},
+    {"willow-32h-pool",       ENGINE_POOL,    32,  NULL,                                       false, 4000},
+    {"willow-256h-pool",      ENGINE_POOL,    256, NULL,                                       false, 500},
+    {"gen1k-8h-des",          ENGINE_DES,     8,   "rooms=1000,loops=0.2",                     false, 2000},
+    {"gen1k-8h-des-log",      ENGINE_DES,     8,   "rooms=1000,loops=0.2",                     true,  2000},
+    {"gen100k-8h-pool",       ENGINE_POOL,    8,   "rooms=100000,degree=preferential,loops=0.2", false, 50},
+    {"willow-4h-threads",     ENGINE_THREADS, 4,   NULL,                                       false, 16},
+    {"willow-4h-threads-log", ENGINE_THREADS, 4,   NULL,                                       true,  16},
+};
+#define BENCH_WORKLOAD_COUNT (int)(sizeof(workloads) / sizeof(workloads[0]))
+
+// What a workload child reports back through its pipe
+struct BenchChildResult {
+    int status;             // 0 if the batch ran
+    int rooms;
+    int connections;
+    int runs;
+    int won;
+    long long steps;
+    double batch_seconds;   // Time spent in batch_run (setup such as map generation excluded)
+    size_t events;          // Log events written
+    size_t dropped;
+};
+
+struct BenchResult {
+    struct BenchChildResult child;
+    double wall_seconds;    // Whole child process
+    double cpu_seconds;     // User + system time of the child
+    long peak_rss_kb;
+};
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int remove_entry(const char* path, const struct stat* info, int flag, struct FTW* ftw) {
+    (void)info;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Runs one workload inside the child process
+ *
+ * @param workload Workload to run
+ * @param runs Number of hunts (after --scale)
+ * @param log_dir Scratch directory for logs
+ * @param result Filled in for the parent
+ */
+static void bench_child(const struct BenchWorkload* workload, int runs, const char* log_dir, struct BenchChildResult* result) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    struct BatchConfig config;
+    config.runs = runs;
+    config.jobs = cores > 0 ? (int)cores : 1;
+    config.hunter_count = workload->hunters;
+    config.engine = workload->engine;
+    config.map = NULL;
+    config.first_run = 0;
+    config.seed = BENCH_SEED;
+    config.metrics_path = NULL;
+    config.metrics_interval = 0.0;
+    config.snapshot = NULL;
+
+    struct HouseMap map = {NULL, 0, NULL, 0};
+    result->rooms = 13;     // built-in Willow layout
+    result->connections = 12;
+    if (workload->generate) {
+        char error[256];
+        struct MapGenConfig generator;
+        map_gen_defaults(&generator, BENCH_SEED);
+        if (map_gen_parse(workload->generate, &generator, error, sizeof(error)) != 0 ||
+            house_map_generate(&generator, &map, error, sizeof(error)) != 0) {
+            fprintf(stderr, "%s: %s\n", workload->name, error);
+            result->status = -1;
+            return;
+        }
+        config.map = &map;
+        result->rooms = map.room_count;
+        result->connections = map.edge_count;
+    }
+
+    log_set_directory(log_dir);
+    log_set_outputs(workload->logging ? LOG_OUTPUT_BINARY : LOG_OUTPUT_NONE);
+
+    struct BatchStats stats;
+    if (batch_run(&config, &stats) != 0) {
+        result->status = -1;
+        house_map_free(&map);
+        return;
+    }
+    // the writer thread still has to catch up; that is part of the logging cost
+    double start = now_seconds();
+    log_flush_all();
+    double flush = now_seconds() - start;
+
+    struct LogQueueStats queue;
+    log_get_queue_stats(&queue);
+    result->status = 0;
+    result->runs = stats.runs;
+    result->won = stats.won;
+    result->steps = stats.steps;
+    result->batch_seconds = stats.wall_seconds + flush;
+    result->events = queue.written;
+    result->dropped = queue.dropped;
+    batch_stats_free(&stats);
+    house_map_free(&map);
+}
+
+/**
+ * @brief Forks a child for one workload and collects its result and resource usage
+ *
+ * @param workload Workload to run
+ * @param runs Number of hunts (after --scale)
+ * @param result Filled in on success
+ * @return 0 on success, -1 if the child failed
+ */
+static int bench_workload(const struct BenchWorkload* workload, int runs, struct BenchResult* result) {
+    char log_dir[] = "/tmp/ghost_bench_XXXXXX";
+    if (!mkdtemp(log_dir)) {
+        return -1;
+    }
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        rmdir(log_dir);
+        return -1;
+    }
+
+    fflush(stdout);
+    double start = now_seconds();
+    pid_t child = fork();
+    if (child == 0) {
+        close(pipe_fds[0]);
+        struct BenchChildResult child_result;
+        memset(&child_result, 0, sizeof(child_result));
+        bench_child(workload, runs, log_dir, &child_result);
+        ssize_t written = write(pipe_fds[1], &child_result, sizeof(child_result));
+        _exit(written == (ssize_t)sizeof(child_result) ? 0 : 1);
+    }
+    close(pipe_fds[1]);
+    if (child < 0) {
+        close(pipe_fds[0]);
+        rmdir(log_dir);
+        return -1;
+    }
+
+    ssize_t got = read(pipe_fds[0], &result->child, sizeof(result->child));
+    close(pipe_fds[0]);
+    int status;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    result->wall_seconds = now_seconds() - start;
+    result->cpu_seconds = (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+                          (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+    result->peak_rss_kb = usage.ru_maxrss;
+
+    nftw(log_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    if (got != (ssize_t)sizeof(result->child) || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || result->child.status != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static const char* bench_engine_name(enum SimEngine engine) {
+    switch (engine) {
+        case ENGINE_DES: return "des";
+        case ENGINE_POOL: return "pool";
+        default: return "threads";
+    }
+}
+
+/**
+ * @brief Writes one workload as a JSON object
+ *
+ * @param out Destination stream
+ * @param workload Workload that was run
+ * @param result Its measurements
+ * @param first true for the first object of the array (no separating comma)
+ */
+static void bench_write_json(FILE* out, const struct BenchWorkload* workload, const struct BenchResult* result, bool first) {
+    const struct BenchChildResult* child = &result->child;
+    double seconds = child->batch_seconds > 0 ? child->batch_seconds : 1e-9;
+    fprintf(out, "%s    {\n", first ? "" : ",\n");
+    fprintf(out, "      \"name\": \"%s\",\n", workload->name);
+    fprintf(out, "      \"engine\": \"%s\",\n", bench_engine_name(workload->engine));
+    fprintf(out, "      \"hunters\": %d,\n", workload->hunters);
+    fprintf(out, "      \"rooms\": %d,\n", child->rooms);
+    fprintf(out, "      \"connections\": %d,\n", child->connections);
+    fprintf(out, "      \"logging\": %s,\n", workload->logging ? "true" : "false");
+    fprintf(out, "      \"sleeping\": %s,\n", workload->engine == ENGINE_THREADS ? "true" : "false");
+    fprintf(out, "      \"runs\": %d,\n", child->runs);
+    fprintf(out, "      \"won\": %d,\n", child->won);
+    fprintf(out, "      \"steps\": %lld,\n", child->steps);
+    fprintf(out, "      \"events_logged\": %zu,\n", child->events);
+    fprintf(out, "      \"events_dropped\": %zu,\n", child->dropped);
+    fprintf(out, "      \"batch_seconds\": %.6f,\n", child->batch_seconds);
+    fprintf(out, "      \"process_seconds\": %.6f,\n", result->wall_seconds);
+    fprintf(out, "      \"steps_per_second\": %.1f,\n", (double)child->steps / seconds);
+    fprintf(out, "      \"events_per_second\": %.1f,\n", (double)child->events / seconds);
+    fprintf(out, "      \"wall_ms_per_hunt\": %.6f,\n", child->runs > 0 ? 1000.0 * child->batch_seconds / child->runs : 0.0);
+    fprintf(out, "      \"peak_rss_kb\": %ld,\n", result->peak_rss_kb);
+    fprintf(out, "      \"cpu_seconds\": %.6f,\n", result->cpu_seconds);
+    fprintf(out, "      \"cpu_utilisation\": %.3f\n", result->wall_seconds > 0 ? result->cpu_seconds / result->wall_seconds : 0.0);
+    fprintf(out, "    }");
+}
+
+int main(int argc, char* argv[]) {
+    const char* out_path = "bench_results.json";
+    double scale = 1.0;
+    const struct BenchWorkload* selected[BENCH_MAX_SELECTED];
+    int selected_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && has_value) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--workload") == 0 && has_value && selected_count < BENCH_MAX_SELECTED) {
+            const char* name = argv[++i];
+            int w = 0;
+            while (w < BENCH_WORKLOAD_COUNT && strcmp(workloads[w].name, name) != 0) {
+                w++;
+            }
+            if (w == BENCH_WORKLOAD_COUNT) {
+                fprintf(stderr, "Unknown workload: %s\n", name);
+                return 1;
+            }
+            selected[selected_count++] = &workloads[w];
+        } else {
+            printf("Usage: %s [--out FILE] [--scale F] [--workload NAME]...\n", argv[0]);
+            printf("Workloads:");
+            for (int w = 0; w < BENCH_WORKLOAD_COUNT; w++) {
+                printf(" %s", workloads[w].name);
+            }
+            printf("\n");
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (scale <= 0) {
+        fprintf(stderr, "--scale must be positive\n");
+        return 1;
+    }
+    if (selected_count == 0) {
+        for (int w = 0; w < BENCH_WORKLOAD_COUNT; w++) {
+            selected[selected_count++] = &workloads[w];
+        }
+    }
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", out_path);
+        return 1;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    fprintf(out, "{\n");
+    fprintf(out, "  \"seed\": %llu,\n", BENCH_SEED);
+    fprintf(out, "  \"lock\": \"%s\",\n", LOCK_BACKEND_NAME);
+    fprintf(out, "  \"cores\": %ld,\n", cores);
+    fprintf(out, "  \"workloads\": [\n");
+
+    printf("%-22s %6s %11s %11s %10s %9s %5s\n", "workload", "runs", "steps/s", "events/s", "ms/hunt", "RSS MB", "CPU");
+    int status = 0;
+    int reported = 0;
+    for (int i = 0; i < selected_count; i++) {
+        const struct BenchWorkload* workload = selected[i];
+        int runs = (int)(workload->runs * scale + 0.5);
+        if (runs < 1) {
+            runs = 1;
+        }
+        struct BenchResult result;
+        if (bench_workload(workload, runs, &result) != 0) {
+            fprintf(stderr, "%s: workload failed\n", workload->name);
+            status = 1;
+            continue;
+        }
+        double seconds = result.child.batch_seconds > 0 ? result.child.batch_seconds : 1e-9;
+        printf("%-22s %6d %11.0f %11.0f %10.3f %9.1f %5.2f\n",
+               workload->name,
+               result.child.runs,
+               (double)result.child.steps / seconds,
+               (double)result.child.events / seconds,
+               1000.0 * result.child.batch_seconds / result.child.runs,
+               result.peak_rss_kb / 1024.0,
+               result.wall_seconds > 0 ? result.cpu_seconds / result.wall_seconds : 0.0);
+        bench_write_json(out, workload, &result, reported++ == 0);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        status = 1;
+    }
+    printf("Results written to %s\n", out_path);
+    return status;
+}
@@ -0,0 +1,209 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "defs.h"
+#include "helpers.h"
+#include "check.h"
+
+#define CHECK_SAMPLES 5         // Violations kept per rule for the report
+#define CHECK_DETAILS_LENGTH 128
+#define CHECK_SAMPLE_LENGTH (CHECK_DETAILS_LENGTH + 64)    // Details plus the run/entity/step prefix
+
+bool check_enabled = false;
+
+static const char* const check_rule_names[CHECK_RULE_COUNT] = {"movement", "return", "evidence", "boredom", "fear"};
+
+static atomic_long check_counts[CHECK_RULE_COUNT];
+static pthread_mutex_t check_samples_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char check_samples[CHECK_RULE_COUNT][CHECK_SAMPLES][CHECK_SAMPLE_LENGTH];
+static int check_sample_counts[CHECK_RULE_COUNT];
+
+/**
+ * @brief Counts a violation and keeps its description if the rule has few so far
+ *
+ * @param rule Which rule was broken
+ * @param room A room of the entity's house (for the run id)
+ * @param entity "hunter" or "ghost"
+ * @param id Entity id
+ * @param step The entity's step count
+ * @param format printf format of the details, then its arguments
+ */
+__attribute__((format(printf, 6, 7)))
+static void check_violation(enum CheckRule rule, const struct Room* room, const char* entity, int id, int step, const char* format, ...) {
+    // the first violations are what the report shows, later ones are only counted
+    if (atomic_fetch_add_explicit(&check_counts[rule], 1, memory_order_relaxed) >= CHECK_SAMPLES) {
+        return;
+    }
+
+    char details[CHECK_DETAILS_LENGTH];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(details, sizeof(details), format, args);
+    va_end(args);
+
+    pthread_mutex_lock(&check_samples_mutex);
+    if (check_sample_counts[rule] < CHECK_SAMPLES) {
+        snprintf(check_samples[rule][check_sample_counts[rule]++], CHECK_SAMPLE_LENGTH,
+                 "run %d %s %d step %d: %s", room->house->run_id, entity, id, step, details);
+    }
+    pthread_mutex_unlock(&check_samples_mutex);
+}
+
+/**
+ * @brief Whether two rooms share a connection
+ *
+ * @param a Pointer to a Room
+ * @param b Pointer to another Room of the same house
+ * @return true if b is one of a's neighbours
+ */
+static bool check_connected(const struct Room* a, const struct Room* b) {
+    int degree = room_degree(a);
+    for (int i = 0; i < degree; i++) {
+        if (room_neighbour(a, i) == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a hunter is on a room's list of hunters (call with the room locked)
+static bool check_listed(const struct Room* room, const struct Hunter* h) {
+    for (const struct Hunter* other = room->hunters; other; other = other->room_next) {
+        if (other == h) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void check_set_enabled(bool enabled) {
+    check_enabled = enabled;
+}
+
+void check_hunter_senses(const struct Hunter* h, int boredom_before, int fear_before) {
+    // what the room holds, not what hunter_step saw: the ghost in it has to be this house's
+    // ghost and think it is here (it cannot leave while the room is locked)
+    const struct Ghost* ghost = h->room->ghost;
+    if (ghost && (ghost != h->room->house->ghost || ghost->room != h->room)) {
+        check_violation(CHECK_MOVEMENT, h->room, "hunter", h->id, h->steps, "%s lists a ghost that is not there", h->room->name);
+    }
+    if (!check_listed(h->room, h)) {
+        check_violation(CHECK_MOVEMENT, h->room, "hunter", h->id, h->steps, "not on the list of %s, where it is", h->room->name);
+    }
+
+    bool ghost_seen = ghost != NULL;
+    int boredom_expected = ghost_seen ? 0 : boredom_before + 1;
+    int fear_expected = ghost_seen ? fear_before + 1 : fear_before;
+    if (h->boredom != boredom_expected) {
+        check_violation(CHECK_BOREDOM, h->room, "hunter", h->id, h->steps, "boredom %d -> %d in %s, %s the ghost (expected %d)",
+                        boredom_before, h->boredom, h->room->name, ghost_seen ? "with" : "without", boredom_expected);
+    }
+    if (h->fear != fear_expected) {
+        check_violation(CHECK_FEAR, h->room, "hunter", h->id, h->steps, "fear %d -> %d in %s, %s the ghost (expected %d)",
+                        fear_before, h->fear, h->room->name, ghost_seen ? "with" : "without", fear_expected);
+    }
+}
+
+void check_hunter_home(const struct Hunter* h) {
+    if (h->return_to_van && h->path_stack.count != 0) {
+        check_violation(CHECK_RETURN, h->room, "hunter", h->id, h->steps, "back in %s with %d breadcrumbs left",
+                        h->room->name, h->path_stack.count);
+    }
+}
+
+void check_hunter_return(const struct Hunter* h, const struct Room* room, const struct Room* next) {
+    if (!next) {
+        check_violation(CHECK_RETURN, room, "hunter", h->id, h->steps, "breadcrumbs ran out in %s before the van", room->name);
+    } else if (!check_connected(room, next)) {
+        check_violation(CHECK_RETURN, room, "hunter", h->id, h->steps, "next breadcrumb %s is not next to %s", next->name, room->name);
+    }
+}
+
+void check_hunter_collect(const struct Hunter* h, const struct Room* room) {
+    enum GhostType type = room->house->ghost->type;
+    if (!((EvidenceByte)type & h->device)) {
+        check_violation(CHECK_EVIDENCE, room, "hunter", h->id, h->steps, "collected %s in %s, which a %s never leaves",
+                        evidence_to_string(h->device), room->name, ghost_to_string(type));
+    }
+}
+
+void check_hunter_move(const struct Hunter* h, const struct Room* from, const struct Room* to) {
+    if (!check_connected(from, to)) {
+        check_violation(CHECK_MOVEMENT, from, "hunter", h->id, h->steps, "moved %s -> %s, which are not connected", from->name, to->name);
+    }
+    if (h->room != to || !check_listed(to, h) || check_listed(from, h)) {
+        check_violation(CHECK_MOVEMENT, from, "hunter", h->id, h->steps, "moved %s -> %s but the rooms' lists disagree", from->name, to->name);
+    }
+    if (!to->is_exit && to->num_hunters > MAX_ROOM_OCCUPANCY) {
+        check_violation(CHECK_MOVEMENT, from, "hunter", h->id, h->steps, "%s holds %d hunters (limit %d)",
+                        to->name, to->num_hunters, MAX_ROOM_OCCUPANCY);
+    }
+}
+
+void check_ghost_senses(const struct Ghost* g, int boredom_before) {
+    // count the room's list instead of trusting num_hunters; listed hunters cannot leave while it is locked
+    int listed = 0;
+    for (const struct Hunter* h = g->room->hunters; h; h = h->room_next) {
+        if (h->room != g->room) {
+            check_violation(CHECK_MOVEMENT, g->room, "ghost", g->id, g->steps, "%s lists hunter %d, which is in %s",
+                            g->room->name, h->id, h->room->name);
+        }
+        listed++;
+    }
+    if (listed != g->room->num_hunters) {
+        check_violation(CHECK_MOVEMENT, g->room, "ghost", g->id, g->steps, "%s counts %d hunters but lists %d",
+                        g->room->name, g->room->num_hunters, listed);
+    }
+
+    bool hunters_seen = listed > 0;
+    int expected = hunters_seen ? 0 : boredom_before + 1;
+    if (g->boredom != expected) {
+        check_violation(CHECK_BOREDOM, g->room, "ghost", g->id, g->steps, "boredom %d -> %d in %s, %s hunters (expected %d)",
+                        boredom_before, g->boredom, g->room->name, hunters_seen ? "with" : "without", expected);
+    }
+}
+
+void check_ghost_evidence(const struct Ghost* g, const struct Room* room, int evidence) {
+    if (!((EvidenceByte)g->type & (EvidenceByte)evidence)) {
+        check_violation(CHECK_EVIDENCE, room, "ghost", g->id, g->steps, "%s left %s in %s",
+                        ghost_to_string(g->type), evidence_to_string((enum EvidenceType)evidence), room->name);
+    }
+}
+
+void check_ghost_move(const struct Ghost* g, const struct Room* from, const struct Room* to) {
+    if (!check_connected(from, to)) {
+        check_violation(CHECK_MOVEMENT, from, "ghost", g->id, g->steps, "moved %s -> %s, which are not connected", from->name, to->name);
+    }
+    if (g->room != to || to->ghost != g || from->ghost != NULL) {
+        check_violation(CHECK_MOVEMENT, from, "ghost", g->id, g->steps, "moved %s -> %s but the rooms disagree", from->name, to->name);
+    }
+}
+
+long check_report(FILE* out) {
+    if (!check_enabled) {
+        return 0;
+    }
+    long total = 0;
+    for (int rule = 0; rule < CHECK_RULE_COUNT; rule++) {
+        total += atomic_load(&check_counts[rule]);
+    }
+    if (total == 0) {
+        fprintf(out, "Invariant check: no violations\n");
+        return 0;
+    }
+
+    fprintf(out, "Invariant check: %ld violations\n", total);
+    pthread_mutex_lock(&check_samples_mutex);
+    for (int rule = 0; rule < CHECK_RULE_COUNT; rule++) {
+        long count = atomic_load(&check_counts[rule]);
+        if (count == 0) {
+            continue;
+        }
+        fprintf(out, "  %s: %ld\n", check_rule_names[rule], count);
+        for (int i = 0; i < check_sample_counts[rule]; i++) {
+            fprintf(out, "    %s\n", check_samples[rule][i]);
+        }
+    }
+    pthread_mutex_unlock(&check_samples_mutex);
+    return total;
+}
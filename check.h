@@ -0,0 +1,114 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "defs.h"
+
+/*
+    Online invariant checker (--check): the rules validate_logs.py replays from the log files,
+    checked on the live House while the hunt runs, so a batch can be validated without writing
+    or reading any logs. hunter_step() and ghost_step() call the hooks below when check_enabled
+    is set; with it off each hook site costs one predictable branch.
+
+        movement    every move follows a connection of the map; the mover is in the room it
+                    left from and listed in the room it entered; rooms stay within occupancy
+        return      a returning hunter walks its breadcrumbs: each one is next to the room it is
+                    in, the trail never runs out before the van and is used up on arrival
+        evidence    hunters only collect, and the ghost only leaves, evidence of the ghost's type
+        boredom     a hunter's boredom resets when it shares a room with the ghost and grows by
+                    one otherwise; the ghost's resets with hunters in the room
+        fear        a hunter's fear grows by one with the ghost and is unchanged otherwise
+
+    Violations are counted per rule; the first few of each are kept with the run, entity, id
+    and step and printed by check_report().
+*/
+
+enum CheckRule {
+    CHECK_MOVEMENT = 0,
+    CHECK_RETURN,
+    CHECK_EVIDENCE,
+    CHECK_BOREDOM,
+    CHECK_FEAR,
+    CHECK_RULE_COUNT
+};
+
+// Set once before any hunt starts, read by every step
+extern bool check_enabled;
+
+/**
+ * @brief Turn the checker on or off; call before any hunt starts.
+ * @param[in] enabled Whether the step hooks run.
+ */
+void check_set_enabled(bool enabled);
+
+/**
+ * @brief Hunter boredom and fear after it looked for the ghost, against what its room holds.
+ *        Call with the hunter's room still locked.
+ * @param[in] h Hunter after the update.
+ * @param[in] boredom_before Boredom at the start of the turn.
+ * @param[in] fear_before Fear at the start of the turn.
+ */
+void check_hunter_senses(const struct Hunter* h, int boredom_before, int fear_before);
+
+/**
+ * @brief A returning hunter in the van: its trail must be used up.
+ * @param[in] h Hunter, before its path stack is cleared.
+ */
+void check_hunter_home(const struct Hunter* h);
+
+/**
+ * @brief A returning hunter picked its next breadcrumb.
+ * @param[in] h Hunter.
+ * @param[in] room Room it is in.
+ * @param[in] next Breadcrumb popped off its path stack, NULL if the stack was empty.
+ */
+void check_hunter_return(const struct Hunter* h, const struct Room* room, const struct Room* next);
+
+/**
+ * @brief A hunter collected the evidence its device picks up.
+ * @param[in] h Hunter.
+ * @param[in] room Room the evidence was in.
+ */
+void check_hunter_collect(const struct Hunter* h, const struct Room* room);
+
+/**
+ * @brief A hunter moved; call with both rooms locked.
+ * @param[in] h Hunter, already relinked.
+ * @param[in] from Room it left.
+ * @param[in] to Room it entered.
+ */
+void check_hunter_move(const struct Hunter* h, const struct Room* from, const struct Room* to);
+
+/**
+ * @brief Ghost boredom after it looked for hunters, against its room's list of hunters.
+ *        Call with the ghost's room still locked.
+ * @param[in] g Ghost after the update.
+ * @param[in] boredom_before Boredom at the start of the turn.
+ */
+void check_ghost_senses(const struct Ghost* g, int boredom_before);
+
+/**
+ * @brief The ghost left evidence.
+ * @param[in] g Ghost.
+ * @param[in] room Room it left the evidence in.
+ * @param[in] evidence Evidence bit it left.
+ */
+void check_ghost_evidence(const struct Ghost* g, const struct Room* room, int evidence);
+
+/**
+ * @brief The ghost moved; call with both rooms locked.
+ * @param[in] g Ghost, already moved.
+ * @param[in] from Room it left.
+ * @param[in] to Room it entered.
+ */
+void check_ghost_move(const struct Ghost* g, const struct Room* from, const struct Room* to);
+
+/**
+ * @brief Print the violation counts and the first violations of each rule.
+ * @param[in] out Stream to print to.
+ * @return Number of violations found, 0 if the checker never ran.
+ */
+long check_report(FILE* out);
+
+#endif // CHECK_H
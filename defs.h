@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <semaphore.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include "rng.h"
+#include "lock.h"
 
 /*
     You are free to rename all of the types and functions defined here.
@@ -13,13 +16,10 @@
 
 #define MAX_ROOM_NAME 64
 #define MAX_HUNTER_NAME 64
-#define MAX_ROOMS 24
-#define MAX_ROOM_OCCUPANCY 8
-#define MAX_CONNECTIONS 8
+#define MAX_ROOM_OCCUPANCY 8   // Hunters allowed to walk into a room (exits have no limit)
 #define ENTITY_BOREDOM_MAX 15
 #define HUNTER_FEAR_MAX 15
 #define DEFAULT_GHOST_ID 68057
-#define MAX_HUNTERS 4 
 
 typedef unsigned char EvidenceByte; // Just giving a helpful name to unsigned char for evidence bitmasks
 
@@ -66,22 +66,22 @@ enum GhostType {
     GH_SPIRIT       = EV_WRITING      | EV_RADIO       | EV_EMF,
 };
 
+// Lock-free: collected only ever gains bits (fetch_or), solved is published with release/acquire
 struct CaseFile {
-    EvidenceByte collected; // Union of all of the evidence bits collected between all hunters
-    bool         solved;    // True when >=3 unique bits set
-    sem_t        mutex;     // Used for synchronizing both fields when multithreading
+    _Atomic EvidenceByte collected; // Union of all of the evidence bits collected between all hunters
+    atomic_bool          solved;    // True once collected matches a ghost type
 };
 
 // Implement here based on the requirements, should all be allocated to the House structure
 struct Room {
     char name[MAX_ROOM_NAME];
-    struct Room* connected[MAX_CONNECTIONS];
-    int num_connected;
+    int id;                 // Index in house->rooms
+    struct House* house;    // House the room belongs to, which also holds its connections
     struct Ghost* ghost; 
-    struct Hunter* hunters[MAX_ROOM_OCCUPANCY];
+    struct Hunter* hunters; // Hunters in the room, linked through Hunter.room_next
     int num_hunters;
-    EvidenceByte evidence;
-    sem_t mutex; 
+    _Atomic EvidenceByte evidence;  // Updated with atomic and/or, not covered by mutex
+    struct SimLock mutex;   // Occupancy (hunters, num_hunters) and ghost presence (see lock.h)
     bool is_exit;
 };
 
@@ -92,23 +92,38 @@ struct Ghost {
     struct Room* room;
     int boredom;
     bool running; 
-    sem_t mutex;
+    struct RandStream rng;
+    int steps;
+    struct SimLock mutex;   // Protects running
 };
 
 // Can be either stack or heap allocated
 struct House {
-    struct Room rooms[MAX_ROOMS];
+    int run_id;             // Batch run index, -1 for the interactive hunt (used to separate logs)
+    bool virtual_clock;     // True while the discrete-event engine drives the hunt (see des.c)
+    long long clock_base_ms;    // Wall clock (ms) when the house was set up
+    long long virtual_now;      // Simulated ms since clock_base_ms, used for log timestamps
+    uint64_t seed;          // Master seed; with run_id it fixes every random choice of the hunt
+    struct RandStream rng;  // Stream for setting the house up (ghost type and room)
+    struct Room* rooms;     // room_count rooms, sized by the layout
     int room_count;
+    // Connections in compressed sparse row form: the neighbours of room r are the room
+    // indices room_neighbours[room_offsets[r]] up to room_neighbours[room_offsets[r + 1] - 1]
+    int* room_offsets;
+    int* room_neighbours;
     struct Room* starting_room; // Needed by house_populate_rooms, but can be adjusted to suit your needs.
-    struct Hunter* hunters[MAX_HUNTERS]; 
+    struct Hunter** hunters;    // Grows as hunters are added
     int hunter_count;
+    int hunter_capacity;
     struct Ghost* ghost;
     struct CaseFile case_file;
 };
 
-struct RoomNode {
-    struct Room* room;
-    struct RoomNode* next;
+// Breadcrumb trail of a hunter: room indices in one growable array, so moving never allocates
+struct PathStack {
+    int* rooms;         // Indices into house->rooms, oldest first
+    int count;
+    int capacity;
 };
 
 struct Hunter {
@@ -119,31 +134,69 @@ struct Hunter {
     int fear;
     int boredom;
     struct CaseFile* case_file;
-    struct RoomNode* path_stack; 
+    struct PathStack path_stack; 
+    struct Hunter* room_prev;     // Neighbours in the list of hunters of the current room
+    struct Hunter* room_next;
     bool running; 
     bool return_to_van; 
+    struct RandStream rng;        // This hunter's own random stream (see rng.h)
+    int steps;                    // Number of loop iterations this hunter has taken
+    enum LogReason exit_reason;   // Why the hunter left (only valid once running is false)
+};
+
+// How a hunt is driven: real threads that sleep between turns, the discrete-event engine,
+// or a fixed pool of workers that steps every hunter and ghost (see pool.h)
+enum SimEngine {
+    ENGINE_THREADS = 0,
+    ENGINE_DES     = 1,
+    ENGINE_POOL    = 2
+};
+
+// Summary of a single finished hunt, used by the batch runner
+struct HuntResult {
+    bool won;
+    enum GhostType ghost_type;
+    EvidenceByte collected;
+    int exits[3];       // Hunter exits indexed by LogReason
+    int length;         // Longest hunter step count, used as the hunt length
+    long long steps;    // Turns taken by every hunter and the ghost
 };
 
 /* The provided `house_populate_rooms()` function requires the following functions.
    You are free to rename them and change their parameters and modify house_populate_rooms()
    as needed as long as the house has the correct rooms and connections after calling it.
+   (Rooms and connections are now built from a HouseMap, see map.h.)
 */
 
 void room_init(struct Room* room, const char* name, bool is_exit);
-void room_connect(struct Room* a, struct Room* b);
+int room_degree(const struct Room* room);
+struct Room* room_neighbour(const struct Room* room, int index);
 void room_add_hunter(struct Room* room, struct Hunter* hunter);
 void room_remove_hunter(struct Room* room, struct Hunter* hunter);
 
-struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct CaseFile* cf);
+struct HouseMap;
+void house_init(struct House* house, const struct HouseMap* map, int run_id, uint64_t seed);
+struct Hunter* house_add_hunter(struct House* house, char* name, int id);
+void house_run(struct House* house);
+void house_run_des(struct House* house);
+void house_run_pool(struct House* house, int workers);
+void house_get_result(struct House* house, struct HuntResult* result);
+void house_cleanup(struct House* house);
+
+struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct CaseFile* cf, const struct RandStream* rng);
 void hunter_destroy(struct Hunter* h);
+bool hunter_step(struct Hunter* h);
 void* hunter_thread(void* arg);
 
-struct Ghost* ghost_create(int id, enum GhostType type, struct Room* start_room);
+struct Ghost* ghost_create(int id, enum GhostType type, struct Room* start_room, const struct RandStream* rng);
 void ghost_destroy(struct Ghost* g);
+bool ghost_step(struct Ghost* g);
 void* ghost_thread(void* arg);
 
-void stack_push(struct RoomNode** head, struct Room* room);
-struct Room* stack_pop(struct RoomNode** head);
-void stack_clean(struct RoomNode** head);
+void stack_init(struct PathStack* stack, int capacity);
+void stack_push(struct PathStack* stack, struct Room* room);
+struct Room* stack_pop(struct PathStack* stack, struct House* house);
+void stack_clear(struct PathStack* stack);
+void stack_free(struct PathStack* stack);
 
 #endif // DEFS_H
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "defs.h"
+#include "helpers.h"
+#include "snapshot.h"
+
+/*
+    Discrete-event engine: runs a whole hunt on the calling thread in virtual time.
+
+    Every hunter and the ghost has exactly one pending "take a turn" event in a min-heap
+    ordered by (time, sequence). Popping an event advances the virtual clock and runs one
+    hunter_step()/ghost_step(); if the entity is still in the hunt its next turn is scheduled
+    one period later. The periods match the usleep() calls of the threaded engine, so the
+    ghost still gets ten turns for every hunter turn, but nothing ever sleeps.
+
+    Between two turns the queue and the House are the whole state of the hunt, which is
+    where house_run_des_until() takes a snapshot and house_resume_des() picks one up.
+*/
+
+#define DES_HUNTER_PERIOD 10    // ms, same as usleep(10000) in hunter_thread
+#define DES_GHOST_PERIOD 1      // ms, same as usleep(1000) in ghost_thread
+#define DES_GHOST -1            // Entity index used for the ghost
+
+struct DesEvent {
+    long long time;     // Virtual ms since the hunt started
+    long long seq;      // Breaks ties in scheduling order, keeps runs reproducible
+    int entity;         // Index in house->hunters, or DES_GHOST
+};
+
+struct DesQueue {
+    struct DesEvent* heap;
+    int count;
+    long long next_seq;
+};
+
+static bool des_before(const struct DesEvent* a, const struct DesEvent* b) {
+    if (a->time != b->time) {
+        return a->time < b->time;
+    }
+    return a->seq < b->seq;
+}
+
+/**
+ * @brief Adds an event that already has its sequence number
+ *
+ * @param queue Pointer to the DesQueue (the heap always has room: one pending event per entity)
+ * @param event The event
+ */
+static void des_insert(struct DesQueue* queue, struct DesEvent event) {
+    int i = queue->count++;
+
+    // sift up
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!des_before(&event, &queue->heap[parent])) {
+            break;
+        }
+        queue->heap[i] = queue->heap[parent];
+        i = parent;
+    }
+    queue->heap[i] = event;
+}
+
+/**
+ * @brief Schedules a turn
+ *
+ * @param queue Pointer to the DesQueue
+ * @param time Virtual time of the turn
+ * @param entity Hunter index or DES_GHOST
+ */
+static void des_push(struct DesQueue* queue, long long time, int entity) {
+    struct DesEvent event = {time, queue->next_seq++, entity};
+    des_insert(queue, event);
+}
+
+/**
+ * @brief Removes the earliest turn
+ *
+ * @param queue Pointer to the DesQueue (must not be empty)
+ * @return The earliest event
+ */
+static struct DesEvent des_pop(struct DesQueue* queue) {
+    struct DesEvent top = queue->heap[0];
+    struct DesEvent last = queue->heap[--queue->count];
+
+    // sift down
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1 < queue->count && des_before(&queue->heap[child + 1], &queue->heap[child])) {
+            child++;
+        }
+        if (!des_before(&queue->heap[child], &last)) {
+            break;
+        }
+        queue->heap[i] = queue->heap[child];
+        i = child;
+    }
+    queue->heap[i] = last;
+    return top;
+}
+
+/**
+ * @brief Allocates the queue and switches the house to the virtual clock
+ *
+ * @param house Pointer to the House
+ * @param queue Pointer to the DesQueue to set up
+ * @param now Virtual time to start from
+ * @return true on success, false if out of memory
+ */
+static bool des_open(struct House* house, struct DesQueue* queue, long long now) {
+    queue->heap = malloc(sizeof(struct DesEvent) * (house->hunter_count + 1));
+    queue->count = 0;
+    queue->next_seq = 0;
+    if (!queue->heap) {
+        return false;
+    }
+
+    // restart the clock base so virtual times never come before the INIT events
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    house->clock_base_ms = (long long)tv.tv_sec * 1000LL + (long long)tv.tv_usec / 1000LL - now;
+    house->virtual_clock = true;
+    house->virtual_now = now;
+    return true;
+}
+
+/**
+ * @brief Takes turns until every hunter is out, or until a trigger fires
+ *
+ * @param house Pointer to the House
+ * @param queue Pointer to the DesQueue with every pending turn
+ * @param trigger When to stop early, NULL to run the hunt to the end
+ * @param snapshot Filled when the trigger fires
+ * @return 1 if the trigger fired, 0 once the hunt is over, -1 if the snapshot could not be taken
+ */
+static int des_loop(struct House* house, struct DesQueue* queue, const struct SnapshotTrigger* trigger, struct HuntSnapshot* snapshot) {
+    int hunters_left = 0;
+    for (int i = 0; i < queue->count; i++) {
+        if (queue->heap[i].entity != DES_GHOST) {
+            hunters_left++;
+        }
+    }
+
+    while (queue->count > 0 && hunters_left > 0) {
+        struct DesEvent event = des_pop(queue);
+        house->virtual_now = event.time;
+
+        if (event.entity == DES_GHOST) {
+            if (ghost_step(house->ghost)) {
+                des_push(queue, event.time + DES_GHOST_PERIOD, DES_GHOST);
+            }
+        } else if (hunter_step(house->hunters[event.entity])) {
+            des_push(queue, event.time + DES_HUNTER_PERIOD, event.entity);
+        } else {
+            hunters_left--;
+        }
+
+        if (trigger && hunters_left > 0 && snapshot_trigger_hit(trigger, house)) {
+            struct SnapshotTurn* turns = malloc(sizeof(struct SnapshotTurn) * (queue->count + 1));
+            if (!turns) {
+                return -1;
+            }
+            for (int i = 0; i < queue->count; i++) {
+                struct SnapshotTurn turn = {queue->heap[i].time, queue->heap[i].seq, queue->heap[i].entity, 0};
+                turns[i] = turn;
+            }
+            int status = snapshot_capture(house, turns, queue->count, queue->next_seq, snapshot);
+            free(turns);
+            return status == 0 ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Stops the ghost just like house_run does and leaves the virtual clock
+ *
+ * @param house Pointer to the House
+ * @param queue Pointer to the DesQueue to free
+ */
+static void des_close(struct House* house, struct DesQueue* queue) {
+    lock_acquire(&house->ghost->mutex);
+    house->ghost->running = false;
+    lock_release(&house->ghost->mutex);
+
+    house->virtual_clock = false;
+    free(queue->heap);
+}
+
+/**
+ * @brief Runs one hunt to completion on the calling thread, in virtual time
+ *
+ * @param house Pointer to the House (already set up with hunters)
+ */
+void house_run_des(struct House* house) {
+    house_run_des_until(house, NULL, NULL);
+}
+
+int house_run_des_until(struct House* house, const struct SnapshotTrigger* trigger, struct HuntSnapshot* snapshot) {
+    struct DesQueue queue;
+    if (!des_open(house, &queue, 0)) {
+        return -1;
+    }
+
+    // same start order as house_run: ghost first, then the hunters
+    des_push(&queue, 0, DES_GHOST);
+    for (int i = 0; i < house->hunter_count; i++) {
+        des_push(&queue, 0, i);
+    }
+
+    int status = des_loop(house, &queue, trigger, snapshot);
+    des_close(house, &queue);
+    return status;
+}
+
+int house_resume_des(struct House* house, const struct HuntSnapshot* snapshot) {
+    struct DesQueue queue;
+    if (!des_open(house, &queue, snapshot->virtual_now)) {
+        return -1;
+    }
+
+    // the original sequence numbers, so ties break exactly as they would have
+    for (int i = 0; i < snapshot->turn_count; i++) {
+        struct DesEvent event = {snapshot->turns[i].time, snapshot->turns[i].seq, snapshot->turns[i].entity};
+        des_insert(&queue, event);
+    }
+    queue.next_seq = snapshot->next_seq;
+
+    des_loop(house, &queue, NULL, NULL);
+    des_close(house, &queue);
+    return 0;
+}
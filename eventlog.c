@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "helpers.h"
+#include "eventlog.h"
+
+const char* log_action_to_string(enum LogAction action) {
+    switch (action) {
+        case LOG_ACTION_INIT:
+            return "INIT";
+        case LOG_ACTION_MOVE:
+            return "MOVE";
+        case LOG_ACTION_EVIDENCE:
+            return "EVIDENCE";
+        case LOG_ACTION_SWAP:
+            return "SWAP";
+        case LOG_ACTION_EXIT:
+            return "EXIT";
+        case LOG_ACTION_IDLE:
+            return "IDLE";
+        case LOG_ACTION_RETURN_START:
+            return "RETURN_START";
+        case LOG_ACTION_RETURN_COMPLETE:
+            return "RETURN_COMPLETE";
+        default:
+            return "";
+    }
+}
+
+const char* log_entity_type_to_string(enum LogEntityType type) {
+    switch (type) {
+        case LOG_ENTITY_HUNTER:
+            return "hunter";
+        case LOG_ENTITY_GHOST:
+            return "ghost";
+        default:
+            return "unknown";
+    }
+}
+
+int log_event_write_csv(FILE* out, const struct LogEvent* event, const char* room, const char* extra_room, const char* name, bool order_columns) {
+    bool is_hunter = (event->entity_type == LOG_ENTITY_HUNTER);
+    const char* device = is_hunter ? evidence_to_string(event->device) : "";
+    const char* extra = "";
+    char swap_text[64];
+
+    // rebuild the extra column from the action specific code
+    switch (event->action) {
+        case LOG_ACTION_INIT:
+            extra = is_hunter ? name : ghost_to_string(event->extra);
+            break;
+        case LOG_ACTION_MOVE:
+            extra = extra_room;
+            break;
+        case LOG_ACTION_EVIDENCE:
+            extra = evidence_to_string(event->extra);
+            break;
+        case LOG_ACTION_SWAP:
+            snprintf(swap_text, sizeof(swap_text), "%s->%s",
+                     evidence_to_string((event->extra >> 8) & 0xFF),
+                     evidence_to_string(event->extra & 0xFF));
+            extra = swap_text;
+            break;
+        case LOG_ACTION_EXIT:
+            extra = is_hunter ? exit_reason_to_string(event->extra) : "";
+            break;
+        case LOG_ACTION_RETURN_START:
+            extra = "start";
+            break;
+        case LOG_ACTION_RETURN_COMPLETE:
+            extra = "complete";
+            break;
+        default:
+            break;
+    }
+
+    if (order_columns) {
+        return fprintf(out,
+                       "%lld,%s,%d,%s,%s,%d,%d,%s,%s,%llu,%lld\n",
+                       (long long)event->timestamp,
+                       log_entity_type_to_string(event->entity_type),
+                       event->entity_id,
+                       room ? room : "",
+                       device,
+                       event->boredom,
+                       event->fear,
+                       log_action_to_string(event->action),
+                       extra ? extra : "",
+                       (unsigned long long)event->sequence,
+                       (long long)event->monotonic_ns);
+    }
+    return fprintf(out,
+                   "%lld,%s,%d,%s,%s,%d,%d,%s,%s\n",
+                   (long long)event->timestamp,
+                   log_entity_type_to_string(event->entity_type),
+                   event->entity_id,
+                   room ? room : "",
+                   device,
+                   event->boredom,
+                   event->fear,
+                   log_action_to_string(event->action),
+                   extra ? extra : "");
+}
+
+void log_header_init(struct LogFileHeader* header, enum LogEntityType entity_type, int entity_id, const char* name) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, LOG_BINARY_MAGIC, sizeof(header->magic));
+    header->version = LOG_BINARY_VERSION;
+    header->record_size = sizeof(struct LogEvent);
+    header->entity_type = entity_type;
+    header->entity_id = entity_id;
+    if (name) {
+        strncpy(header->name, name, MAX_HUNTER_NAME - 1);
+    }
+}
+
+bool log_header_is_valid(const struct LogFileHeader* header) {
+    return memcmp(header->magic, LOG_BINARY_MAGIC, sizeof(header->magic)) == 0
+        && header->version == LOG_BINARY_VERSION
+        && header->record_size == sizeof(struct LogEvent);
+}
+
+int log_room_table_load(const char* path, struct LogRoomTable* table) {
+    table->names = NULL;
+    table->count = 0;
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    uint32_t capacity = 0;
+    char line[MAX_ROOM_NAME + 2];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (table->count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            char** grown = realloc(table->names, sizeof(char*) * capacity);
+            if (!grown) {
+                fclose(file);
+                return -1;
+            }
+            table->names = grown;
+        }
+        table->names[table->count++] = strdup(line);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void log_room_table_free(struct LogRoomTable* table) {
+    for (uint32_t i = 0; i < table->count; i++) {
+        free(table->names[i]);
+    }
+    free(table->names);
+    table->names = NULL;
+    table->count = 0;
+}
+
+const char* log_room_table_name(const struct LogRoomTable* table, uint32_t index) {
+    if (index == LOG_NO_ROOM || index >= table->count) {
+        return NULL;
+    }
+    return table->names[index];
+}
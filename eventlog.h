@@ -0,0 +1,140 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "defs.h"
+
+/*
+    Event log formats shared by the simulation (helpers.c) and the log_export tool.
+
+    CSV:    log_<id>.csv, one "timestamp,type,id,room,device,boredom,fear,action,extra" line per event,
+            plus ",seq,mono_ns" at the end of every line when order columns are on (--log-order).
+    Binary: log_<id>.bin, a LogFileHeader followed by fixed size LogEvent records, plus one
+            log_rooms.txt per hunt listing the room names by index (one per line).
+
+    Every event gets a sequence number from one process-wide counter when it is logged, which
+    orders events exactly where millisecond timestamps tie (and across threads), and a
+    CLOCK_MONOTONIC timestamp in nanoseconds.
+*/
+
+#define LOG_BINARY_MAGIC "GHLB"
+#define LOG_BINARY_VERSION 2    // 2: sequence and monotonic_ns added
+#define LOG_ROOMS_FILE "log_rooms.txt"
+#define LOG_NO_ROOM UINT32_MAX
+
+enum LogEntityType {
+    LOG_ENTITY_HUNTER = 0,
+    LOG_ENTITY_GHOST = 1
+};
+
+enum LogAction {
+    LOG_ACTION_INIT = 0,
+    LOG_ACTION_MOVE,
+    LOG_ACTION_EVIDENCE,
+    LOG_ACTION_SWAP,
+    LOG_ACTION_EXIT,
+    LOG_ACTION_IDLE,
+    LOG_ACTION_RETURN_START,
+    LOG_ACTION_RETURN_COMPLETE,
+    LOG_ACTION_COUNT
+};
+
+// One event, exactly as stored in a binary log
+struct LogEvent {
+    uint64_t sequence;      // Process-wide order in which events were logged
+    int64_t  monotonic_ns;  // CLOCK_MONOTONIC when the event was logged
+    int64_t  timestamp;     // Milliseconds since the epoch (virtual with --engine des)
+    int32_t  entity_id;
+    uint32_t room;          // Room index, LOG_NO_ROOM when the event has no room
+    uint32_t extra;         // Action specific: MOVE = destination room, EVIDENCE = evidence bit,
+                            // SWAP = (from << 8) | to, hunter EXIT = LogReason, ghost INIT = GhostType
+    int16_t  boredom;
+    int16_t  fear;
+    uint8_t  entity_type;   // LogEntityType
+    uint8_t  device;        // EvidenceType the hunter carries, 0 for the ghost
+    uint8_t  action;        // LogAction
+    uint8_t  reserved;
+};
+
+// Start of every binary log file
+struct LogFileHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t record_size;   // sizeof(struct LogEvent) when the file was written
+    int32_t  entity_type;
+    int32_t  entity_id;
+    char     name[MAX_HUNTER_NAME];  // Hunter name (the INIT extra), empty for the ghost
+};
+
+/**
+ * @brief Return the action token used in the CSV logs.
+ * @param[in] action LogAction value.
+ * @return Static string such as "MOVE"; "" when out of range.
+ */
+const char* log_action_to_string(enum LogAction action);
+
+/**
+ * @brief Return the entity token used in the CSV logs.
+ * @param[in] type LogEntityType value.
+ * @return "hunter", "ghost" or "unknown".
+ */
+const char* log_entity_type_to_string(enum LogEntityType type);
+
+/**
+ * @brief Write one event as a CSV line.
+ * @param[in] out Destination stream.
+ * @param[in] event Event to format.
+ * @param[in] room Name of event->room, NULL when there is none.
+ * @param[in] extra_room Name of the destination room for MOVE events, otherwise ignored.
+ * @param[in] name Hunter name for INIT events, otherwise ignored.
+ * @param[in] order_columns Append the seq and mono_ns columns.
+ * @return Result of fprintf().
+ */
+int log_event_write_csv(FILE* out, const struct LogEvent* event, const char* room, const char* extra_room, const char* name, bool order_columns);
+
+/**
+ * @brief Fill in a binary log header.
+ * @param[out] header Header to fill.
+ * @param[in] entity_type LogEntityType of the file's entity.
+ * @param[in] entity_id Entity identifier.
+ * @param[in] name Hunter name or NULL.
+ */
+void log_header_init(struct LogFileHeader* header, enum LogEntityType entity_type, int entity_id, const char* name);
+
+/**
+ * @brief Check that a header was written by a compatible version of the simulation.
+ * @param[in] header Header read from a file.
+ * @return true when the magic, version and record size match.
+ */
+bool log_header_is_valid(const struct LogFileHeader* header);
+
+// Room names of one hunt, read back from its log_rooms.txt
+struct LogRoomTable {
+    char** names;
+    uint32_t count;
+};
+
+/**
+ * @brief Load the room names of a hunt, one per line in index order.
+ * @param[in] path Path to log_rooms.txt.
+ * @param[out] table Table to fill; free it with log_room_table_free() even on failure.
+ * @return 0 on success, -1 if the file could not be read.
+ */
+int log_room_table_load(const char* path, struct LogRoomTable* table);
+
+/**
+ * @brief Free the names of a room table.
+ * @param[in,out] table Table filled by log_room_table_load().
+ */
+void log_room_table_free(struct LogRoomTable* table);
+
+/**
+ * @brief Look up a room name.
+ * @param[in] table Room names of the hunt.
+ * @param[in] index Room index of an event.
+ * @return The name, NULL for LOG_NO_ROOM or an index outside the table.
+ */
+const char* log_room_table_name(const struct LogRoomTable* table, uint32_t index);
+
+#endif // EVENTLOG_H
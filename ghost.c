@@ -3,6 +3,7 @@
 #include <unistd.h>
 #include "defs.h"
 #include "helpers.h"
+#include "check.h"
 
 /**
  * @brief Inits a new ghost struct
@@ -10,19 +11,23 @@
  * @param id Ghost ID
  * @param type Type of ghost
  * @param start_room Ghost starting room pointer
+ * @param rng The ghost's random stream (copied)
  * @return Pointer to the new Ghost struct
  */
-struct Ghost* ghost_create(int id, enum GhostType type, struct Room* start_room) {
+struct Ghost* ghost_create(int id, enum GhostType type, struct Room* start_room, const struct RandStream* rng) {
     struct Ghost* g = malloc(sizeof(struct Ghost));
     g->id = id;
     g->type = type;
     g->room = start_room;
     g->boredom = 0;
     g->running = true;
-    sem_init(&g->mutex, 0, 1);
+    g->rng = *rng;
+    g->steps = 0;
+    lock_init(&g->mutex);
+    lock_set_name(&g->mutex, "Ghost");
     
     g->room->ghost = g;
-    log_ghost_init(id, start_room->name, type);
+    log_ghost_init(id, start_room, type);
     return g;
 }
 
@@ -32,107 +37,119 @@ struct Ghost* ghost_create(int id, enum GhostType type, struct Room* start_room)
  * @param g Pointer to the Ghost
  */
 void ghost_destroy(struct Ghost* g) {
-    sem_destroy(&g->mutex); 
+    lock_destroy(&g->mutex); 
     free(g);
 }
 
 /**
- * @brief The thread function for a ghost. Handles changing the boredom, dropping evidence, 
+ * @brief One turn of a ghost. Handles changing the boredom, dropping evidence, 
  * moving from room to room, and leaving when boredom goes over the limit
  *
- * @param arg Void pointer to the Ghost struct, casted to Ghost immediately
- * @return NULL after thread is over
+ * @param g Pointer to the Ghost
+ * @return true if the ghost is still haunting, false once it has stopped or left
  */
-void* ghost_thread(void* arg) {
-    struct Ghost* g = (struct Ghost*)arg;
+bool ghost_step(struct Ghost* g) {
+	// first check if we should keep running
+	lock_acquire(&g->mutex);
+    bool cont = g->running;
+    lock_release(&g->mutex);
+    
+    // bbreak out of loop if we're done
+    if (!cont) {
+    	return false;
+    }
+    struct Room* curr = g->room;
+    g->steps++;
+    int boredom_before = g->boredom;
+    	
+    // lock room (in case hunter is entering/leaving)
+    lock_acquire(&curr->mutex);
+    
+    bool hunters_seen = (curr->num_hunters > 0);
+    if (hunters_seen) {
+        g->boredom = 0;
+    } else {
+        g->boredom++;
+    }
+    if (check_enabled) {
+        check_ghost_senses(g, boredom_before);
+    }
+    lock_release(&curr->mutex);
 
-    while (1) {
-    	// first check if we should keep running
-    	sem_wait(&g->mutex);
-        bool cont = g->running;
-        sem_post(&g->mutex);
-        
-        // bbreak out of loop if we're done
-        if (!cont) {
-        	break;
-        }
-        struct Room* curr = g->room;
-        	
-        // lock room (in case hunter is entering/leaving)
-        sem_wait(&curr->mutex);
-        
-        if (curr->num_hunters > 0) {
-            g->boredom = 0;
-            sem_post(&curr->mutex);
-        } else {
-            g->boredom++;
-            sem_post(&curr->mutex);
-        }
+	// if bored
+    if (g->boredom >= ENTITY_BOREDOM_MAX) {
+        lock_acquire(&g->mutex);
+        g->running = false;
+        lock_release(&g->mutex);
+
+        // logged under the room lock so its sequence number orders it against the hunters there
+        lock_acquire(&curr->mutex);
+        curr->ghost = NULL; 
+        log_ghost_exit(g->id, g->boredom, curr);
+        lock_release(&curr->mutex);
+        return false;
+    }
 
-		// if bored
-        if (g->boredom >= ENTITY_BOREDOM_MAX) {
-            sem_wait(&g->mutex);
-            g->running = false;
-            sem_post(&g->mutex);
+    int action = rand_stream_int(&g->rng, 0, 3); // 0 idle, 1 haunt, 2 move
 
-            sem_wait(&curr->mutex);
-            curr->ghost = NULL; 
-            sem_post(&curr->mutex);
-            log_ghost_exit(g->id, g->boredom, curr->name);
-            break;
+    if (action == 0) { 
+    	// do nothing
+        log_ghost_idle(g->id, g->boredom, curr); 
+    } 
+    else if (action == 1) {
+    	// haunt: leave one of the three evidence types of this ghost
+        int choice = evidence_table[g->type].bits[rand_stream_int(&g->rng, 0, 3)];
+        
+        // logged first and published with release, so a hunter that collects it logs after us
+        log_ghost_evidence(g->id, g->boredom, curr, choice);
+        atomic_fetch_or_explicit(&curr->evidence, (EvidenceByte)choice, memory_order_release);
+        if (check_enabled) {
+            check_ghost_evidence(g, curr, choice);
         }
+    }
+    else if (action == 2) {
+    	//move
+        lock_acquire(&curr->mutex);
+        bool hunter_present = (curr->num_hunters > 0);
+        lock_release(&curr->mutex);
 
-        int action = rand_int_threadsafe(0, 3); // 0 idle, 1 haunt, 2 move
+        if (!hunter_present) {
+            int r = rand_stream_int(&g->rng, 0, room_degree(curr));
+            struct Room* next = room_neighbour(curr, r);
+            
+            // move safely with deadlock prevention
+            struct Room *first = (curr < next) ? curr : next;
+            struct Room *second = (curr < next) ? next : curr;
 
-        if (action == 0) { 
-        	// do nothing
-            log_ghost_idle(g->id, g->boredom, curr->name); 
-        } 
-        else if (action == 1) {
-        	// haunt
-            int bits[3];
-            int count = 0;
-            for (int i = 0; i < 7; i++) {
-                if (g->type & (1 << i)) {
-                    bits[count++] = (1 << i);
-                }
-            }
-            int choice = bits[rand_int_threadsafe(0, 3)];
+            lock_acquire(&first->mutex);
+            lock_acquire(&second->mutex);
             
-            sem_wait(&curr->mutex);
-            curr->evidence |= choice;
-            sem_post(&curr->mutex);
+            curr->ghost = NULL;
+            next->ghost = g;
+            g->room = next;
+            if (check_enabled) {
+                check_ghost_move(g, curr, next);
+            }
+            log_ghost_move(g->id, g->boredom, curr, next);
             
-            log_ghost_evidence(g->id, g->boredom, curr->name, choice);
+            lock_release(&second->mutex);
+            lock_release(&first->mutex);
         }
-        else if (action == 2) {
-        	//move
-            sem_wait(&curr->mutex);
-            bool hunter_present = (curr->num_hunters > 0);
-            sem_post(&curr->mutex);
+    }
 
-            if (!hunter_present) {
-                int r = rand_int_threadsafe(0, curr->num_connected);
-                struct Room* next = curr->connected[r];
-                
-                // move safely with deadlock prevention
-                struct Room *first = (curr < next) ? curr : next;
-                struct Room *second = (curr < next) ? next : curr;
+    return true;
+}
 
-                sem_wait(&first->mutex);
-                sem_wait(&second->mutex);
-                
-                curr->ghost = NULL;
-                next->ghost = g;
-                g->room = next;
-                
-                sem_post(&second->mutex);
-                sem_post(&first->mutex);
+/**
+ * @brief The thread function for a ghost. Takes turns until the ghost is stopped or leaves
+ *
+ * @param arg Void pointer to the Ghost struct, casted to Ghost immediately
+ * @return NULL after thread is over
+ */
+void* ghost_thread(void* arg) {
+    struct Ghost* g = (struct Ghost*)arg;
 
-                log_ghost_move(g->id, g->boredom, curr->name, next->name);
-            }
-        }
-        
+    while (ghost_step(g)) {
         usleep(1000); 
     }
     return NULL;
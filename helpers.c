@@ -1,45 +1,54 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "helpers.h"
+#include "eventlog.h"
+#include "map.h"
 
 // ---- House layout ----
 void house_populate_rooms(struct House* house) {
     // Willow House layout from Phasmaphobia, DO NOT MODIFY HOUSE LAYOUT
-    house->room_count = 13;
-
-    room_init(house->rooms+0, "Van", true);
-    room_init(house->rooms+1, "Hallway", false);
-    room_init(house->rooms+2, "Master Bedroom", false);
-    room_init(house->rooms+3, "Boy's Bedroom", false);
-    room_init(house->rooms+4, "Bathroom", false);
-    room_init(house->rooms+5, "Basement", false);
-    room_init(house->rooms+6, "Basement Hallway", false);
-    room_init(house->rooms+7, "Right Storage Room", false);
-    room_init(house->rooms+8, "Left Storage Room", false);
-    room_init(house->rooms+9, "Kitchen", false);
-    room_init(house->rooms+10, "Living Room", false);
-    room_init(house->rooms+11, "Garage", false);
-    room_init(house->rooms+12, "Utility Room", false);
-
-    room_connect(house->rooms+0, house->rooms+1);    // Van - Hallway
-    room_connect(house->rooms+1, house->rooms+2);    // Hallway - Master Bedroom
-    room_connect(house->rooms+1, house->rooms+3);    // Hallway - Boy's Bedroom
-    room_connect(house->rooms+1, house->rooms+4);    // Hallway - Bathroom
-    room_connect(house->rooms+1, house->rooms+9);    // Hallway - Kitchen
-    room_connect(house->rooms+1, house->rooms+5);    // Hallway - Basement
-    room_connect(house->rooms+5, house->rooms+6);    // Basement - Basement Hallway
-    room_connect(house->rooms+6, house->rooms+7);    // Basement Hallway - Right Storage Room
-    room_connect(house->rooms+6, house->rooms+8);    // Basement Hallway - Left Storage Room
-    room_connect(house->rooms+9, house->rooms+10);   // Kitchen - Living Room
-    room_connect(house->rooms+9, house->rooms+11);   // Kitchen - Garage
-    room_connect(house->rooms+11, house->rooms+12);  // Garage - Utility Room
-
-    house->starting_room = house->rooms; // Van is at index 0
+    static struct MapRoom rooms[] = {
+        {"Van", true},
+        {"Hallway", false},
+        {"Master Bedroom", false},
+        {"Boy's Bedroom", false},
+        {"Bathroom", false},
+        {"Basement", false},
+        {"Basement Hallway", false},
+        {"Right Storage Room", false},
+        {"Left Storage Room", false},
+        {"Kitchen", false},
+        {"Living Room", false},
+        {"Garage", false},
+        {"Utility Room", false},
+    };
+    static int edges[][2] = {
+        {0, 1},     // Van - Hallway
+        {1, 2},     // Hallway - Master Bedroom
+        {1, 3},     // Hallway - Boy's Bedroom
+        {1, 4},     // Hallway - Bathroom
+        {1, 9},     // Hallway - Kitchen
+        {1, 5},     // Hallway - Basement
+        {5, 6},     // Basement - Basement Hallway
+        {6, 7},     // Basement Hallway - Right Storage Room
+        {6, 8},     // Basement Hallway - Left Storage Room
+        {9, 10},    // Kitchen - Living Room
+        {9, 11},    // Kitchen - Garage
+        {11, 12},   // Garage - Utility Room
+    };
+    const struct HouseMap willow = {rooms, 13, edges, 12};
+
+    house_map_apply(&willow, house); // Van is at index 0, so it is the starting room
 }
 
 // ---- to_string functions ----
@@ -187,371 +196,1002 @@ int get_all_ghost_types(const enum GhostType** list) {
 }
 
 // ---- Thread-safe random number generation ----
+// The simulation itself draws from per-entity streams (rng.h); this is a convenience
+// for everything else, with its own stream per thread.
 int rand_int_threadsafe(int lower_inclusive, int upper_exclusive) {
-    static _Thread_local unsigned seed = 0;
+    static _Thread_local struct RandStream stream;
+    static _Thread_local bool seeded = false;
 
-    if (upper_exclusive <= lower_inclusive) {
-        return lower_inclusive;
+    if (!seeded) {
+        rand_stream_init(&stream, rand_fresh_seed(), 0, (uint32_t)(uintptr_t)pthread_self());
+        seeded = true;
     }
 
-    if (seed == 0) {
-        seed = (unsigned)time(NULL) ^ (unsigned)(uintptr_t)pthread_self();
-        if (seed == 0) {
-            seed = 0xA5A5A5A5u;
-        }
-    }
-
-    unsigned span = (unsigned)(upper_exclusive - lower_inclusive);
-    unsigned value = (unsigned)rand_r(&seed) % span;
-    return lower_inclusive + (int)value;
+    return rand_stream_int(&stream, lower_inclusive, upper_exclusive);
 }
 
 // ---- Evidence helpers ----
+// The table is spelled out by the preprocessor, one row per mask, so nothing runs at startup.
+#define EV_LOWEST(m)    ((m) & (~(m) + 1u))     // lowest set bit
+#define EV_DROP(m)      ((m) & ((m) - 1u))      // mask without its lowest set bit
+#define EV_COUNT(m)     (((m) & 1u) + ((m) >> 1 & 1u) + ((m) >> 2 & 1u) + ((m) >> 3 & 1u) + \
+                         ((m) >> 4 & 1u) + ((m) >> 5 & 1u) + ((m) >> 6 & 1u))
+#define EV_IS_GHOST(m)  ((m) == GH_POLTERGEIST || (m) == GH_THE_MIMIC || (m) == GH_HANTU || \
+                         (m) == GH_JINN || (m) == GH_PHANTOM || (m) == GH_BANSHEE || \
+                         (m) == GH_GORYO || (m) == GH_BULLIES || (m) == GH_MYLING || \
+                         (m) == GH_OBAKE || (m) == GH_YUREI || (m) == GH_ONI || \
+                         (m) == GH_MOROI || (m) == GH_REVENANT || (m) == GH_SHADE || \
+                         (m) == GH_ONRYO || (m) == GH_THE_TWINS || (m) == GH_DEOGEN || \
+                         (m) == GH_THAYE || (m) == GH_YOKAI || (m) == GH_WRAITH || \
+                         (m) == GH_RAIJU || (m) == GH_MARE || (m) == GH_SPIRIT)
+#define EV_ROW(m)       {EV_COUNT(m), EV_IS_GHOST(m), {EV_LOWEST(m), EV_LOWEST(EV_DROP(m)), EV_LOWEST(EV_DROP(EV_DROP(m)))}}
+#define EV_ROW4(m)      EV_ROW(m), EV_ROW((m) + 1u), EV_ROW((m) + 2u), EV_ROW((m) + 3u)
+#define EV_ROW16(m)     EV_ROW4(m), EV_ROW4((m) + 4u), EV_ROW4((m) + 8u), EV_ROW4((m) + 12u)
+#define EV_ROW64(m)     EV_ROW16(m), EV_ROW16((m) + 16u), EV_ROW16((m) + 32u), EV_ROW16((m) + 48u)
+
+const struct EvidenceInfo evidence_table[EVIDENCE_MASK_COUNT] = { EV_ROW64(0u), EV_ROW64(64u) };
+
 bool evidence_is_valid_ghost(EvidenceByte mask) {
-    const enum GhostType* ghost_types = NULL;
-    int ghost_count = get_all_ghost_types(&ghost_types);
+    return evidence_table[mask & (EVIDENCE_MASK_COUNT - 1)].is_ghost;
+}
+
+// ---- Logging (Writes CSV logs, DO NOT MODIFY the file outputs: timestamp,type,id,room,device,boredom,fear,action,extra) ----
+
+// In-memory form of one event: the on-disk event plus what is needed to turn it back into text
+struct LogRecord {
+    struct LogEvent     event;
+    const struct House* house;  // Hunt the event belongs to (room names, run id)
+    const char*         name;   // Hunter name for INIT events
+};
+
+// Where log_* output goes; only changed before any hunt threads start
+static int log_outputs = LOG_OUTPUT_CSV | LOG_OUTPUT_CONSOLE;
+static const char* log_directory = NULL;
+static bool log_order_columns = false;
+
+// Next event's sequence number, shared by every hunt of the process
+static atomic_ullong log_sequence;
+
+void log_set_outputs(int outputs) {
+    log_outputs = outputs;
+}
+
+void log_set_order_columns(bool enabled) {
+    log_order_columns = enabled;
+}
+
+void log_set_directory(const char* directory) {
+    log_directory = directory;
+}
+
+// Event filter (--log-filter): per entity type and action, 0 = drop, 1 = keep, N = keep one in N
+#define LOG_ENTITY_TYPES 2
+static bool log_filter_active = false;
+static unsigned log_filter_every[LOG_ENTITY_TYPES][LOG_ACTION_COUNT];
+static atomic_ulong log_filter_seen[LOG_ENTITY_TYPES][LOG_ACTION_COUNT];    // Only counted for filtered kinds
+
+/**
+ * @brief Whether an event is logged at all; the first check of every log_* function
+ *
+ * Unfiltered kinds cost a table lookup, filtered ones one relaxed counter increment,
+ * and nothing is built, stamped or formatted for the events that are left out.
+ *
+ * @param type Entity type of the event
+ * @param action Action of the event
+ * @return true if the event should be written
+ */
+static inline bool log_wanted(enum LogEntityType type, enum LogAction action) {
+    if (!log_outputs) {
+        return false;
+    }
+    if (!log_filter_active) {
+        return true;
+    }
+    unsigned every = log_filter_every[type][action];
+    if (every == 1) {
+        return true;
+    }
+    unsigned long seen = atomic_fetch_add_explicit(&log_filter_seen[type][action], 1, memory_order_relaxed);
+    return every != 0 && seen % every == 0;
+}
 
-    for (int index = 0; index < ghost_count; index++) {
-        if (mask == (EvidenceByte)ghost_types[index]) {
+/**
+ * @brief Finds the entity types or actions a filter rule names
+ *
+ * @param token Rule part, "*" for all
+ * @param count Number of values
+ * @param to_string Turns a value into its CSV token
+ * @param first Receives the first matching value
+ * @param last Receives the last matching value
+ * @return true if the token names a value
+ */
+static bool log_filter_range(const char* token, int count, const char* (*to_string)(int), int* first, int* last) {
+    if (strcmp(token, "*") == 0) {
+        *first = 0;
+        *last = count - 1;
+        return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (strcmp(token, to_string(i)) == 0) {
+            *first = *last = i;
             return true;
         }
     }
-
     return false;
 }
 
-// ---- Logging (Writes CSV logs, DO NOT MODIFY the file outputs: timestamp,type,id,room,device,boredom,fear,action,extra) ----
+static const char* log_filter_type_name(int type) {
+    return log_entity_type_to_string((enum LogEntityType)type);
+}
+
+static const char* log_filter_action_name(int action) {
+    return log_action_to_string((enum LogAction)action);
+}
+
+int log_set_filter(const char* spec, char* error, size_t error_size) {
+    char buffer[256];
+    if (strlen(spec) >= sizeof(buffer)) {
+        snprintf(error, error_size, "filter too long");
+        return -1;
+    }
+    strcpy(buffer, spec);
+
+    unsigned every[LOG_ENTITY_TYPES][LOG_ACTION_COUNT];
+    for (int type = 0; type < LOG_ENTITY_TYPES; type++) {
+        for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+            every[type][action] = 1;
+        }
+    }
+
+    // rules apply in order, so "*:*=0,*:EXIT" keeps only exits
+    for (char* item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        unsigned long value = 1;
+        char* rate = strchr(item, '=');
+        if (rate) {
+            *rate++ = '\0';
+            char* end;
+            value = strtoul(rate, &end, 10);
+            if (*rate == '\0' || *end != '\0' || value > 1000000000UL) {
+                snprintf(error, error_size, "invalid rate \"%s\" (0 drops, N keeps one in N)", rate);
+                return -1;
+            }
+        }
+        char* action = strchr(item, ':');
+        if (!action) {
+            snprintf(error, error_size, "\"%s\" is not type:ACTION[=N]", item);
+            return -1;
+        }
+        *action++ = '\0';
+
+        int first_type, last_type, first_action, last_action;
+        if (!log_filter_range(item, LOG_ENTITY_TYPES, log_filter_type_name, &first_type, &last_type)) {
+            snprintf(error, error_size, "unknown entity type \"%s\" (hunter, ghost or *)", item);
+            return -1;
+        }
+        if (!log_filter_range(action, LOG_ACTION_COUNT, log_filter_action_name, &first_action, &last_action)) {
+            snprintf(error, error_size, "unknown action \"%s\" (INIT, MOVE, EVIDENCE, SWAP, EXIT, IDLE, RETURN_START, RETURN_COMPLETE or *)", action);
+            return -1;
+        }
+        for (int type = first_type; type <= last_type; type++) {
+            for (int a = first_action; a <= last_action; a++) {
+                every[type][a] = (unsigned)value;
+            }
+        }
+    }
+
+    log_filter_active = false;
+    for (int type = 0; type < LOG_ENTITY_TYPES; type++) {
+        for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+            log_filter_every[type][action] = every[type][action];
+            atomic_store(&log_filter_seen[type][action], 0);
+            if (every[type][action] != 1) {
+                log_filter_active = true;
+            }
+        }
+    }
+    return 0;
+}
+
+void log_filter_report(FILE* out) {
+    if (!log_filter_active) {
+        return;
+    }
+    for (int type = 0; type < LOG_ENTITY_TYPES; type++) {
+        for (int action = 0; action < LOG_ACTION_COUNT; action++) {
+            unsigned every = log_filter_every[type][action];
+            unsigned long seen = atomic_load(&log_filter_seen[type][action]);
+            if (every == 1 || seen == 0) {
+                continue;
+            }
+            unsigned long kept = every == 0 ? 0 : (seen + every - 1) / every;
+            fprintf(out, "Log filter: %s %s %lu of %lu suppressed",
+                    log_filter_type_name(type), log_filter_action_name(action), seen - kept, seen);
+            if (every == 0) {
+                fprintf(out, " (dropped)\n");
+            } else {
+                fprintf(out, " (1 in %u kept)\n", every);
+            }
+        }
+    }
+}
 
-// These enums are just for logging purposes, not needed elsewhere
-enum LogEntityType {
-    LOG_ENTITY_HUNTER = 0,
-    LOG_ENTITY_GHOST = 1
+static void log_console(const char* format, ...) {
+    if (!(log_outputs & LOG_OUTPUT_CONSOLE)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static uint32_t log_room_index(const struct Room* room) {
+    return room ? (uint32_t)room->id : LOG_NO_ROOM;
+}
+
+// ---- Buffered log writers ----
+// Each entity's log files are opened once and written through large stdio buffers,
+// which flush themselves whenever they fill up and are flushed for good by
+// log_close_run() / log_flush_all(). Writers are keyed by (run, entity) so that
+// concurrent batch hunts each get their own run_<n> directory.
+#define LOG_BUFFER_SIZE (256 * 1024)
+#define LOG_EVENT_CAP 100000    // Events per log file; a runaway entity cannot fill the disk
+
+struct LogWriter {
+    int   run_id;
+    int   entity_id;
+    long  events;       // Written so far, up to LOG_EVENT_CAP
+    FILE* csv;
+    FILE* binary;
+    char* csv_buffer;
+    char* binary_buffer;
 };
 
-struct LogRecord {
-    enum LogEntityType entity_type;
-    int                entity_id;
-    const char*        room;
-    const char*        device;
-    int                boredom;
-    int                fear;
-    const char*        action;
-    const char*        extra;
+static struct LogWriter** log_writers = NULL;   // Individually allocated so pointers stay valid
+static int log_writer_count = 0;
+static int log_writer_capacity = 0;
+static pthread_mutex_t log_writers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Only the writer thread looks writers up; it remembers the last one it used.
+// (run, entity) pairs are never reopened after log_close_run(), so the key alone is enough.
+static _Thread_local struct LogWriter* log_cached_writer = NULL;
+static _Thread_local int log_cached_run = 0;
+static _Thread_local int log_cached_entity = 0;
+
+static void log_run_directory(int run_id, char* path, size_t size) {
+    const char* base = log_directory ? log_directory : ".";
+    if (run_id < 0) {
+        snprintf(path, size, "%s", base);
+    } else {
+        snprintf(path, size, "%s/run_%d", base, run_id);
+    }
+}
+
+static FILE* log_open_buffered(const char* path, const char* mode, char** buffer) {
+    FILE* file = fopen(path, mode);
+    if (!file) {
+        return NULL;
+    }
+    *buffer = malloc(LOG_BUFFER_SIZE);
+    if (*buffer) {
+        setvbuf(file, *buffer, _IOFBF, LOG_BUFFER_SIZE);
+    }
+    return file;
+}
+
+static void log_write_room_table(const struct House* house, const char* directory) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", directory, LOG_ROOMS_FILE);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return;
+    }
+    for (int i = 0; i < house->room_count; i++) {
+        fprintf(file, "%s\n", house->rooms[i].name);
+    }
+    fclose(file);
+}
+
+static void log_writer_close(struct LogWriter* writer) {
+    if (writer->csv) {
+        fclose(writer->csv);
+    }
+    if (writer->binary) {
+        fclose(writer->binary);
+    }
+    free(writer->csv_buffer);
+    free(writer->binary_buffer);
+    free(writer);
+}
+
+// Called with log_writers_lock held
+static struct LogWriter* log_writer_open(const struct LogRecord* record) {
+    int run_id = record->house->run_id;
+    int entity_id = record->event.entity_id;
+
+    char directory[256];
+    char path[512];
+    log_run_directory(run_id, directory, sizeof(directory));
+    if (log_directory) {
+        mkdir(log_directory, 0755);
+    }
+    if (run_id >= 0 && mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+
+    struct LogWriter* writer = calloc(1, sizeof(struct LogWriter));
+    if (!writer) {
+        return NULL;
+    }
+    writer->run_id = run_id;
+    writer->entity_id = entity_id;
+
+    if (log_outputs & LOG_OUTPUT_CSV) {
+        snprintf(path, sizeof(path), "%s/log_%d.csv", directory, entity_id);
+        writer->csv = log_open_buffered(path, "a", &writer->csv_buffer);
+    }
+
+    if (log_outputs & LOG_OUTPUT_BINARY) {
+        // the first writer of a hunt also records which index is which room
+        bool first_of_run = true;
+        for (int i = 0; i < log_writer_count; i++) {
+            if (log_writers[i]->run_id == run_id) {
+                first_of_run = false;
+                break;
+            }
+        }
+        if (first_of_run) {
+            log_write_room_table(record->house, directory);
+        }
+
+        snprintf(path, sizeof(path), "%s/log_%d.bin", directory, entity_id);
+        writer->binary = log_open_buffered(path, "wb", &writer->binary_buffer);
+        if (writer->binary) {
+            struct LogFileHeader header;
+            log_header_init(&header, record->event.entity_type, entity_id, record->name);
+            fwrite(&header, sizeof(header), 1, writer->binary);
+        }
+    }
+
+    if (!writer->csv && !writer->binary) {
+        log_writer_close(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+static struct LogWriter* log_writer_get(const struct LogRecord* record) {
+    int run_id = record->house->run_id;
+    int entity_id = record->event.entity_id;
+
+    if (log_cached_writer && log_cached_run == run_id && log_cached_entity == entity_id) {
+        return log_cached_writer;
+    }
+
+    pthread_mutex_lock(&log_writers_lock);
+
+    struct LogWriter* writer = NULL;
+    for (int i = 0; i < log_writer_count; i++) {
+        if (log_writers[i]->run_id == run_id && log_writers[i]->entity_id == entity_id) {
+            writer = log_writers[i];
+            break;
+        }
+    }
+
+    if (!writer) {
+        if (log_writer_count == log_writer_capacity) {
+            int capacity = log_writer_capacity ? log_writer_capacity * 2 : 8;
+            struct LogWriter** grown = realloc(log_writers, sizeof(struct LogWriter*) * capacity);
+            if (!grown) {
+                pthread_mutex_unlock(&log_writers_lock);
+                return NULL;
+            }
+            log_writers = grown;
+            log_writer_capacity = capacity;
+        }
+
+        writer = log_writer_open(record);
+        if (writer) {
+            log_writers[log_writer_count++] = writer;
+        }
+    }
+
+    pthread_mutex_unlock(&log_writers_lock);
+
+    log_cached_writer = writer;
+    log_cached_run = run_id;
+    log_cached_entity = entity_id;
+    return writer;
+}
+
+// ---- Log queue ----
+// log_* calls never touch the disk: they stamp the record and push it into a bounded
+// lock-free multi-producer/single-consumer ring (Vyukov style, one sequence number per slot).
+// A single background writer thread drains the ring into the LogWriters above.
+#define LOG_QUEUE_DEFAULT_CAPACITY (1 << 16)
+
+struct LogSlot {
+    _Atomic size_t   sequence;  // == position when free, position + 1 once the record is published
+    struct LogRecord record;
 };
 
-static const char* log_entity_type_to_string(enum LogEntityType type) {
-    switch (type) {
-        case LOG_ENTITY_HUNTER:
-            return "hunter";
-        case LOG_ENTITY_GHOST:
-            return "ghost";
-        default:
-            return "unknown";
+static struct LogSlot* log_queue = NULL;
+static size_t log_queue_capacity = LOG_QUEUE_DEFAULT_CAPACITY;
+static size_t log_queue_mask = 0;
+static _Atomic size_t log_queue_head = 0;       // Next position a producer claims
+static _Atomic size_t log_queue_tail = 0;       // Next position the writer thread reads
+static _Atomic size_t log_queue_written = 0;    // Records fully written out (lags tail while one is in hand)
+static _Atomic size_t log_queue_high_water = 0;
+static _Atomic size_t log_queue_dropped = 0;
+static enum LogBackpressure log_backpressure = LOG_BACKPRESSURE_BLOCK;
+
+static pthread_t log_thread;
+static _Atomic bool log_thread_started = false;
+static _Atomic bool log_thread_stop = false;
+static pthread_mutex_t log_thread_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool log_atexit_registered = false;
+
+void log_set_backpressure(enum LogBackpressure policy) {
+    log_backpressure = policy;
+}
+
+void log_set_queue_capacity(size_t capacity) {
+    // round up to a power of two so positions can be masked
+    size_t rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    log_queue_capacity = rounded;
+}
+
+void log_get_queue_stats(struct LogQueueStats* stats) {
+    stats->capacity = log_queue_capacity;
+    stats->pushed = atomic_load(&log_queue_head);
+    stats->written = atomic_load(&log_queue_written);
+    stats->high_water = atomic_load(&log_queue_high_water);
+    stats->dropped = atomic_load(&log_queue_dropped);
+}
+
+static bool log_queue_pop(struct LogRecord* out) {
+    size_t tail = atomic_load_explicit(&log_queue_tail, memory_order_relaxed);
+    struct LogSlot* slot = &log_queue[tail & log_queue_mask];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != tail + 1) {
+        return false;
+    }
+
+    *out = slot->record;
+    // hand the slot back to producers one lap later
+    atomic_store_explicit(&slot->sequence, tail + log_queue_mask + 1, memory_order_release);
+    atomic_store_explicit(&log_queue_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void log_write_record_now(const struct LogRecord* record);
+
+static void* log_writer_thread(void* arg) {
+    (void)arg;
+    struct LogRecord record;
+    struct timespec pause = {0, 200 * 1000}; // 0.2 ms when there is nothing to do
+
+    while (1) {
+        bool worked = false;
+        while (log_queue_pop(&record)) {
+            log_write_record_now(&record);
+            atomic_fetch_add_explicit(&log_queue_written, 1, memory_order_release);
+            worked = true;
+        }
+        if (!worked) {
+            if (atomic_load_explicit(&log_thread_stop, memory_order_acquire)
+                && atomic_load(&log_queue_tail) == atomic_load(&log_queue_head)) {
+                break;
+            }
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+static bool log_queue_start(void) {
+    if (atomic_load_explicit(&log_thread_started, memory_order_acquire)) {
+        return true;
+    }
+
+    pthread_mutex_lock(&log_thread_lock);
+    if (!atomic_load(&log_thread_started)) {
+        if (!log_queue) {
+            log_queue = malloc(sizeof(struct LogSlot) * log_queue_capacity);
+            if (!log_queue) {
+                pthread_mutex_unlock(&log_thread_lock);
+                return false;
+            }
+            log_queue_mask = log_queue_capacity - 1;
+            for (size_t i = 0; i < log_queue_capacity; i++) {
+                atomic_init(&log_queue[i].sequence, i);
+            }
+        }
+        if (!log_atexit_registered) {
+            // make sure queued lines reach the disk even on exit(1)
+            atexit(log_flush_all);
+            log_atexit_registered = true;
+        }
+        atomic_store(&log_thread_stop, false);
+        pthread_create(&log_thread, NULL, log_writer_thread, NULL);
+        atomic_store_explicit(&log_thread_started, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&log_thread_lock);
+    return true;
+}
+
+static void log_queue_note_depth(size_t depth) {
+    size_t seen = atomic_load_explicit(&log_queue_high_water, memory_order_relaxed);
+    while (depth > seen
+           && !atomic_compare_exchange_weak_explicit(&log_queue_high_water, &seen, depth,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void log_queue_push(const struct LogRecord* record) {
+    if (!log_queue_start()) {
+        return;
+    }
+
+    size_t pos = atomic_load_explicit(&log_queue_head, memory_order_relaxed);
+    struct LogSlot* slot;
+    while (1) {
+        slot = &log_queue[pos & log_queue_mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&log_queue_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // ring is full: the writer thread has not freed this slot yet
+            if (log_backpressure == LOG_BACKPRESSURE_DROP) {
+                atomic_fetch_add_explicit(&log_queue_dropped, 1, memory_order_relaxed);
+                return;
+            }
+            sched_yield();
+            pos = atomic_load_explicit(&log_queue_head, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&log_queue_head, memory_order_relaxed);
+        }
+    }
+
+    slot->record = *record;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+    log_queue_note_depth(pos + 1 - atomic_load_explicit(&log_queue_tail, memory_order_relaxed));
+}
+
+/**
+ * Waits until the writer thread has written everything pushed before this call.
+ */
+static void log_queue_drain(void) {
+    if (!atomic_load_explicit(&log_thread_started, memory_order_acquire)) {
+        return;
+    }
+
+    size_t target = atomic_load(&log_queue_head);
+    struct timespec pause = {0, 100 * 1000};
+    while (atomic_load_explicit(&log_queue_written, memory_order_acquire) < target) {
+        nanosleep(&pause, NULL);
     }
 }
 
-static void write_log_record(const struct LogRecord* record) {
-    static _Thread_local unsigned line_count = 0;
+void log_close_run(int run_id) {
+    // the run's records still reference its house and hunter names, write them out first
+    log_queue_drain();
+
+    pthread_mutex_lock(&log_writers_lock);
+    int kept = 0;
+    for (int i = 0; i < log_writer_count; i++) {
+        if (log_writers[i]->run_id == run_id) {
+            log_writer_close(log_writers[i]);
+        } else {
+            log_writers[kept++] = log_writers[i];
+        }
+    }
+    log_writer_count = kept;
+    pthread_mutex_unlock(&log_writers_lock);
+}
 
-    if (line_count >= 100000) {
-        fprintf(stderr, "Log capped for entity %d; stopping to prevent infinite growth.\n", record->entity_id);
-        exit(1);
+void log_flush_all(void) {
+    pthread_mutex_lock(&log_thread_lock);
+    if (atomic_load(&log_thread_started)) {
+        atomic_store_explicit(&log_thread_stop, true, memory_order_release);
+        pthread_join(log_thread, NULL);
+        atomic_store(&log_thread_started, false);
     }
+    pthread_mutex_unlock(&log_thread_lock);
 
-    char filename[64];
-    snprintf(filename, sizeof(filename), "log_%d.csv", record->entity_id);
+    pthread_mutex_lock(&log_writers_lock);
+    for (int i = 0; i < log_writer_count; i++) {
+        log_writer_close(log_writers[i]);
+    }
+    free(log_writers);
+    log_writers = NULL;
+    log_writer_count = 0;
+    log_writer_capacity = 0;
+    pthread_mutex_unlock(&log_writers_lock);
 
-    FILE* log_file = fopen(filename, "a");
+    log_cached_writer = NULL;
+}
+
+// Runs on the writer thread only
+static void log_write_record_now(const struct LogRecord* record) {
+    struct LogWriter* writer = log_writer_get(record);
 
-    if (!log_file) {
+    if (!writer) {
         return;
     }
 
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    long long timestamp = (long long)tv.tv_sec * 1000LL + (long long)tv.tv_usec / 1000LL;
+    // counted per (run, entity) log, not per thread: one des or pool worker logs many hunts
+    if (writer->events >= LOG_EVENT_CAP) {
+        return;
+    }
+    if (++writer->events == LOG_EVENT_CAP) {
+        fprintf(stderr, "Log of entity %d (run %d) capped at %d events; later events are dropped.\n",
+                writer->entity_id, writer->run_id, LOG_EVENT_CAP);
+    }
+
+    if (writer->binary) {
+        fwrite(&record->event, sizeof(record->event), 1, writer->binary);
+    }
 
-    const char* entity = log_entity_type_to_string(record->entity_type);
-    const char* room = record->room ? record->room : "";
-    const char* device = record->device ? record->device : "";
-    const char* action = record->action ? record->action : "";
-    const char* extra = record->extra ? record->extra : "";
+    if (writer->csv) {
+        const struct Room* rooms = record->house->rooms;
+        const struct LogEvent* event = &record->event;
+        const char* room = event->room != LOG_NO_ROOM ? rooms[event->room].name : NULL;
+        const char* extra_room = event->action == LOG_ACTION_MOVE ? rooms[event->extra].name : NULL;
+        log_event_write_csv(writer->csv, event, room, extra_room, record->name, log_order_columns);
+    }
+}
 
-    fprintf(log_file,
-            "%lld,%s,%d,%s,%s,%d,%d,%s,%s\n",
-            timestamp,
-            entity,
-            record->entity_id,
-            room,
-            device,
-            record->boredom,
-            record->fear,
-            action,
-            extra);
+static void write_log_record(struct LogRecord* record) {
+    if (!(log_outputs & (LOG_OUTPUT_CSV | LOG_OUTPUT_BINARY))) {
+        return;
+    }
 
-    fclose(log_file);
-    line_count++;
+    // stamp on the calling thread so the time is when the event happened, not when it was written
+    if (record->house->virtual_clock) {
+        record->event.timestamp = record->house->clock_base_ms + record->house->virtual_now;
+    } else {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        record->event.timestamp = (int64_t)tv.tv_sec * 1000LL + (int64_t)tv.tv_usec / 1000LL;
+    }
+    // one counter for all threads: an event that happens-before another gets the smaller number
+    record->event.sequence = atomic_fetch_add_explicit(&log_sequence, 1, memory_order_relaxed);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    record->event.monotonic_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
 
-    // Short pause helps ensure successive logs receive distinct timestamps.
-    struct timespec pause = {0, 2 * 1000 * 1000}; // 2 ms
-    nanosleep(&pause, NULL);
+    log_queue_push(record);
 }
 
-void log_move(int hunter_id, int boredom, int fear, const char* from_room, const char* to_room, enum EvidenceType device) {
+void log_move(int hunter_id, int boredom, int fear, const struct Room* from_room, const struct Room* to_room, enum EvidenceType device) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, LOG_ACTION_MOVE)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = from_room,
-        .device = evidence_to_string(device),
-        .boredom = boredom,
-        .fear = fear,
-        .action = "MOVE",
-        .extra = to_room
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = log_room_index(from_room),
+            .device = device,
+            .boredom = boredom,
+            .fear = fear,
+            .action = LOG_ACTION_MOVE,
+            .extra = log_room_index(to_room)
+        },
+        .house = from_room->house
     };
 
     write_log_record(&record);
 
-    printf("Hunter %d using %s moved from %s to %s (bored=%d fear=%d)\n",
+    log_console("Hunter %d using %s moved from %s to %s (bored=%d fear=%d)\n",
            hunter_id,
            evidence_to_string(device),
-           from_room ? from_room : "",
-           to_room ? to_room : "",
+           from_room->name,
+           to_room->name,
            boredom,
            fear);
 }
 
-void log_evidence(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device) {
-    const char* evidence = evidence_to_string(device);
+void log_evidence(int hunter_id, int boredom, int fear, const struct Room* room, enum EvidenceType device) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, LOG_ACTION_EVIDENCE)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = room_name,
-        .device = evidence,
-        .boredom = boredom,
-        .fear = fear,
-        .action = "EVIDENCE",
-        .extra = evidence
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = log_room_index(room),
+            .device = device,
+            .boredom = boredom,
+            .fear = fear,
+            .action = LOG_ACTION_EVIDENCE,
+            .extra = device
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Hunter %d using %s gathered evidence in %s (bored=%d fear=%d)\n",
+    log_console("Hunter %d using %s gathered evidence in %s (bored=%d fear=%d)\n",
            hunter_id,
-           evidence,
-           room_name ? room_name : "",
+           evidence_to_string(device),
+           room->name,
            boredom,
            fear);
 }
 
-void log_swap(int hunter_id, int boredom, int fear, enum EvidenceType from_device, enum EvidenceType to_device) {
-    char extra[64];
-    const char* from_text = evidence_to_string(from_device);
-    const char* to_text = evidence_to_string(to_device);
-    snprintf(extra, sizeof(extra), "%s->%s", from_text, to_text);
+void log_swap(int hunter_id, int boredom, int fear, const struct Room* room, enum EvidenceType from_device, enum EvidenceType to_device) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, LOG_ACTION_SWAP)) {
+        return;
+    }
 
+    // the room column of a SWAP line stays empty, the room only tells us which hunt this is
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = NULL,
-        .device = to_text,
-        .boredom = boredom,
-        .fear = fear,
-        .action = "SWAP",
-        .extra = extra
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = LOG_NO_ROOM,
+            .device = to_device,
+            .boredom = boredom,
+            .fear = fear,
+            .action = LOG_ACTION_SWAP,
+            .extra = ((uint32_t)from_device << 8) | (uint32_t)to_device
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Hunter %d swapped devices: %s -> %s (bored=%d fear=%d)\n",
+    log_console("Hunter %d swapped devices: %s -> %s (bored=%d fear=%d)\n",
            hunter_id,
-           from_text,
-           to_text,
+           evidence_to_string(from_device),
+           evidence_to_string(to_device),
            boredom,
            fear);
 }
 
-void log_exit(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device, enum LogReason reason) {
-    const char* device_text = evidence_to_string(device);
-    const char* reason_text = exit_reason_to_string(reason);
+void log_exit(int hunter_id, int boredom, int fear, const struct Room* room, enum EvidenceType device, enum LogReason reason) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, LOG_ACTION_EXIT)) {
+        return;
+    }
 
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = room_name,
-        .device = device_text,
-        .boredom = boredom,
-        .fear = fear,
-        .action = "EXIT",
-        .extra = reason_text
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = log_room_index(room),
+            .device = device,
+            .boredom = boredom,
+            .fear = fear,
+            .action = LOG_ACTION_EXIT,
+            .extra = reason
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Hunter %d using %s exited at %s (reason=%s, bored=%d fear=%d)\n",
+    log_console("Hunter %d using %s exited at %s (reason=%s, bored=%d fear=%d)\n",
            hunter_id,
-           device_text,
-           room_name ? room_name : "",
-           reason_text,
+           evidence_to_string(device),
+           room->name,
+           exit_reason_to_string(reason),
            boredom,
            fear);
 }
 
-void log_return_to_van(int hunter_id, int boredom, int fear, const char* room_name, enum EvidenceType device, bool heading_home) {
-    const char* device_text = evidence_to_string(device);
-    const char* extra = heading_home ? "start" : "complete";
-    const char* action = heading_home ? "RETURN_START" : "RETURN_COMPLETE";
+void log_return_to_van(int hunter_id, int boredom, int fear, const struct Room* room, enum EvidenceType device, bool heading_home) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, heading_home ? LOG_ACTION_RETURN_START : LOG_ACTION_RETURN_COMPLETE)) {
+        return;
+    }
 
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = room_name,
-        .device = device_text,
-        .boredom = boredom,
-        .fear = fear,
-        .action = action,
-        .extra = extra
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = log_room_index(room),
+            .device = device,
+            .boredom = boredom,
+            .fear = fear,
+            .action = heading_home ? LOG_ACTION_RETURN_START : LOG_ACTION_RETURN_COMPLETE,
+            .extra = 0
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
+    const char* device_text = evidence_to_string(device);
     if (heading_home) {
-        printf("Hunter %d using %s heading to van from %s (bored=%d fear=%d)\n",
+        log_console("Hunter %d using %s heading to van from %s (bored=%d fear=%d)\n",
                hunter_id,
                device_text,
-               room_name ? room_name : "",
+               room->name,
                boredom,
                fear);
     } else {
-        printf("Hunter %d using %s finished return at %s (bored=%d fear=%d)\n",
+        log_console("Hunter %d using %s finished return at %s (bored=%d fear=%d)\n",
                hunter_id,
                device_text,
-               room_name ? room_name : "",
+               room->name,
                boredom,
                fear);
     }
 }
 
-void log_hunter_init(int hunter_id, const char* room_name, const char* hunter_name, enum EvidenceType device) {
-    const char* device_text = evidence_to_string(device);
+void log_hunter_init(int hunter_id, const struct Room* room, const char* hunter_name, enum EvidenceType device) {
+    if (!log_wanted(LOG_ENTITY_HUNTER, LOG_ACTION_INIT)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_HUNTER,
-        .entity_id = hunter_id,
-        .room = room_name,
-        .device = device_text,
-        .boredom = 0,
-        .fear = 0,
-        .action = "INIT",
-        .extra = hunter_name ? hunter_name : ""
+        .event = {
+            .entity_type = LOG_ENTITY_HUNTER,
+            .entity_id = hunter_id,
+            .room = log_room_index(room),
+            .device = device,
+            .boredom = 0,
+            .fear = 0,
+            .action = LOG_ACTION_INIT,
+            .extra = 0
+        },
+        .house = room->house,
+        .name = hunter_name ? hunter_name : ""
     };
 
     write_log_record(&record);
-    printf("Hunter %d (%s) initialized in %s with %s\n",
+    log_console("Hunter %d (%s) initialized in %s with %s\n",
            hunter_id,
            hunter_name ? hunter_name : "unknown",
-           room_name ? room_name : "",
-           device_text);
+           room->name,
+           evidence_to_string(device));
 }
 
-void log_ghost_init(int ghost_id, const char* room_name, enum GhostType type) {
-    const char* type_text = ghost_to_string(type);
+void log_ghost_init(int ghost_id, const struct Room* room, enum GhostType type) {
+    if (!log_wanted(LOG_ENTITY_GHOST, LOG_ACTION_INIT)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_GHOST,
-        .entity_id = ghost_id,
-        .room = room_name,
-        .device = NULL,
-        .boredom = 0,
-        .fear = 0,
-        .action = "INIT",
-        .extra = type_text
+        .event = {
+            .entity_type = LOG_ENTITY_GHOST,
+            .entity_id = ghost_id,
+            .room = log_room_index(room),
+            .device = 0,
+            .boredom = 0,
+            .fear = 0,
+            .action = LOG_ACTION_INIT,
+            .extra = type
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
-    printf("Ghost %d (%s) initialized in %s\n",
+    log_console("Ghost %d (%s) initialized in %s\n",
            ghost_id,
-           type_text,
-           room_name ? room_name : "");
+           ghost_to_string(type),
+           room->name);
 }
 
-void log_ghost_move(int ghost_id, int boredom, const char* from_room, const char* to_room) {
+void log_ghost_move(int ghost_id, int boredom, const struct Room* from_room, const struct Room* to_room) {
+    if (!log_wanted(LOG_ENTITY_GHOST, LOG_ACTION_MOVE)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_GHOST,
-        .entity_id = ghost_id,
-        .room = from_room,
-        .device = NULL,
-        .boredom = boredom,
-        .fear = 0,
-        .action = "MOVE",
-        .extra = to_room
+        .event = {
+            .entity_type = LOG_ENTITY_GHOST,
+            .entity_id = ghost_id,
+            .room = log_room_index(from_room),
+            .device = 0,
+            .boredom = boredom,
+            .fear = 0,
+            .action = LOG_ACTION_MOVE,
+            .extra = log_room_index(to_room)
+        },
+        .house = from_room->house
     };
 
     write_log_record(&record);
 
-    printf("Ghost %d [bored=%d] MOVE %s -> %s\n",
+    log_console("Ghost %d [bored=%d] MOVE %s -> %s\n",
            ghost_id,
            boredom,
-           from_room ? from_room : "",
-           to_room ? to_room : "");
+           from_room->name,
+           to_room->name);
 }
 
-void log_ghost_evidence(int ghost_id, int boredom, const char* room_name, enum EvidenceType evidence) {
-    const char* evidence_text = evidence_to_string(evidence);
+void log_ghost_evidence(int ghost_id, int boredom, const struct Room* room, enum EvidenceType evidence) {
+    if (!log_wanted(LOG_ENTITY_GHOST, LOG_ACTION_EVIDENCE)) {
+        return;
+    }
 
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_GHOST,
-        .entity_id = ghost_id,
-        .room = room_name,
-        .device = NULL,
-        .boredom = boredom,
-        .fear = 0,
-        .action = "EVIDENCE",
-        .extra = evidence_text
+        .event = {
+            .entity_type = LOG_ENTITY_GHOST,
+            .entity_id = ghost_id,
+            .room = log_room_index(room),
+            .device = 0,
+            .boredom = boredom,
+            .fear = 0,
+            .action = LOG_ACTION_EVIDENCE,
+            .extra = evidence
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Ghost %d [bored=%d] EVIDENCE %s in %s\n",
+    log_console("Ghost %d [bored=%d] EVIDENCE %s in %s\n",
            ghost_id,
            boredom,
-           evidence_text,
-           room_name ? room_name : "");
+           evidence_to_string(evidence),
+           room->name);
 }
 
-void log_ghost_exit(int ghost_id, int boredom, const char* room_name) {
+void log_ghost_exit(int ghost_id, int boredom, const struct Room* room) {
+    if (!log_wanted(LOG_ENTITY_GHOST, LOG_ACTION_EXIT)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_GHOST,
-        .entity_id = ghost_id,
-        .room = room_name,
-        .device = NULL,
-        .boredom = boredom,
-        .fear = 0,
-        .action = "EXIT",
-        .extra = ""
+        .event = {
+            .entity_type = LOG_ENTITY_GHOST,
+            .entity_id = ghost_id,
+            .room = log_room_index(room),
+            .device = 0,
+            .boredom = boredom,
+            .fear = 0,
+            .action = LOG_ACTION_EXIT,
+            .extra = 0
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Ghost %d [bored=%d] EXIT %s\n",
+    log_console("Ghost %d [bored=%d] EXIT %s\n",
            ghost_id,
            boredom,
-           room_name ? room_name : "");
+           room->name);
 }
 
-void log_ghost_idle(int ghost_id, int boredom, const char* room_name) {
+void log_ghost_idle(int ghost_id, int boredom, const struct Room* room) {
+    if (!log_wanted(LOG_ENTITY_GHOST, LOG_ACTION_IDLE)) {
+        return;
+    }
+
     struct LogRecord record = {
-        .entity_type = LOG_ENTITY_GHOST,
-        .entity_id = ghost_id,
-        .room = room_name,
-        .device = NULL,
-        .boredom = boredom,
-        .fear = 0,
-        .action = "IDLE",
-        .extra = ""
+        .event = {
+            .entity_type = LOG_ENTITY_GHOST,
+            .entity_id = ghost_id,
+            .room = log_room_index(room),
+            .device = 0,
+            .boredom = boredom,
+            .fear = 0,
+            .action = LOG_ACTION_IDLE,
+            .extra = 0
+        },
+        .house = room->house
     };
 
     write_log_record(&record);
 
-    printf("Ghost %d [bored=%d] IDLE in %s\n",
+    log_console("Ghost %d [bored=%d] IDLE in %s\n",
            ghost_id,
            boredom,
-           room_name ? room_name : "");
+           room->name);
 }
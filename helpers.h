@@ -1,6 +1,8 @@
 #ifndef HELPERS_H
 #define HELPERS_H
 
+#include <stddef.h>
+#include <stdio.h>
 #include "defs.h"
 
 /**
@@ -39,13 +41,25 @@ int get_all_evidence_types(const enum EvidenceType** list);
 int get_all_ghost_types(const enum GhostType** list);
 
 /**
- * @brief Thread-safe random integer helper.
+ * @brief Thread-safe random integer helper (unbiased, separate stream per thread).
  * @param[in] lower_inclusive Minimum value (inclusive).
  * @param[in] upper_exclusive Maximum value (exclusive).
  * @return Random number in [lower_inclusive, upper_exclusive).
  */
 int rand_int_threadsafe(int lower_inclusive, int upper_exclusive);
 
+#define EVIDENCE_MASK_COUNT 128    // Every combination of the seven evidence bits
+
+// Everything the simulation needs to know about one evidence mask
+struct EvidenceInfo {
+    unsigned char count;    // Number of evidence bits set
+    bool          is_ghost; // The mask is exactly one ghost type (so the mask is the GhostType)
+    EvidenceByte  bits[3];  // The three lowest evidence bits set (all of them for a ghost type), 0 if fewer
+};
+
+// Built at compile time, index with (mask & (EVIDENCE_MASK_COUNT - 1))
+extern const struct EvidenceInfo evidence_table[EVIDENCE_MASK_COUNT];
+
 /**
  * @brief Verify whether an evidence mask matches a supported ghost type.
  * @param[in] mask Combined evidence mask.
@@ -66,16 +80,116 @@ bool evidence_has_three_unique(EvidenceByte mask);
  */
 void house_populate_rooms(struct House* house);
 
+// Output targets for the log_* functions, combine with |
+enum LogOutput {
+    LOG_OUTPUT_NONE    = 0,
+    LOG_OUTPUT_CSV     = 1 << 0,
+    LOG_OUTPUT_CONSOLE = 1 << 1,
+    LOG_OUTPUT_BINARY  = 1 << 2    // log_<id>.bin, see eventlog.h and log_export
+};
+
+/**
+ * @brief Choose where log_* events are written (default CSV | CONSOLE).
+ * @param[in] outputs Bitwise OR of LogOutput values; call before any threads start.
+ */
+void log_set_outputs(int outputs);
+
+/**
+ * @brief Append each event's sequence number and CLOCK_MONOTONIC nanoseconds to CSV lines.
+ *
+ * Off by default, so CSV logs keep their nine columns; binary logs always carry both.
+ * @param[in] enabled Whether CSV lines end in ",seq,mono_ns"; call before any threads start.
+ */
+void log_set_order_columns(bool enabled);
+
+/**
+ * @brief Choose which kinds of events are logged (--log-filter, GHOST_LOG_FILTER).
+ *
+ * The spec is a comma separated list of type:ACTION[=N] rules, applied in order: type is hunter,
+ * ghost or *, ACTION a CSV action token or *, and N is 0 to drop the kind, 1 to keep it (the
+ * default without =N) or N to keep one event in N. "ghost:IDLE=0,hunter:MOVE=10" drops ghost
+ * idles and keeps a tenth of hunter moves. The filter is checked before anything is built or
+ * written, and applies to the console and every log file; validate_logs.py needs unfiltered logs.
+ * @param[in] spec Filter rules; call before any threads start.
+ * @param[out] error Receives the reason when the spec is rejected.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 on a bad rule (the filter is left unchanged).
+ */
+int log_set_filter(const char* spec, char* error, size_t error_size);
+
+/**
+ * @brief Print how many events of each filtered kind were suppressed, if a filter is set.
+ * @param[in] out Stream to print to.
+ */
+void log_filter_report(FILE* out);
+
+/**
+ * @brief Flush and close every open log file.
+ *
+ * Events are queued for a background writer thread and log files stay open and buffered;
+ * this waits for the queue to empty, stops the writer and writes out whatever is left.
+ * It is registered with atexit() but can be called earlier (e.g. at the end of main).
+ */
+void log_flush_all(void);
+
+// What a full log queue does to the thread that logs
+enum LogBackpressure {
+    LOG_BACKPRESSURE_BLOCK = 0,   // Wait for the writer thread to free a slot (default, nothing is lost)
+    LOG_BACKPRESSURE_DROP  = 1    // Throw the event away and count it
+};
+
+// Counters of the queue between log_* callers and the writer thread
+struct LogQueueStats {
+    size_t capacity;
+    size_t pushed;      // Events queued
+    size_t written;     // Events handed to the log files
+    size_t high_water;  // Most events ever waiting in the queue
+    size_t dropped;     // Events thrown away under LOG_BACKPRESSURE_DROP
+};
+
+/**
+ * @brief Choose what happens when the log queue is full.
+ * @param[in] policy Backpressure policy; call before any threads start.
+ */
+void log_set_backpressure(enum LogBackpressure policy);
+
+/**
+ * @brief Set the number of queued events (rounded up to a power of two).
+ * @param[in] capacity Queue size; only used if called before the first event is logged.
+ */
+void log_set_queue_capacity(size_t capacity);
+
+/**
+ * @brief Read the log queue counters.
+ * @param[out] stats Counters filled in.
+ */
+void log_get_queue_stats(struct LogQueueStats* stats);
+
+/**
+ * @brief Put log files under a directory instead of the working directory.
+ *
+ * Hunts with a run id >= 0 (batch mode) log into <directory>/run_<id>/ so that
+ * concurrent hunts never share files.
+ * @param[in] directory Directory path (kept, not copied) or NULL for the working directory.
+ */
+void log_set_directory(const char* directory);
+
+/**
+ * @brief Flush and close the log files of one hunt.
+ * @param[in] run_id Run id of the hunt; nothing may be logged for it afterwards.
+ */
+void log_close_run(int run_id);
+
 /**
  * @brief Append a MOVE entry for a hunter.
  * @param[in] id Hunter identifier.
  * @param[in] boredom Current boredom level.
  * @param[in] fear Current fear level.
- * @param[in] from Source room name.
- * @param[in] to Destination room name.
+ * @param[in] from Source room.
+ * @param[in] to Destination room.
  * @param[in] device Device the hunter is holding.
  */
-void log_move(int id, int boredom, int fear, const char* from, const char* to, enum EvidenceType device);
+void log_move(int id, int boredom, int fear, const struct Room* from, const struct Room* to, enum EvidenceType device);
 
 /**
  * @brief Append an EVIDENCE entry for a hunter.
@@ -85,28 +199,29 @@ void log_move(int id, int boredom, int fear, const char* from, const char* to, e
  * @param[in] room Room where evidence was collected.
  * @param[in] device Device used to collect evidence.
  */
-void log_evidence(int id, int boredom, int fear, const char* room, enum EvidenceType device);
+void log_evidence(int id, int boredom, int fear, const struct Room* room, enum EvidenceType device);
 
 /**
  * @brief Append a SWAP entry for a hunter.
  * @param[in] id Hunter identifier.
  * @param[in] boredom Current boredom level.
  * @param[in] fear Current fear level.
+ * @param[in] room Room the swap happens in (identifies the hunt; the CSV room column stays empty).
  * @param[in] from Device swapped from.
  * @param[in] to Device swapped to.
  */
-void log_swap(int id, int boredom, int fear, enum EvidenceType from, enum EvidenceType to);
+void log_swap(int id, int boredom, int fear, const struct Room* room, enum EvidenceType from, enum EvidenceType to);
 
 /**
  * @brief Append an EXIT entry for a hunter.
  * @param[in] id Hunter identifier.
  * @param[in] boredom Current boredom level.
  * @param[in] fear Current fear level.
- * @param[in] room Exit room name.
+ * @param[in] room Exit room.
  * @param[in] device Device carried.
  * @param[in] reason Exit reason.
  */
-void log_exit(int id, int boredom, int fear, const char* room, enum EvidenceType device, enum LogReason reason);
+void log_exit(int id, int boredom, int fear, const struct Room* room, enum EvidenceType device, enum LogReason reason);
 
 /**
  * @brief Append a MOVE entry for the ghost.
@@ -115,7 +230,7 @@ void log_exit(int id, int boredom, int fear, const char* room, enum EvidenceType
  * @param[in] from Source room.
  * @param[in] to Destination room.
  */
-void log_ghost_move(int id, int boredom, const char* from, const char* to);
+void log_ghost_move(int id, int boredom, const struct Room* from, const struct Room* to);
 
 /**
  * @brief Append an EVIDENCE entry for the ghost.
@@ -124,7 +239,7 @@ void log_ghost_move(int id, int boredom, const char* from, const char* to);
  * @param[in] room Room where evidence was dropped.
  * @param[in] evidence Evidence type left behind.
  */
-void log_ghost_evidence(int id, int boredom, const char* room, enum EvidenceType evidence);
+void log_ghost_evidence(int id, int boredom, const struct Room* room, enum EvidenceType evidence);
 
 /**
  * @brief Append an EXIT entry for the ghost.
@@ -132,7 +247,7 @@ void log_ghost_evidence(int id, int boredom, const char* room, enum EvidenceType
  * @param[in] boredom Current boredom level.
  * @param[in] room Room the ghost leaves from.
  */
-void log_ghost_exit(int id, int boredom, const char* room);
+void log_ghost_exit(int id, int boredom, const struct Room* room);
 
 /**
  * @brief Append an IDLE entry for the ghost.
@@ -140,7 +255,7 @@ void log_ghost_exit(int id, int boredom, const char* room);
  * @param[in] boredom Current boredom level.
  * @param[in] room Room the ghost stays in.
  */
-void log_ghost_idle(int id, int boredom, const char* room);
+void log_ghost_idle(int id, int boredom, const struct Room* room);
 
 /**
  * @brief Append a RETURN entry for the hunter.
@@ -151,7 +266,7 @@ void log_ghost_idle(int id, int boredom, const char* room);
  * @param[in] device Device being carried.
  * @param[in] heading_home true if beginning the return path.
  */
-void log_return_to_van(int id, int boredom, int fear, const char* room, enum EvidenceType device, bool heading_home);
+void log_return_to_van(int id, int boredom, int fear, const struct Room* room, enum EvidenceType device, bool heading_home);
 
 /**
  * @brief Append an INIT entry for a hunter.
@@ -160,7 +275,7 @@ void log_return_to_van(int id, int boredom, int fear, const char* room, enum Evi
  * @param[in] name Hunter name.
  * @param[in] device Initial device.
  */
-void log_hunter_init(int id, const char* room, const char* name, enum EvidenceType device);
+void log_hunter_init(int id, const struct Room* room, const char* name, enum EvidenceType device);
 
 /**
  * @brief Append an INIT entry for the ghost.
@@ -168,6 +283,6 @@ void log_hunter_init(int id, const char* room, const char* name, enum EvidenceTy
  * @param[in] room Starting room.
  * @param[in] type Ghost type.
  */
-void log_ghost_init(int id, const char* room, enum GhostType type);
+void log_ghost_init(int id, const struct Room* room, enum GhostType type);
 
 #endif // HELPERS_H
@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include "defs.h"
+#include "helpers.h"
+#include "map.h"
 
 /**
  * @brief Inits a room struct
@@ -11,55 +14,218 @@
  * @param is_exit Boolean for whether room is the exit
  */
 void room_init(struct Room* room, const char* name, bool is_exit) {
-    strncpy(room->name, name, MAX_ROOM_NAME);
-    room->num_connected = 0;
+    strncpy(room->name, name, MAX_ROOM_NAME - 1);
+    room->name[MAX_ROOM_NAME - 1] = '\0';
+    room->hunters = NULL;
     room->num_hunters = 0;
     room->ghost = NULL;
-    room->evidence = 0;
+    atomic_init(&room->evidence, 0);
     room->is_exit = is_exit;
-    sem_init(&room->mutex, 0, 1);
+    lock_init(&room->mutex);
+    lock_set_name(&room->mutex, room->name);
 }
 
 /**
- * @brief Connects two rooms
+ * @brief Number of rooms connected to a room
  *
- * @param a Pointer to one room
- * @param b Pointer to the other room
+ * @param room Pointer to the Room
+ * @return Number of neighbours
  */
-void room_connect(struct Room* a, struct Room* b) {
-    if (a->num_connected < MAX_CONNECTIONS && b->num_connected < MAX_CONNECTIONS) {
-        a->connected[a->num_connected++] = b;
-        b->connected[b->num_connected++] = a;
-    }
+int room_degree(const struct Room* room) {
+    const int* offsets = room->house->room_offsets;
+    return offsets[room->id + 1] - offsets[room->id];
 }
 
 /**
- * @brief Adds a hunter to a specific room (as long as room isn't full)
+ * @brief One of the rooms connected to a room
+ *
+ * @param room Pointer to the Room
+ * @param index Neighbour number, 0 to room_degree(room) - 1
+ * @return Pointer to the neighbouring Room
+ */
+struct Room* room_neighbour(const struct Room* room, int index) {
+    const struct House* house = room->house;
+    return &house->rooms[house->room_neighbours[house->room_offsets[room->id] + index]];
+}
+
+/**
+ * @brief Adds a hunter to a specific room (callers check MAX_ROOM_OCCUPANCY)
  *
  * @param room Pointer to the Room
  * @param hunter Pointer to the Hunter
  */
 void room_add_hunter(struct Room* room, struct Hunter* hunter) {
-    if (room->num_hunters < MAX_ROOM_OCCUPANCY) {
-        room->hunters[room->num_hunters++] = hunter;
+    hunter->room_prev = NULL;
+    hunter->room_next = room->hunters;
+    if (room->hunters) {
+        room->hunters->room_prev = hunter;
     }
+    room->hunters = hunter;
+    room->num_hunters++;
 }
 
 /**
  * @brief Removes a hunter from a specific room
  *
  * @param room Pointer to the Room
- * @param hunter Pointer to the Hunter
+ * @param hunter Pointer to the Hunter (must be in the room)
  */
 void room_remove_hunter(struct Room* room, struct Hunter* hunter) {
-    for (int i = 0; i < room->num_hunters; i++) {
-        if (room->hunters[i] == hunter) {
-            for (int j = i; j < room->num_hunters - 1; j++) {
-                room->hunters[j] = room->hunters[j + 1];
-            }
-            room->hunters[room->num_hunters - 1] = NULL;
-            room->num_hunters--;
-            return;
+    if (hunter->room_prev) {
+        hunter->room_prev->room_next = hunter->room_next;
+    } else {
+        room->hunters = hunter->room_next;
+    }
+    if (hunter->room_next) {
+        hunter->room_next->room_prev = hunter->room_prev;
+    }
+    hunter->room_prev = NULL;
+    hunter->room_next = NULL;
+    room->num_hunters--;
+}
+
+/**
+ * @brief Sets up a fresh house: rooms, empty case file and a randomly placed ghost
+ *
+ * @param house Pointer to the House to set up
+ * @param map Layout loaded from a map file, or NULL for the built-in Willow layout
+ * @param run_id Batch run index (keeps the logs of concurrent hunts apart), -1 for a single hunt
+ * @param seed Master seed; every entity gets its own stream derived from (seed, run_id)
+ */
+void house_init(struct House* house, const struct HouseMap* map, int run_id, uint64_t seed) {
+    house->run_id = run_id;
+    house->seed = seed;
+    rand_stream_init(&house->rng, seed, run_id, RNG_SLOT_HOUSE);
+    house->virtual_clock = false;
+    house->virtual_now = 0;
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    house->clock_base_ms = (long long)tv.tv_sec * 1000LL + (long long)tv.tv_usec / 1000LL;
+    house->hunters = NULL;
+    house->hunter_count = 0;
+    house->hunter_capacity = 0;
+    if (map) {
+        house_map_apply(map, house);
+    } else {
+        house_populate_rooms(house);
+    }
+    atomic_init(&house->case_file.collected, 0);
+    atomic_init(&house->case_file.solved, false);
+
+    // init ghost (never in the van)
+    int ghost_start_idx = rand_stream_int(&house->rng, 1, house->room_count);
+    if (ghost_start_idx == 0) {
+        ghost_start_idx = 1;
+    }
+    const enum GhostType* ghost_types;
+    int num_ghosts = get_all_ghost_types(&ghost_types);
+    enum GhostType g_type = ghost_types[rand_stream_int(&house->rng, 0, num_ghosts)];
+    struct RandStream ghost_rng;
+    rand_stream_init(&ghost_rng, seed, run_id, RNG_SLOT_GHOST);
+    house->ghost = ghost_create(DEFAULT_GHOST_ID, g_type, &house->rooms[ghost_start_idx], &ghost_rng);
+}
+
+/**
+ * @brief Creates a hunter in the van and registers it with the house
+ *
+ * @param house Pointer to the House
+ * @param name Hunter name
+ * @param id Hunter ID
+ * @return Pointer to the new Hunter, or NULL if out of memory
+ */
+struct Hunter* house_add_hunter(struct House* house, char* name, int id) {
+    if (house->hunter_count == house->hunter_capacity) {
+        int capacity = house->hunter_capacity ? house->hunter_capacity * 2 : 8;
+        struct Hunter** hunters = realloc(house->hunters, sizeof(struct Hunter*) * capacity);
+        if (!hunters) {
+            return NULL;
         }
+        house->hunters = hunters;
+        house->hunter_capacity = capacity;
     }
-}
\ No newline at end of file
+
+    // streams follow the order hunters join in, not their ids
+    struct RandStream rng;
+    rand_stream_init(&rng, house->seed, house->run_id, RNG_SLOT_HUNTER(house->hunter_count));
+    struct Hunter* h = hunter_create(name, id, house->starting_room, &house->case_file, &rng);
+    house->hunters[house->hunter_count++] = h;
+    room_add_hunter(house->starting_room, h);
+    return h;
+}
+
+/**
+ * @brief Runs one hunt to completion, one thread per hunter plus one for the ghost
+ *
+ * @param house Pointer to the House (already set up with hunters)
+ */
+void house_run(struct House* house) {
+    // start ghost thread
+    pthread_t ghost_identifier;
+    pthread_create(&ghost_identifier, NULL, ghost_thread, house->ghost);
+
+    // start hunter threads
+    pthread_t* hunter_identifiers = malloc(sizeof(pthread_t) * (house->hunter_count + 1));
+    for (int i = 0; i < house->hunter_count; i++) {
+        pthread_create(&hunter_identifiers[i], NULL, hunter_thread, house->hunters[i]);
+    }
+    
+    // stop hunter threads
+    for (int i = 0; i < house->hunter_count; i++) {
+        pthread_join(hunter_identifiers[i], NULL);
+    }
+    free(hunter_identifiers);
+    lock_acquire(&house->ghost->mutex);
+    house->ghost->running = false; 
+    lock_release(&house->ghost->mutex);
+    
+    // stop ghost thread
+    pthread_join(ghost_identifier, NULL);
+}
+
+/**
+ * @brief Summarizes a finished hunt
+ *
+ * @param house Pointer to the House (after house_run)
+ * @param result Pointer to the HuntResult to fill in
+ */
+void house_get_result(struct House* house, struct HuntResult* result) {
+    result->won = atomic_load(&house->case_file.solved);
+    result->ghost_type = house->ghost->type;
+    result->collected = atomic_load(&house->case_file.collected);
+    result->length = 0;
+    result->steps = house->ghost->steps;
+    for (int i = 0; i < 3; i++) {
+        result->exits[i] = 0;
+    }
+
+    for (int i = 0; i < house->hunter_count; i++) {
+        struct Hunter* h = house->hunters[i];
+        result->exits[h->exit_reason]++;
+        result->steps += h->steps;
+        if (h->steps > result->length) {
+            result->length = h->steps;
+        }
+    }
+}
+
+/**
+ * @brief Frees everything the house owns (ghost, hunters, semaphores) and closes its logs
+ *
+ * @param house Pointer to the House
+ */
+void house_cleanup(struct House* house) {
+    // queued log events still point at the rooms and hunter names
+    log_close_run(house->run_id);
+
+    ghost_destroy(house->ghost);
+    for (int i = 0; i < house->hunter_count; i++) {
+        hunter_destroy(house->hunters[i]);
+    }
+    for (int i = 0; i < house->room_count; i++) {
+        lock_destroy(&house->rooms[i].mutex);
+    }
+    free(house->hunters);
+    free(house->rooms);
+    free(house->room_offsets);
+    free(house->room_neighbours);
+}
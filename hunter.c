@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include "defs.h"
 #include "helpers.h"
+#include "check.h"
 
 /**
  * @brief Inits a new hunter struct
@@ -12,21 +13,28 @@
  * @param id Hunter ID
  * @param start_room Hunter starting room pointer
  * @param cf Pointer to the casefile for evidence
+ * @param rng The hunter's random stream (copied)
  * @return Pointer to the new Hunter struct
  */
-struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct CaseFile* cf) {
+struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct CaseFile* cf, const struct RandStream* rng) {
     struct Hunter* h = malloc(sizeof(struct Hunter));
-    strncpy(h->name, name, MAX_HUNTER_NAME);
+    strncpy(h->name, name, MAX_HUNTER_NAME - 1);
+    h->name[MAX_HUNTER_NAME - 1] = '\0';
     h->fear = 0;
     h->boredom = 0;
     h->id = id;
     h->room = start_room;
     h->case_file = cf;    
-    h->path_stack = NULL;
+    stack_init(&h->path_stack, start_room->house->room_count);
+    h->room_prev = NULL;
+    h->room_next = NULL;
     h->running = true;
     h->return_to_van = false;
+    h->rng = *rng;
+    h->steps = 0;
+    h->exit_reason = LR_EVIDENCE;
 
-    int dev_idx = rand_int_threadsafe(0, 7);
+    int dev_idx = rand_stream_int(&h->rng, 0, 7);
     switch(dev_idx) {
         case 0: h->device = EV_EMF; break;
         case 1: h->device = EV_ORBS; break;
@@ -37,7 +45,7 @@ struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct
         case 6: h->device = EV_INFRARED; break;
     }
     
-    log_hunter_init(h->id, start_room->name, h->name, h->device);
+    log_hunter_init(h->id, start_room, h->name, h->device);
     return h;
 }
 
@@ -47,157 +55,185 @@ struct Hunter* hunter_create(char* name, int id, struct Room* start_room, struct
  * @param h Pointer to the Hunter
  */
 void hunter_destroy(struct Hunter* h) {
-    stack_clean(&h->path_stack);
+    stack_free(&h->path_stack);
     free(h);
 }
 
 /**
- * @brief The thread function for a hunter. Handles changing the fear or boredom, collecting evidence, 
+ * @brief One turn of a hunter. Handles changing the fear or boredom, collecting evidence, 
  * moving from room to room, and checking if you won or lost
  *
- * @param arg Void pointer to the Hunter struct, casted to Hunter immediately
- * @return NULL after thread is over
+ * @param h Pointer to the Hunter
+ * @return true if the hunter is still in the hunt, false once it has exited
  */
-void* hunter_thread(void* arg) {
-    struct Hunter* h = (struct Hunter*)arg;
-
-    while (h->running) {
-        struct Room* curr = h->room;
-
-		// lock room to check for ghost
-        sem_wait(&curr->mutex);
-        
-        // is ghost currently in room
-        if (curr->ghost != NULL) {
-            h->boredom = 0;
-            h->fear += 1;
-        } else {
-            h->boredom += 1;
+bool hunter_step(struct Hunter* h) {
+    struct Room* curr = h->room;
+    h->steps++;
+    int boredom_before = h->boredom;
+    int fear_before = h->fear;
+
+	// lock room to check for ghost
+    lock_acquire(&curr->mutex);
+    
+    // is ghost currently in room
+    bool ghost_seen = (curr->ghost != NULL);
+    if (ghost_seen) {
+        h->boredom = 0;
+        h->fear += 1;
+    } else {
+        h->boredom += 1;
+    }
+    
+    if (check_enabled) {
+        check_hunter_senses(h, boredom_before, fear_before);
+    }
+    
+    int current_boredom = h->boredom;
+    int current_fear = h->fear;
+    // unlock room
+    lock_release(&curr->mutex);
+
+	// r we in the van
+    if (curr->is_exit) {
+        if (check_enabled) {
+            check_hunter_home(h);
         }
+    	// clear path stack since we're back
+        stack_clear(&h->path_stack);
         
-        int current_boredom = h->boredom;
-        int current_fear = h->fear;
-        // unlock room
-        sem_post(&curr->mutex);
-
-		// r we in the van
-        if (curr->is_exit) {
-        	// clear path stack since we're back
-            stack_clean(&h->path_stack);
-            
-            sem_wait(&h->case_file->mutex);
-            if (h->case_file->solved) {
-                sem_post(&h->case_file->mutex);
-                h->running = false;
-                log_exit(h->id, h->boredom, h->fear, curr->name, h->device, LR_EVIDENCE);
-                break;
-            }
-            sem_post(&h->case_file->mutex);
-
-            if (h->return_to_van) {
-                 enum EvidenceType old_dev = h->device;
-                 int dev_idx = rand_int_threadsafe(0, 7);
-                 h->device = (1 << dev_idx);
-                 log_swap(h->id, h->boredom, h->fear, old_dev, h->device);
-                 h->return_to_van = false;
-                 log_return_to_van(h->id, h->boredom, h->fear, curr->name, h->device, false);
-            }
-        }
-
-		// r we either too scared or too bored
-        if (current_fear >= HUNTER_FEAR_MAX) {
+        // pairs with the release store of whoever solved the case
+        if (atomic_load_explicit(&h->case_file->solved, memory_order_acquire)) {
             h->running = false;
-            sem_wait(&curr->mutex); 
-            room_remove_hunter(curr, h);
-            sem_post(&curr->mutex);
-            log_exit(h->id, h->boredom, h->fear, curr->name, h->device, LR_AFRAID);
-            break;
+            h->exit_reason = LR_EVIDENCE;
+            log_exit(h->id, h->boredom, h->fear, curr, h->device, LR_EVIDENCE);
+            return false;
         }
-        if (current_boredom >= ENTITY_BOREDOM_MAX) {
-            h->running = false;
-            sem_wait(&curr->mutex);
-            room_remove_hunter(curr, h);
-            sem_post(&curr->mutex);
-            log_exit(h->id, h->boredom, h->fear, curr->name, h->device, LR_BORED);
-            break;
+
+        if (h->return_to_van) {
+             enum EvidenceType old_dev = h->device;
+             int dev_idx = rand_stream_int(&h->rng, 0, 7);
+             h->device = (1 << dev_idx);
+             log_swap(h->id, h->boredom, h->fear, curr, old_dev, h->device);
+             h->return_to_van = false;
+             log_return_to_van(h->id, h->boredom, h->fear, curr, h->device, false);
         }
+    }
+
+	// r we either too scared or too bored
+    if (current_fear >= HUNTER_FEAR_MAX) {
+        h->running = false;
+        h->exit_reason = LR_AFRAID;
+        lock_acquire(&curr->mutex); 
+        room_remove_hunter(curr, h);
+        log_exit(h->id, h->boredom, h->fear, curr, h->device, LR_AFRAID);
+        lock_release(&curr->mutex);
+        return false;
+    }
+    if (current_boredom >= ENTITY_BOREDOM_MAX) {
+        h->running = false;
+        h->exit_reason = LR_BORED;
+        lock_acquire(&curr->mutex);
+        room_remove_hunter(curr, h);
+        log_exit(h->id, h->boredom, h->fear, curr, h->device, LR_BORED);
+        lock_release(&curr->mutex);
+        return false;
+    }
 
-		// if we're not in the van and we're not too scared/bored
-        if (!curr->is_exit) {
-        	// lock room to check for evidence
-            sem_wait(&curr->mutex);
+	// if we're not in the van and we're not too scared/bored
+    if (!curr->is_exit) {
+        // clear our device's bit; only the hunter that saw it set gets to collect it
+        // (acquire pairs with the ghost's release, so our log follows its EVIDENCE event)
+        EvidenceByte found = atomic_fetch_and_explicit(&curr->evidence, (EvidenceByte)~h->device, memory_order_acquire);
+        if (found & h->device) {
+            // the mask right after our bit went in, no matter what other hunters do meanwhile
+            EvidenceByte collected = atomic_fetch_or_explicit(&h->case_file->collected, (EvidenceByte)h->device, memory_order_acq_rel) | h->device;
+            const struct EvidenceInfo* info = &evidence_table[collected];
+            if (info->count >= 3 && info->is_ghost) {
+                atomic_store_explicit(&h->case_file->solved, true, memory_order_release); // we won woohoo
+            }
+
+            if (check_enabled) {
+                check_hunter_collect(h, curr);
+            }
+            log_evidence(h->id, h->boredom, h->fear, curr, h->device);
             
-            // check using bitwise if evidence/device is compatible
-            if (curr->evidence & h->device) {
-                curr->evidence &= ~h->device;
-                sem_post(&curr->mutex);
-
-                sem_wait(&h->case_file->mutex);
-                h->case_file->collected |= h->device;
-                if (evidence_has_three_unique(h->case_file->collected)) {
-                     if (evidence_is_valid_ghost(h->case_file->collected)) {
-                         h->case_file->solved = true; // we won woohoo	
-                     }
-                }
-                sem_post(&h->case_file->mutex);
-
-                log_evidence(h->id, h->boredom, h->fear, curr->name, h->device);
-                
-                h->boredom = 0; 
+            h->boredom = 0; 
+            h->return_to_van = true;
+            log_return_to_van(h->id, h->boredom, h->fear, curr, h->device, true);
+        } else {
+            int r = rand_stream_int(&h->rng, 0, 100);
+            if (r < 10) { 
                 h->return_to_van = true;
-                log_return_to_van(h->id, h->boredom, h->fear, curr->name, h->device, true);
-            } else {
-                sem_post(&curr->mutex);
-                int r = rand_int_threadsafe(0, 100);
-                if (r < 10) { 
-                    h->return_to_van = true;
-                    log_return_to_van(h->id, h->boredom, h->fear, curr->name, h->device, true);
-                }
+                log_return_to_van(h->id, h->boredom, h->fear, curr, h->device, true);
             }
         }
+    }
+
+    struct Room* next_room = NULL;
+
+	// if we're returning to van
+    if (h->return_to_van) {
+         next_room = stack_pop(&h->path_stack, curr->house);
+         if (check_enabled) {
+             check_hunter_return(h, curr, next_room);
+         }
+    } else {
+        int r = rand_stream_int(&h->rng, 0, room_degree(curr));
+        next_room = room_neighbour(curr, r);
+    }
 
-        struct Room* next_room = NULL;
+	// go to next room
+    if (next_room) {
+    	// move safely with deadlock prevention
+    	// compare memory addresses of both rooms and lock lower address first
+        struct Room *first = (curr < next_room) ? curr : next_room;
+        struct Room *second = (curr < next_room) ? next_room : curr;
 
-		// if we're returning to van
-        if (h->return_to_van) {
-             next_room = stack_pop(&h->path_stack);
+        lock_acquire(&first->mutex);
+        lock_acquire(&second->mutex);
+
+        if (next_room->is_exit || next_room->num_hunters < MAX_ROOM_OCCUPANCY) {
+            room_remove_hunter(curr, h);
+            room_add_hunter(next_room, h);
+            h->room = next_room;
+            
+            if (!h->return_to_van) {
+            	// push the room onto the breadcrumb stack
+                stack_push(&h->path_stack, curr);
+            }
+            if (check_enabled) {
+                check_hunter_move(h, curr, next_room);
+            }
+            
+            log_move(h->id, h->boredom, h->fear, curr, next_room, h->device);
         } else {
-            int r = rand_int_threadsafe(0, curr->num_connected);
-            next_room = curr->connected[r];
+            if (h->return_to_van) {
+            	// pop next_room back onto the stack (since it was popped off before in line 163)
+                stack_push(&h->path_stack, next_room);
+            }
         }
 
-		// go to next room
-        if (next_room) {
-        	// move safely with deadlock prevention
-        	// compare memory addresses of both rooms and lock lower address first
-            struct Room *first = (curr < next_room) ? curr : next_room;
-            struct Room *second = (curr < next_room) ? next_room : curr;
-
-            sem_wait(&first->mutex);
-            sem_wait(&second->mutex);
-
-            if (next_room->num_hunters < MAX_ROOM_OCCUPANCY) {
-                room_remove_hunter(curr, h);
-                room_add_hunter(next_room, h);
-                h->room = next_room;
-                
-                if (!h->return_to_van) {
-                	// push the room onto the breadcrumb stack
-                    stack_push(&h->path_stack, curr);
-                }
-                
-                log_move(h->id, h->boredom, h->fear, curr->name, next_room->name, h->device);
-            } else {
-                if (h->return_to_van) {
-                	// pop next_room back onto the stack (since it was popped off before in line 163)
-                    stack_push(&h->path_stack, next_room);
-                }
-            }
+        lock_release(&second->mutex);
+        lock_release(&first->mutex);
+    }
+    
+    return true;
+}
+
+/**
+ * @brief The thread function for a hunter. Takes turns until the hunter exits
+ *
+ * @param arg Void pointer to the Hunter struct, casted to Hunter immediately
+ * @return NULL after thread is over
+ */
+void* hunter_thread(void* arg) {
+    struct Hunter* h = (struct Hunter*)arg;
 
-            sem_post(&second->mutex);
-            sem_post(&first->mutex);
+    while (h->running) {
+        if (!hunter_step(h)) {
+            break;
         }
-        
+
         // added a little delay so you can see the hunter actions more clearly
         usleep(10000); 
     }
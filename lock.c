@@ -0,0 +1,462 @@
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "lock.h"
+
+#define LOCK_SPINS_BEFORE_YIELD 64
+
+// Tell the CPU we are spinning (frees resources for the sibling hyperthread)
+static inline void lock_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// ---- sem_t ----
+void sem_lock_init(struct SemLock* lock) {
+    sem_init(&lock->sem, 0, 1);
+}
+
+void sem_lock_acquire(struct SemLock* lock) {
+    sem_wait(&lock->sem);
+}
+
+bool sem_lock_try_acquire(struct SemLock* lock) {
+    return sem_trywait(&lock->sem) == 0;
+}
+
+void sem_lock_release(struct SemLock* lock) {
+    sem_post(&lock->sem);
+}
+
+void sem_lock_destroy(struct SemLock* lock) {
+    sem_destroy(&lock->sem);
+}
+
+// ---- pthread_mutex_t ----
+void mutex_lock_init(struct MutexLock* lock) {
+    pthread_mutex_init(&lock->mutex, NULL);
+}
+
+void mutex_lock_acquire(struct MutexLock* lock) {
+    pthread_mutex_lock(&lock->mutex);
+}
+
+bool mutex_lock_try_acquire(struct MutexLock* lock) {
+    return pthread_mutex_trylock(&lock->mutex) == 0;
+}
+
+void mutex_lock_release(struct MutexLock* lock) {
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+void mutex_lock_destroy(struct MutexLock* lock) {
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+// ---- ticket spinlock ----
+void ticket_lock_init(struct TicketLock* lock) {
+    atomic_init(&lock->next, 0);
+    atomic_init(&lock->serving, 0);
+}
+
+void ticket_lock_acquire(struct TicketLock* lock) {
+    unsigned ticket = atomic_fetch_add_explicit(&lock->next, 1, memory_order_relaxed);
+    int spins = 0;
+    while (atomic_load_explicit(&lock->serving, memory_order_acquire) != ticket) {
+        if (++spins < LOCK_SPINS_BEFORE_YIELD) {
+            lock_cpu_relax();
+        } else {
+            spins = 0;
+            sched_yield();
+        }
+    }
+}
+
+bool ticket_lock_try_acquire(struct TicketLock* lock) {
+    // only take a ticket if it would be served right away
+    unsigned serving = atomic_load_explicit(&lock->serving, memory_order_relaxed);
+    unsigned next = serving;
+    return atomic_compare_exchange_strong_explicit(&lock->next, &next, serving + 1, memory_order_acquire, memory_order_relaxed);
+}
+
+void ticket_lock_release(struct TicketLock* lock) {
+    // only the holder writes serving, so a plain load + store is enough
+    unsigned serving = atomic_load_explicit(&lock->serving, memory_order_relaxed);
+    atomic_store_explicit(&lock->serving, serving + 1, memory_order_release);
+}
+
+void ticket_lock_destroy(struct TicketLock* lock) {
+    (void)lock;
+}
+
+// ---- test-and-test-and-set spinlock ----
+void ttas_lock_init(struct TtasLock* lock) {
+    atomic_init(&lock->locked, false);
+}
+
+void ttas_lock_acquire(struct TtasLock* lock) {
+    int spins = 0;
+    while (1) {
+        // only try the (cache line stealing) exchange once the lock looks free
+        if (!atomic_load_explicit(&lock->locked, memory_order_relaxed) &&
+            !atomic_exchange_explicit(&lock->locked, true, memory_order_acquire)) {
+            return;
+        }
+        if (++spins < LOCK_SPINS_BEFORE_YIELD) {
+            lock_cpu_relax();
+        } else {
+            spins = 0;
+            sched_yield();
+        }
+    }
+}
+
+bool ttas_lock_try_acquire(struct TtasLock* lock) {
+    return !atomic_load_explicit(&lock->locked, memory_order_relaxed) &&
+           !atomic_exchange_explicit(&lock->locked, true, memory_order_acquire);
+}
+
+void ttas_lock_release(struct TtasLock* lock) {
+    atomic_store_explicit(&lock->locked, false, memory_order_release);
+}
+
+void ttas_lock_destroy(struct TtasLock* lock) {
+    (void)lock;
+}
+
+// ---- futex mutex (Drepper, "Futexes Are Tricky", mutex3) ----
+static void futex_wait(atomic_int* address, int expected) {
+#ifdef __linux__
+    syscall(SYS_futex, (int*)address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    (void)address;
+    (void)expected;
+    sched_yield();
+#endif
+}
+
+static void futex_wake_one(atomic_int* address) {
+#ifdef __linux__
+    syscall(SYS_futex, (int*)address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void)address;
+#endif
+}
+
+void futex_lock_init(struct FutexLock* lock) {
+    atomic_init(&lock->state, 0);
+}
+
+void futex_lock_acquire(struct FutexLock* lock) {
+    int state = 0;
+    if (atomic_compare_exchange_strong_explicit(&lock->state, &state, 1, memory_order_acquire, memory_order_relaxed)) {
+        return;     // uncontended: no system call
+    }
+    // mark the lock contended and sleep until we are the one that flips it from 0
+    if (state != 2) {
+        state = atomic_exchange_explicit(&lock->state, 2, memory_order_acquire);
+    }
+    while (state != 0) {
+        futex_wait(&lock->state, 2);
+        state = atomic_exchange_explicit(&lock->state, 2, memory_order_acquire);
+    }
+}
+
+bool futex_lock_try_acquire(struct FutexLock* lock) {
+    int state = 0;
+    return atomic_compare_exchange_strong_explicit(&lock->state, &state, 1, memory_order_acquire, memory_order_relaxed);
+}
+
+void futex_lock_release(struct FutexLock* lock) {
+    if (atomic_fetch_sub_explicit(&lock->state, 1, memory_order_release) != 1) {
+        atomic_store_explicit(&lock->state, 0, memory_order_release);
+        futex_wake_one(&lock->state);
+    }
+}
+
+void futex_lock_destroy(struct FutexLock* lock) {
+    (void)lock;
+}
+
+// ---- build-time backend ----
+#if defined(LOCK_BACKEND_MUTEX)
+#define LOCK_CALL(operation) mutex_lock_##operation
+#elif defined(LOCK_BACKEND_TICKET)
+#define LOCK_CALL(operation) ticket_lock_##operation
+#elif defined(LOCK_BACKEND_TTAS)
+#define LOCK_CALL(operation) ttas_lock_##operation
+#elif defined(LOCK_BACKEND_FUTEX)
+#define LOCK_CALL(operation) futex_lock_##operation
+#else
+#define LOCK_CALL(operation) sem_lock_##operation
+#endif
+
+#ifdef LOCK_STATS
+// ---- statistics (make LOCKSTATS=1) ----
+#define LOCK_STATS_REPORT_ROWS 40       // Rows of the table (most waited-on locks first)
+#define LOCK_STATS_REPORT_HISTOGRAMS 5  // Locks whose histograms are printed in full
+
+// One name in the process-wide table: the sum over every lock destroyed under that name
+struct LockStatsEntry {
+    char* name;
+    unsigned long long locks;
+    struct LockStats total;
+};
+
+static pthread_mutex_t lock_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct LockStatsEntry* lock_stats_table = NULL;  // Open addressing, NULL name = free
+static size_t lock_stats_capacity = 0;
+static size_t lock_stats_count = 0;
+
+static long long lock_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Bucket i holds [2^(i-1), 2^i) ns
+static int lock_stats_bucket(long long ns) {
+    if (ns <= 0) {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll((unsigned long long)ns);
+    return bucket < LOCK_STATS_BUCKETS ? bucket : LOCK_STATS_BUCKETS - 1;
+}
+
+static size_t lock_stats_hash(const char* name) {
+    size_t hash = 14695981039346656037ULL;     // FNV-1a
+    for (const unsigned char* c = (const unsigned char*)name; *c; c++) {
+        hash = (hash ^ *c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Finds the table entry for a name, adding it if needed (lock_stats_mutex held)
+ *
+ * @param name Lock name
+ * @return The entry, or NULL if out of memory
+ */
+static struct LockStatsEntry* lock_stats_entry(const char* name) {
+    if ((lock_stats_count + 1) * 2 > lock_stats_capacity) {
+        size_t capacity = lock_stats_capacity ? lock_stats_capacity * 2 : 64;
+        struct LockStatsEntry* table = calloc(capacity, sizeof(struct LockStatsEntry));
+        if (!table) {
+            return NULL;
+        }
+        for (size_t i = 0; i < lock_stats_capacity; i++) {
+            if (lock_stats_table[i].name) {
+                size_t slot = lock_stats_hash(lock_stats_table[i].name) & (capacity - 1);
+                while (table[slot].name) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                table[slot] = lock_stats_table[i];
+            }
+        }
+        free(lock_stats_table);
+        lock_stats_table = table;
+        lock_stats_capacity = capacity;
+    }
+
+    size_t slot = lock_stats_hash(name) & (lock_stats_capacity - 1);
+    while (lock_stats_table[slot].name && strcmp(lock_stats_table[slot].name, name) != 0) {
+        slot = (slot + 1) & (lock_stats_capacity - 1);
+    }
+    struct LockStatsEntry* entry = &lock_stats_table[slot];
+    if (!entry->name) {
+        entry->name = strdup(name);
+        if (!entry->name) {
+            return NULL;
+        }
+        entry->total.name = entry->name;
+        lock_stats_count++;
+    }
+    return entry;
+}
+
+// Adds a lock's counters to the table, under its name
+static void lock_stats_fold(const struct LockStats* stats) {
+    if (stats->acquired == 0) {
+        return;
+    }
+    pthread_mutex_lock(&lock_stats_mutex);
+    struct LockStatsEntry* entry = lock_stats_entry(stats->name ? stats->name : "(unnamed)");
+    if (entry) {
+        entry->locks++;
+        entry->total.acquired += stats->acquired;
+        entry->total.contended += stats->contended;
+        entry->total.wait_ns += stats->wait_ns;
+        entry->total.hold_ns += stats->hold_ns;
+        for (int i = 0; i < LOCK_STATS_BUCKETS; i++) {
+            entry->total.wait[i] += stats->wait[i];
+            entry->total.hold[i] += stats->hold[i];
+        }
+    }
+    pthread_mutex_unlock(&lock_stats_mutex);
+}
+
+// Upper bound (ns) of the bucket the percent-th percentile falls in
+static unsigned long long lock_stats_percentile(const unsigned long long* buckets, unsigned long long count, int percent) {
+    unsigned long long rank = (count * percent + 99) / 100;
+    unsigned long long seen = 0;
+    for (int i = 0; i < LOCK_STATS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank && buckets[i] > 0) {
+            return i == 0 ? 0 : 1ULL << i;
+        }
+    }
+    return 1ULL << (LOCK_STATS_BUCKETS - 1);
+}
+
+// Short human readable time (ns, us, ms, s)
+static const char* lock_stats_time(unsigned long long ns, char* text, size_t size) {
+    if (ns < 10000ULL) {
+        snprintf(text, size, "%lluns", ns);
+    } else if (ns < 10000000ULL) {
+        snprintf(text, size, "%lluus", ns / 1000ULL);
+    } else if (ns < 10000000000ULL) {
+        snprintf(text, size, "%llums", ns / 1000000ULL);
+    } else {
+        snprintf(text, size, "%llus", ns / 1000000000ULL);
+    }
+    return text;
+}
+
+static int lock_stats_compare(const void* a, const void* b) {
+    const struct LockStatsEntry* x = *(const struct LockStatsEntry* const*)a;
+    const struct LockStatsEntry* y = *(const struct LockStatsEntry* const*)b;
+    if (x->total.wait_ns != y->total.wait_ns) {
+        return x->total.wait_ns < y->total.wait_ns ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+// One histogram line: the non-empty buckets as "<upper bound>:count" (0ns: no wait at all)
+static void lock_stats_print_histogram(FILE* out, const char* label, const unsigned long long* buckets) {
+    char text[32];
+    fprintf(out, "    %s", label);
+    if (buckets[0] > 0) {
+        fprintf(out, " 0ns:%llu", buckets[0]);
+    }
+    for (int i = 1; i < LOCK_STATS_BUCKETS; i++) {
+        if (buckets[i] > 0) {
+            fprintf(out, " %s%s:%llu", i == LOCK_STATS_BUCKETS - 1 ? ">" : "<",
+                    lock_stats_time(1ULL << (i == LOCK_STATS_BUCKETS - 1 ? i - 1 : i), text, sizeof(text)), buckets[i]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+void lock_set_name(struct SimLock* lock, const char* name) {
+    lock->stats.name = name;
+}
+
+void lock_stats_report(FILE* out) {
+    pthread_mutex_lock(&lock_stats_mutex);
+    struct LockStatsEntry** sorted = malloc(sizeof(struct LockStatsEntry*) * (lock_stats_count + 1));
+    size_t count = 0;
+    for (size_t i = 0; sorted && i < lock_stats_capacity; i++) {
+        if (lock_stats_table[i].name) {
+            sorted[count++] = &lock_stats_table[i];
+        }
+    }
+    if (count > 0) {
+        qsort(sorted, count, sizeof(struct LockStatsEntry*), lock_stats_compare);
+
+        char a[32], b[32], c[32], d[32], e[32], f[32];
+        fprintf(out, "Lock statistics (%s, %zu names, most waited-on first; percentiles are log2 bucket bounds):\n",
+                LOCK_BACKEND_NAME, count);
+        fprintf(out, "  %-20s %6s %12s %9s %9s %9s %9s %9s %9s %9s\n", "lock", "locks", "acquired", "contended",
+                "wait sum", "wait p50", "wait p99", "hold sum", "hold p50", "hold p99");
+        for (size_t i = 0; i < count && i < LOCK_STATS_REPORT_ROWS; i++) {
+            const struct LockStats* total = &sorted[i]->total;
+            fprintf(out, "  %-20s %6llu %12llu %8.2f%% %9s %9s %9s %9s %9s %9s\n", sorted[i]->name, sorted[i]->locks,
+                    total->acquired, 100.0 * total->contended / total->acquired,
+                    lock_stats_time(total->wait_ns, a, sizeof(a)),
+                    lock_stats_time(lock_stats_percentile(total->wait, total->acquired, 50), b, sizeof(b)),
+                    lock_stats_time(lock_stats_percentile(total->wait, total->acquired, 99), c, sizeof(c)),
+                    lock_stats_time(total->hold_ns, d, sizeof(d)),
+                    lock_stats_time(lock_stats_percentile(total->hold, total->acquired, 50), e, sizeof(e)),
+                    lock_stats_time(lock_stats_percentile(total->hold, total->acquired, 99), f, sizeof(f)));
+        }
+        if (count > LOCK_STATS_REPORT_ROWS) {
+            fprintf(out, "  ... %zu more\n", count - LOCK_STATS_REPORT_ROWS);
+        }
+        for (size_t i = 0; i < count && i < LOCK_STATS_REPORT_HISTOGRAMS; i++) {
+            fprintf(out, "  %s:\n", sorted[i]->name);
+            lock_stats_print_histogram(out, "wait", sorted[i]->total.wait);
+            lock_stats_print_histogram(out, "hold", sorted[i]->total.hold);
+        }
+    }
+    free(sorted);
+    pthread_mutex_unlock(&lock_stats_mutex);
+}
+
+void lock_init(struct SimLock* lock) {
+    LOCK_CALL(init)(&lock->impl);
+    memset(&lock->stats, 0, sizeof(lock->stats));
+}
+
+void lock_acquire(struct SimLock* lock) {
+    long long waited = 0;
+    if (LOCK_CALL(try_acquire)(&lock->impl)) {
+        lock->stats.held_since = lock_now_ns();
+    } else {
+        long long start = lock_now_ns();
+        LOCK_CALL(acquire)(&lock->impl);
+        lock->stats.held_since = lock_now_ns();
+        waited = lock->stats.held_since - start;
+        lock->stats.contended++;
+    }
+    // ours now, so nobody else writes the counters
+    lock->stats.acquired++;
+    lock->stats.wait_ns += (unsigned long long)waited;
+    lock->stats.wait[lock_stats_bucket(waited)]++;
+}
+
+void lock_release(struct SimLock* lock) {
+    long long held = lock_now_ns() - lock->stats.held_since;
+    lock->stats.hold_ns += (unsigned long long)held;
+    lock->stats.hold[lock_stats_bucket(held)]++;
+    LOCK_CALL(release)(&lock->impl);
+}
+
+void lock_destroy(struct SimLock* lock) {
+    lock_stats_fold(&lock->stats);
+    LOCK_CALL(destroy)(&lock->impl);
+}
+#else
+void lock_init(struct SimLock* lock) {
+    LOCK_CALL(init)(&lock->impl);
+}
+
+void lock_acquire(struct SimLock* lock) {
+    LOCK_CALL(acquire)(&lock->impl);
+}
+
+void lock_release(struct SimLock* lock) {
+    LOCK_CALL(release)(&lock->impl);
+}
+
+void lock_destroy(struct SimLock* lock) {
+    LOCK_CALL(destroy)(&lock->impl);
+}
+
+void lock_set_name(struct SimLock* lock, const char* name) {
+    (void)lock;
+    (void)name;
+}
+
+void lock_stats_report(FILE* out) {
+    (void)out;
+}
+#endif
@@ -0,0 +1,161 @@
+#ifndef LOCK_H
+#define LOCK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+/*
+    Small lock API used by rooms and the ghost (struct SimLock), with the backend chosen at
+    build time:
+
+        make LOCK=sem       sem_t used as a binary semaphore (default, what the project started with)
+        make LOCK=mutex     pthread_mutex_t
+        make LOCK=ticket    ticket spinlock (FIFO)
+        make LOCK=ttas      test-and-test-and-set spinlock
+        make LOCK=futex     three-state futex mutex (Linux only)
+
+    Every backend is also available under its own name so bench_locks can compare them in one
+    binary. The spinlocks yield the CPU after a short spin, otherwise a waiter could burn its
+    whole time slice while the holder is descheduled (hunters usually outnumber cores).
+
+    make LOCKSTATS=1 (-DLOCK_STATS) also counts every SimLock: acquisitions, how many found the
+    lock taken, and log2 histograms of the time spent waiting for it and holding it. A lock's
+    counters are only written by its holder, so they need no atomics. When a lock is destroyed
+    its counters are added to a process-wide table under its name (rooms of every house of a
+    batch add up), which lock_stats_report() prints at exit. Without the flag SimLock is just
+    the backend and the stats calls do nothing.
+*/
+
+struct SemLock {
+    sem_t sem;
+};
+
+struct MutexLock {
+    pthread_mutex_t mutex;
+};
+
+struct TicketLock {
+    atomic_uint next;       // Next ticket to hand out
+    atomic_uint serving;    // Ticket that owns the lock
+};
+
+struct TtasLock {
+    atomic_bool locked;
+};
+
+struct FutexLock {
+    atomic_int state;       // 0 unlocked, 1 locked, 2 locked with (possible) waiters
+};
+
+void sem_lock_init(struct SemLock* lock);
+void sem_lock_acquire(struct SemLock* lock);
+bool sem_lock_try_acquire(struct SemLock* lock);
+void sem_lock_release(struct SemLock* lock);
+void sem_lock_destroy(struct SemLock* lock);
+
+void mutex_lock_init(struct MutexLock* lock);
+void mutex_lock_acquire(struct MutexLock* lock);
+bool mutex_lock_try_acquire(struct MutexLock* lock);
+void mutex_lock_release(struct MutexLock* lock);
+void mutex_lock_destroy(struct MutexLock* lock);
+
+void ticket_lock_init(struct TicketLock* lock);
+void ticket_lock_acquire(struct TicketLock* lock);
+bool ticket_lock_try_acquire(struct TicketLock* lock);
+void ticket_lock_release(struct TicketLock* lock);
+void ticket_lock_destroy(struct TicketLock* lock);
+
+void ttas_lock_init(struct TtasLock* lock);
+void ttas_lock_acquire(struct TtasLock* lock);
+bool ttas_lock_try_acquire(struct TtasLock* lock);
+void ttas_lock_release(struct TtasLock* lock);
+void ttas_lock_destroy(struct TtasLock* lock);
+
+void futex_lock_init(struct FutexLock* lock);
+void futex_lock_acquire(struct FutexLock* lock);
+bool futex_lock_try_acquire(struct FutexLock* lock);
+void futex_lock_release(struct FutexLock* lock);
+void futex_lock_destroy(struct FutexLock* lock);
+
+// The build-time choice, see the Makefile (LOCK=...)
+#if defined(LOCK_BACKEND_MUTEX)
+#define LOCK_BACKEND_NAME "mutex"
+#define LOCK_IMPL MutexLock
+#elif defined(LOCK_BACKEND_TICKET)
+#define LOCK_BACKEND_NAME "ticket"
+#define LOCK_IMPL TicketLock
+#elif defined(LOCK_BACKEND_TTAS)
+#define LOCK_BACKEND_NAME "ttas"
+#define LOCK_IMPL TtasLock
+#elif defined(LOCK_BACKEND_FUTEX)
+#define LOCK_BACKEND_NAME "futex"
+#define LOCK_IMPL FutexLock
+#else
+#define LOCK_BACKEND_NAME "sem"
+#define LOCK_IMPL SemLock
+#endif
+
+#ifdef LOCK_STATS
+// Bucket i counts times in [2^(i-1), 2^i) ns (bucket 0: no wait, the last one: everything longer)
+#define LOCK_STATS_BUCKETS 32
+
+struct LockStats {
+    const char* name;           // Set with lock_set_name (NULL: counted as "(unnamed)")
+    unsigned long long acquired;
+    unsigned long long contended;   // Acquisitions that found the lock taken
+    unsigned long long wait_ns;     // Totals, for the means
+    unsigned long long hold_ns;
+    unsigned long long wait[LOCK_STATS_BUCKETS];
+    unsigned long long hold[LOCK_STATS_BUCKETS];
+    long long held_since;       // CLOCK_MONOTONIC ns of the current acquisition
+};
+#endif
+
+struct SimLock {
+    struct LOCK_IMPL impl;
+#ifdef LOCK_STATS
+    struct LockStats stats;
+#endif
+};
+
+/**
+ * @brief Set up an unlocked lock.
+ * @param[out] lock Lock to initialise.
+ */
+void lock_init(struct SimLock* lock);
+
+/**
+ * @brief Block until the lock is ours.
+ * @param[in,out] lock Lock to take.
+ */
+void lock_acquire(struct SimLock* lock);
+
+/**
+ * @brief Give the lock back.
+ * @param[in,out] lock Lock held by the caller.
+ */
+void lock_release(struct SimLock* lock);
+
+/**
+ * @brief Release anything the backend allocated.
+ * @param[in,out] lock Unlocked lock that is no longer used.
+ */
+void lock_destroy(struct SimLock* lock);
+
+/**
+ * @brief Name the lock's row in the statistics (only used with LOCK_STATS).
+ * @param[in,out] lock Lock to name.
+ * @param[in] name Name to report it under; must stay valid until lock_destroy().
+ */
+void lock_set_name(struct SimLock* lock, const char* name);
+
+/**
+ * @brief Print the statistics of every destroyed lock, most waited-on first (only with LOCK_STATS).
+ * @param[in] out Stream to print to.
+ */
+void lock_stats_report(FILE* out);
+
+#endif // LOCK_H
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glob.h>
+#include "defs.h"
+#include "eventlog.h"
+
+/*
+    Converts the binary logs of one hunt (log_<id>.bin + log_rooms.txt) back into the
+    exact CSV files the simulation would have written (log_<id>.csv), so validate_logs.py
+    can be run on them.
+
+    Usage: ./log_export [--order] [directory]     (default: current directory)
+
+    --order appends each event's seq and mono_ns columns, as --log-order does for CSV logs.
+*/
+
+/**
+ * @brief Converts one binary log into CSV
+ *
+ * @param bin_path Path to log_<id>.bin
+ * @param rooms Room names of the hunt
+ * @param order_columns Whether to append the seq and mono_ns columns
+ * @return Number of events written, or -1 on error
+ */
+static long export_file(const char* bin_path, const struct LogRoomTable* rooms, bool order_columns) {
+    FILE* in = fopen(bin_path, "rb");
+    if (!in) {
+        fprintf(stderr, "Could not open %s\n", bin_path);
+        return -1;
+    }
+
+    struct LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || !log_header_is_valid(&header)) {
+        fprintf(stderr, "%s is not a version %d binary log\n", bin_path, LOG_BINARY_VERSION);
+        fclose(in);
+        return -1;
+    }
+
+    // log_<id>.bin -> log_<id>.csv in the same directory
+    char csv_path[1024];
+    snprintf(csv_path, sizeof(csv_path), "%s", bin_path);
+    size_t length = strlen(csv_path);
+    if (length < 4) {
+        fclose(in);
+        return -1;
+    }
+    strcpy(csv_path + length - 4, ".csv");
+
+    FILE* out = fopen(csv_path, "w");
+    if (!out) {
+        fprintf(stderr, "Could not create %s\n", csv_path);
+        fclose(in);
+        return -1;
+    }
+
+    // read in large chunks, the records are fixed size
+    enum { CHUNK = 4096 };
+    struct LogEvent* events = malloc(sizeof(struct LogEvent) * CHUNK);
+    long written = 0;
+    size_t count;
+    while (events && (count = fread(events, sizeof(struct LogEvent), CHUNK, in)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const struct LogEvent* event = &events[i];
+            const char* extra_room = event->action == LOG_ACTION_MOVE ? log_room_table_name(rooms, event->extra) : NULL;
+            log_event_write_csv(out, event, log_room_table_name(rooms, event->room), extra_room, header.name, order_columns);
+        }
+        written += (long)count;
+    }
+
+    free(events);
+    fclose(out);
+    fclose(in);
+    return written;
+}
+
+int main(int argc, char* argv[]) {
+    bool order_columns = false;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--order") == 0) {
+        order_columns = true;
+        arg++;
+    }
+    const char* directory = arg < argc ? argv[arg] : ".";
+    if (argc > arg + 1 || strcmp(directory, "--help") == 0) {
+        printf("Usage: %s [--order] [directory]\n", argv[0]);
+        return argc > arg + 1 ? 1 : 0;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", directory, LOG_ROOMS_FILE);
+    struct LogRoomTable rooms;
+    if (log_room_table_load(path, &rooms) != 0) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/log_*.bin", directory);
+    glob_t matches;
+    if (glob(path, 0, NULL, &matches) != 0) {
+        fprintf(stderr, "No binary logs found in %s\n", directory);
+        log_room_table_free(&rooms);
+        return 1;
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < matches.gl_pathc; i++) {
+        long events = export_file(matches.gl_pathv[i], &rooms, order_columns);
+        if (events < 0) {
+            status = 1;
+            continue;
+        }
+        printf("%s: %ld events\n", matches.gl_pathv[i], events);
+    }
+
+    globfree(&matches);
+    log_room_table_free(&rooms);
+    return status;
+}
@@ -0,0 +1,755 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "helpers.h"
+#include "eventlog.h"
+
+/*
+    Reconstructs the state of one hunt at any point of its binary logs (log_<id>.bin +
+    log_rooms.txt): where every hunter and the ghost is, their boredom, fear, device and
+    whether they are heading back to the van, the evidence left in each room and the case file.
+
+    Usage: ./log_replay [options] [directory]     (default: current directory)
+        --event N       state after the first N events (default: the end of the hunt)
+        --time T        state after every event up to timestamp T in ms; +T counts from the first event
+        --events C      then print the next C events (CSV lines with seq,mono_ns)
+        --interval K    events between keyframes when the index is built (default: 4096)
+        --reindex       rebuild the index even if it matches the logs
+
+    The logs are merged by sequence number (eventlog.h), which is the order the events
+    happened in. The first run over a directory writes log_index.idx next to the logs: a
+    keyframe of the full state every K events, plus where each log file was at that point.
+    A seek then loads the keyframe before the target and replays at most K events, however
+    long the hunt is. The index is rebuilt when the logs no longer match it.
+
+    Filtered logs (--log-filter) replay fine, but the state only shows what was logged.
+*/
+
+#define REPLAY_INDEX_FILE "log_index.idx"
+#define REPLAY_INDEX_MAGIC "GHLI"
+#define REPLAY_INDEX_VERSION 1
+#define REPLAY_DEFAULT_INTERVAL 4096
+#define REPLAY_NOT_EXITED 0xff
+
+// What the logs say about one hunter or the ghost
+struct ReplayEntity {
+    uint32_t room;          // LOG_NO_ROOM before INIT and after EXIT
+    int16_t  boredom;
+    int16_t  fear;
+    uint8_t  device;        // Hunter device, or the GhostType of the ghost
+    uint8_t  returning;     // Hunter is following its breadcrumbs back to the van
+    uint8_t  exit_reason;   // LogReason once it left, REPLAY_NOT_EXITED before
+    uint8_t  reserved;
+};
+
+// Counters of a keyframe; the per-file arrays and room evidence follow it in the index
+struct ReplayKeyframe {
+    uint64_t event;         // Events applied so far
+    uint64_t sequence;      // Sequence number of the last of them
+    int64_t  timestamp;     // Latest timestamp among them, INT64_MIN before the first
+    uint32_t collected;     // Case file evidence mask
+    uint32_t reserved;
+};
+
+// Start of log_index.idx
+struct ReplayIndexHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t log_version;   // LOG_BINARY_VERSION of the indexed logs
+    uint32_t interval;
+    uint32_t file_count;
+    uint32_t room_count;
+    uint64_t event_count;
+    uint64_t keyframe_count;
+};
+
+// One per log file after the header, to tell whether the index still matches the logs
+struct ReplayIndexFile {
+    int32_t  entity_id;
+    int32_t  entity_type;
+    uint64_t record_count;
+};
+
+// A log file being read in sequence order
+struct ReplayLog {
+    FILE* file;
+    struct LogFileHeader header;
+    uint64_t record_count;
+    uint64_t position;      // Records consumed, including the one in next
+    struct LogEvent next;
+    bool has_next;
+};
+
+// The full state at one point of the hunt
+struct ReplayState {
+    struct ReplayKeyframe frame;
+    uint64_t* positions;            // Per log file, records applied
+    struct ReplayEntity* entities;  // Per log file
+    EvidenceByte* evidence;         // Per room
+    uint32_t* merge;                // Logs with a record left, a min-heap on the next sequence number
+    uint32_t merge_count;
+};
+
+/**
+ * @brief Reads the next record of a log into its cursor
+ *
+ * @param log Pointer to the ReplayLog
+ */
+static void replay_log_fill(struct ReplayLog* log) {
+    log->has_next = log->position < log->record_count && fread(&log->next, sizeof(log->next), 1, log->file) == 1;
+    if (log->has_next) {
+        log->position++;
+    }
+}
+
+/**
+ * @brief Opens every binary log of a hunt, sorted by file name
+ *
+ * @param directory Hunt directory
+ * @param count Receives the number of logs
+ * @return Array of open logs, NULL on error (already reported)
+ */
+static struct ReplayLog* replay_open_logs(const char* directory, uint32_t* count) {
+    char pattern[1024];
+    snprintf(pattern, sizeof(pattern), "%s/log_*.bin", directory);
+    glob_t matches;
+    if (glob(pattern, 0, NULL, &matches) != 0) {
+        fprintf(stderr, "No binary logs found in %s\n", directory);
+        return NULL;
+    }
+
+    struct ReplayLog* logs = calloc(matches.gl_pathc, sizeof(struct ReplayLog));
+    *count = 0;
+    for (size_t i = 0; logs && i < matches.gl_pathc; i++) {
+        const char* path = matches.gl_pathv[i];
+        struct ReplayLog* log = &logs[*count];
+        struct stat info;
+        log->file = fopen(path, "rb");
+        if (!log->file || stat(path, &info) != 0 ||
+            fread(&log->header, sizeof(log->header), 1, log->file) != 1 || !log_header_is_valid(&log->header)) {
+            fprintf(stderr, "%s is not a version %d binary log\n", path, LOG_BINARY_VERSION);
+            if (log->file) {
+                fclose(log->file);
+            }
+            for (uint32_t j = *count; j-- > 0;) {
+                fclose(logs[j].file);
+            }
+            free(logs);
+            globfree(&matches);
+            return NULL;
+        }
+        // a record cut short by a crash is ignored
+        log->record_count = ((uint64_t)info.st_size - sizeof(log->header)) / sizeof(struct LogEvent);
+        (*count)++;
+    }
+    globfree(&matches);
+    return logs;
+}
+
+static void replay_close_logs(struct ReplayLog* logs, uint32_t count) {
+    // newest first: glibc unlinks each FILE from a list of every open one, newest at the head
+    for (uint32_t i = count; i-- > 0;) {
+        fclose(logs[i].file);
+    }
+    free(logs);
+}
+
+/**
+ * @brief Restores the heap order below one slot of the merge
+ *
+ * There is one log per entity, and with --hunters in the thousands a scan for the
+ * earliest record per event would cost more than everything else, hence the heap.
+ *
+ * @param state State whose merge heap to fix
+ * @param logs Open logs
+ * @param slot Slot that may be later than its children
+ */
+static void replay_merge_sift(struct ReplayState* state, const struct ReplayLog* logs, uint32_t slot) {
+    uint32_t* heap = state->merge;
+    uint32_t log = heap[slot];
+    while (1) {
+        uint32_t child = 2 * slot + 1;
+        if (child >= state->merge_count) {
+            break;
+        }
+        if (child + 1 < state->merge_count && logs[heap[child + 1]].next.sequence < logs[heap[child]].next.sequence) {
+            child++;
+        }
+        if (logs[heap[child]].next.sequence >= logs[log].next.sequence) {
+            break;
+        }
+        heap[slot] = heap[child];
+        slot = child;
+    }
+    heap[slot] = log;
+}
+
+/**
+ * @brief Moves every log to where a state left it, loads its next record and rebuilds the merge
+ *
+ * @param state State to continue from (its positions say where each log is)
+ * @param logs Open logs
+ * @param count Number of logs
+ * @return 0 on success, -1 if a log could not be positioned
+ */
+static int replay_seek_logs(struct ReplayState* state, struct ReplayLog* logs, uint32_t count) {
+    state->merge_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        long offset = (long)(sizeof(struct LogFileHeader) + state->positions[i] * sizeof(struct LogEvent));
+        if (fseek(logs[i].file, offset, SEEK_SET) != 0) {
+            return -1;
+        }
+        logs[i].position = state->positions[i];
+        replay_log_fill(&logs[i]);
+        if (logs[i].has_next) {
+            state->merge[state->merge_count++] = i;
+        }
+    }
+    for (uint32_t slot = state->merge_count / 2; slot-- > 0;) {
+        replay_merge_sift(state, logs, slot);
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the log whose next record comes first
+ *
+ * @param state State the logs are positioned at
+ * @return Index of the log, -1 once every log is used up
+ */
+static int replay_next_log(const struct ReplayState* state) {
+    return state->merge_count > 0 ? (int)state->merge[0] : -1;
+}
+
+static int replay_state_init(struct ReplayState* state, uint32_t file_count, uint32_t room_count) {
+    state->positions = calloc(file_count ? file_count : 1, sizeof(uint64_t));
+    state->entities = calloc(file_count ? file_count : 1, sizeof(struct ReplayEntity));
+    state->evidence = calloc(room_count ? room_count : 1, sizeof(EvidenceByte));
+    state->merge = calloc(file_count ? file_count : 1, sizeof(uint32_t));
+    state->merge_count = 0;
+    if (!state->positions || !state->entities || !state->evidence || !state->merge) {
+        return -1;
+    }
+
+    memset(&state->frame, 0, sizeof(state->frame));
+    state->frame.timestamp = INT64_MIN;
+    for (uint32_t i = 0; i < file_count; i++) {
+        state->entities[i].room = LOG_NO_ROOM;
+        state->entities[i].exit_reason = REPLAY_NOT_EXITED;
+    }
+    return 0;
+}
+
+static void replay_state_free(struct ReplayState* state) {
+    free(state->positions);
+    free(state->entities);
+    free(state->evidence);
+    free(state->merge);
+}
+
+/**
+ * @brief Applies one event to the state, the way the simulation changed the House
+ *
+ * @param state State to update
+ * @param file Index of the log (entity) the event came from
+ * @param event The event
+ * @param room_count Number of rooms, events naming other rooms are ignored
+ */
+static void replay_apply(struct ReplayState* state, uint32_t file, const struct LogEvent* event, uint32_t room_count) {
+    struct ReplayEntity* entity = &state->entities[file];
+    bool in_house = event->room < room_count;
+    bool hunter = event->entity_type == LOG_ENTITY_HUNTER;
+
+    entity->boredom = event->boredom;
+    entity->fear = event->fear;
+    if (hunter) {
+        entity->device = event->device;
+    }
+    // every event with a room says where its entity is, which also keeps filtered logs close
+    if (in_house) {
+        entity->room = event->room;
+    }
+
+    switch ((enum LogAction)event->action) {
+        case LOG_ACTION_INIT:
+            if (!hunter) {
+                entity->device = (uint8_t)event->extra;
+            }
+            break;
+        case LOG_ACTION_MOVE:
+            entity->room = event->extra < room_count ? event->extra : LOG_NO_ROOM;
+            break;
+        case LOG_ACTION_EVIDENCE:
+            if (!in_house) {
+                break;
+            }
+            if (hunter) {
+                state->evidence[event->room] &= (EvidenceByte)~event->device;
+                state->frame.collected |= event->device;
+            } else {
+                state->evidence[event->room] |= (EvidenceByte)event->extra;
+            }
+            break;
+        case LOG_ACTION_EXIT:
+            entity->room = LOG_NO_ROOM;
+            entity->returning = 0;
+            entity->exit_reason = hunter ? (uint8_t)event->extra : LR_BORED;
+            break;
+        case LOG_ACTION_RETURN_START:
+            entity->returning = 1;
+            break;
+        case LOG_ACTION_RETURN_COMPLETE:
+            entity->returning = 0;
+            break;
+        default:
+            // SWAP and IDLE only change the fields copied above
+            break;
+    }
+
+    state->positions[file]++;
+    state->frame.event++;
+    state->frame.sequence = event->sequence;
+    if (event->timestamp > state->frame.timestamp) {
+        state->frame.timestamp = event->timestamp;
+    }
+}
+
+/**
+ * @brief Applies the next event in sequence order
+ *
+ * @param state State to update
+ * @param logs Open logs, positioned at state
+ * @param room_count Number of rooms
+ * @return Index of the log the event came from, -1 at the end of the hunt
+ */
+static int replay_step(struct ReplayState* state, struct ReplayLog* logs, uint32_t room_count) {
+    int next = replay_next_log(state);
+    if (next >= 0) {
+        replay_apply(state, (uint32_t)next, &logs[next].next, room_count);
+        replay_log_fill(&logs[next]);
+        if (!logs[next].has_next) {
+            state->merge[0] = state->merge[--state->merge_count];
+        }
+        replay_merge_sift(state, logs, 0);
+    }
+    return next;
+}
+
+static size_t replay_keyframe_size(uint32_t file_count, uint32_t room_count) {
+    return sizeof(struct ReplayKeyframe) + file_count * (sizeof(uint64_t) + sizeof(struct ReplayEntity)) + room_count;
+}
+
+static bool replay_keyframe_write(FILE* out, const struct ReplayState* state, uint32_t file_count, uint32_t room_count) {
+    return fwrite(&state->frame, sizeof(state->frame), 1, out) == 1
+        && fwrite(state->positions, sizeof(uint64_t), file_count, out) == file_count
+        && fwrite(state->entities, sizeof(struct ReplayEntity), file_count, out) == file_count
+        && fwrite(state->evidence, 1, room_count, out) == room_count;
+}
+
+/**
+ * @brief Loads keyframe k of an open index into a state
+ *
+ * @param index The index file
+ * @param k Keyframe number
+ * @param state State to fill (sized for the index)
+ * @param file_count Number of logs
+ * @param room_count Number of rooms
+ * @return 0 on success, -1 on a short read
+ */
+static int replay_keyframe_read(FILE* index, uint64_t k, struct ReplayState* state, uint32_t file_count, uint32_t room_count) {
+    long offset = (long)(sizeof(struct ReplayIndexHeader) + file_count * sizeof(struct ReplayIndexFile)
+                         + k * replay_keyframe_size(file_count, room_count));
+    if (fseek(index, offset, SEEK_SET) != 0
+        || fread(&state->frame, sizeof(state->frame), 1, index) != 1
+        || fread(state->positions, sizeof(uint64_t), file_count, index) != file_count
+        || fread(state->entities, sizeof(struct ReplayEntity), file_count, index) != file_count
+        || fread(state->evidence, 1, room_count, index) != room_count) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Replays the whole hunt once and writes log_index.idx
+ *
+ * Written under a temporary name and renamed, so a reader never sees half an index.
+ *
+ * @param path Index path
+ * @param logs Open logs
+ * @param count Number of logs
+ * @param room_count Number of rooms
+ * @param interval Events between keyframes
+ * @return 0 on success, -1 on error
+ */
+static int replay_build_index(const char* path, struct ReplayLog* logs, uint32_t count, uint32_t room_count, uint32_t interval) {
+    char temporary[1100];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE* out = fopen(temporary, "wb");
+    if (!out) {
+        fprintf(stderr, "Could not create %s\n", temporary);
+        return -1;
+    }
+
+    struct ReplayIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = REPLAY_INDEX_VERSION;
+    header.log_version = LOG_BINARY_VERSION;
+    header.interval = interval;
+    header.file_count = count;
+    header.room_count = room_count;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        struct ReplayIndexFile file = {logs[i].header.entity_id, logs[i].header.entity_type, logs[i].record_count};
+        ok = fwrite(&file, sizeof(file), 1, out) == 1;
+    }
+
+    struct ReplayState state;
+    ok = ok && replay_state_init(&state, count, room_count) == 0 && replay_seek_logs(&state, logs, count) == 0;
+    // keyframe k holds the state after k * interval events; keyframe 0 is the empty house
+    while (ok) {
+        if (state.frame.event % interval == 0) {
+            ok = replay_keyframe_write(out, &state, count, room_count);
+            header.keyframe_count++;
+        }
+        if (replay_step(&state, logs, room_count) < 0) {
+            break;
+        }
+    }
+    header.event_count = state.frame.event;
+    replay_state_free(&state);
+
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(temporary, path) != 0) {
+        fprintf(stderr, "Could not write %s\n", path);
+        remove(temporary);
+        return -1;
+    }
+    printf("Indexed %llu events, %llu keyframes every %u events\n",
+           (unsigned long long)header.event_count, (unsigned long long)header.keyframe_count, interval);
+    return 0;
+}
+
+/**
+ * @brief Opens log_index.idx if it was built from exactly these logs
+ *
+ * @param path Index path
+ * @param logs Open logs
+ * @param count Number of logs
+ * @param room_count Number of rooms
+ * @param interval Required keyframe interval, 0 for any
+ * @param header Receives the index header
+ * @return The open index, NULL if it is missing or stale
+ */
+static FILE* replay_open_index(const char* path, const struct ReplayLog* logs, uint32_t count, uint32_t room_count,
+                               uint32_t interval, struct ReplayIndexHeader* header) {
+    FILE* index = fopen(path, "rb");
+    if (!index) {
+        return NULL;
+    }
+    bool valid = fread(header, sizeof(*header), 1, index) == 1
+        && memcmp(header->magic, REPLAY_INDEX_MAGIC, sizeof(header->magic)) == 0
+        && header->version == REPLAY_INDEX_VERSION
+        && header->log_version == LOG_BINARY_VERSION
+        && header->file_count == count
+        && header->room_count == room_count
+        && header->interval > 0
+        && (interval == 0 || header->interval == interval);
+    for (uint32_t i = 0; valid && i < count; i++) {
+        struct ReplayIndexFile file;
+        valid = fread(&file, sizeof(file), 1, index) == 1
+            && file.entity_id == logs[i].header.entity_id
+            && file.entity_type == logs[i].header.entity_type
+            && file.record_count == logs[i].record_count;
+    }
+    if (!valid) {
+        fclose(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Prints the state: case file, ghost, hunters and the rooms with anything in them
+ *
+ * @param state State to print
+ * @param logs Open logs (for the entity ids and names)
+ * @param count Number of logs
+ * @param rooms Room names
+ * @param total Events in the hunt
+ * @param first_timestamp Timestamp of the hunt's first event
+ */
+static void replay_print_state(const struct ReplayState* state, const struct ReplayLog* logs, uint32_t count,
+                               const struct LogRoomTable* rooms, uint64_t total, int64_t first_timestamp) {
+    printf("After %llu of %llu events", (unsigned long long)state->frame.event, (unsigned long long)total);
+    if (state->frame.event > 0) {
+        printf(" (last seq %llu, time %lld = +%lld ms)", (unsigned long long)state->frame.sequence,
+               (long long)state->frame.timestamp, (long long)(state->frame.timestamp - first_timestamp));
+    }
+    printf("\n");
+
+    EvidenceByte collected = (EvidenceByte)state->frame.collected;
+    const struct EvidenceInfo* info = &evidence_table[collected & (EVIDENCE_MASK_COUNT - 1)];
+    printf("Case file: %d/3", info->count);
+    for (int bit = 0; bit < 8; bit++) {
+        if (collected & (1 << bit)) {
+            printf(" %s", evidence_to_string((enum EvidenceType)(1 << bit)));
+        }
+    }
+    printf(info->count >= 3 && info->is_ghost ? " (solved: %s)\n" : "\n", ghost_to_string((enum GhostType)collected));
+
+    for (uint32_t i = 0; i < count; i++) {
+        const struct ReplayEntity* entity = &state->entities[i];
+        const char* room = log_room_table_name(rooms, entity->room);
+        if (logs[i].header.entity_type == LOG_ENTITY_GHOST) {
+            printf("Ghost %d (%s): %s, boredom %d\n", logs[i].header.entity_id,
+                   ghost_to_string((enum GhostType)entity->device),
+                   room ? room : (entity->exit_reason != REPLAY_NOT_EXITED ? "left" : "not yet in the house"),
+                   entity->boredom);
+            continue;
+        }
+        printf("Hunter %d %-12s %-12s boredom %3d fear %3d  ", logs[i].header.entity_id, logs[i].header.name,
+               evidence_to_string((enum EvidenceType)entity->device), entity->boredom, entity->fear);
+        if (room) {
+            printf("%s%s\n", room, entity->returning ? " (returning to the van)" : "");
+        } else if (entity->exit_reason != REPLAY_NOT_EXITED) {
+            printf("left (%s)\n", exit_reason_to_string((enum LogReason)entity->exit_reason));
+        } else {
+            printf("not yet in the house\n");
+        }
+    }
+
+    // who is in each room, in one pass over the entities
+    int* hunters = calloc(rooms->count ? rooms->count : 1, sizeof(int));
+    uint32_t ghost_room = LOG_NO_ROOM;
+    for (uint32_t i = 0; hunters && i < count; i++) {
+        uint32_t room = state->entities[i].room;
+        if (room >= rooms->count) {
+            continue;
+        }
+        if (logs[i].header.entity_type == LOG_ENTITY_GHOST) {
+            ghost_room = room;
+        } else {
+            hunters[room]++;
+        }
+    }
+    for (uint32_t r = 0; hunters && r < rooms->count; r++) {
+        if (hunters[r] == 0 && ghost_room != r && state->evidence[r] == 0) {
+            continue;
+        }
+        printf("  %-20s hunters %d%s", rooms->names[r], hunters[r], ghost_room == r ? ", ghost" : "");
+        for (int bit = 0; bit < 8; bit++) {
+            if (state->evidence[r] & (1 << bit)) {
+                printf(" [%s]", evidence_to_string((enum EvidenceType)(1 << bit)));
+            }
+        }
+        printf("\n");
+    }
+    free(hunters);
+}
+
+// Where to stop the replay, from the command line
+struct ReplayTarget {
+    uint64_t event;         // Events to apply, UINT64_MAX for all of them
+    bool by_time;           // Stop at time instead
+    bool relative;          // time counts from the first event
+    long long time;
+    uint64_t follow;        // Events to print after the state
+};
+
+/**
+ * @brief Finds the last keyframe whose events all happened by a time
+ *
+ * Keyframe timestamps never go down, so this is a binary search over the index.
+ *
+ * @param index The index file
+ * @param header Its header
+ * @param limit Latest timestamp
+ * @param count Number of logs
+ * @param room_count Number of rooms
+ * @return Keyframe number, 0 if none is that early
+ */
+static uint64_t replay_find_time(FILE* index, const struct ReplayIndexHeader* header, int64_t limit, uint32_t count, uint32_t room_count) {
+    struct ReplayState probe;
+    uint64_t low = 0;
+    uint64_t high = header->keyframe_count - 1;
+    if (replay_state_init(&probe, count, room_count) == 0) {
+        while (low < high) {
+            uint64_t middle = low + (high - low + 1) / 2;
+            if (replay_keyframe_read(index, middle, &probe, count, room_count) != 0) {
+                break;
+            }
+            if (probe.frame.timestamp <= limit) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+    }
+    replay_state_free(&probe);
+    return low;
+}
+
+/**
+ * @brief Loads the keyframe before the target, replays up to it and prints the state
+ *
+ * @param index The index file
+ * @param header Its header
+ * @param logs Open logs
+ * @param count Number of logs
+ * @param rooms Room names
+ * @param target Where to stop
+ * @return 0 on success, 1 on error
+ */
+static int replay_seek(FILE* index, const struct ReplayIndexHeader* header, struct ReplayLog* logs, uint32_t count,
+                       const struct LogRoomTable* rooms, const struct ReplayTarget* target) {
+    struct ReplayState state;
+    if (replay_state_init(&state, count, rooms->count) != 0 || header->keyframe_count == 0 ||
+        replay_keyframe_read(index, 0, &state, count, rooms->count) != 0 ||
+        replay_seek_logs(&state, logs, count) != 0) {
+        fprintf(stderr, "Could not read the index\n");
+        replay_state_free(&state);
+        return 1;
+    }
+
+    // the first event's timestamp, for relative times and the printout
+    int next = replay_next_log(&state);
+    int64_t first_timestamp = next >= 0 ? logs[next].next.timestamp : 0;
+
+    int64_t limit = target->relative ? first_timestamp + target->time : target->time;
+    uint64_t event = target->event < header->event_count ? target->event : header->event_count;
+    uint64_t keyframe = target->by_time ? replay_find_time(index, header, limit, count, rooms->count) : event / header->interval;
+    if (replay_keyframe_read(index, keyframe, &state, count, rooms->count) != 0 ||
+        replay_seek_logs(&state, logs, count) != 0) {
+        fprintf(stderr, "Could not seek to keyframe %llu\n", (unsigned long long)keyframe);
+        replay_state_free(&state);
+        return 1;
+    }
+
+    uint64_t replayed = 0;
+    while ((next = replay_next_log(&state)) >= 0) {
+        if (target->by_time ? logs[next].next.timestamp > limit : state.frame.event >= event) {
+            break;
+        }
+        replay_step(&state, logs, rooms->count);
+        replayed++;
+    }
+
+    printf("Keyframe %llu, %llu events replayed\n", (unsigned long long)keyframe, (unsigned long long)replayed);
+    replay_print_state(&state, logs, count, rooms, header->event_count, first_timestamp);
+
+    for (uint64_t i = 0; i < target->follow && (next = replay_next_log(&state)) >= 0; i++) {
+        const struct LogEvent* upcoming = &logs[next].next;
+        const char* extra_room = upcoming->action == LOG_ACTION_MOVE ? log_room_table_name(rooms, upcoming->extra) : NULL;
+        printf("%llu: ", (unsigned long long)state.frame.event);
+        log_event_write_csv(stdout, upcoming, log_room_table_name(rooms, upcoming->room), extra_room, logs[next].header.name, true);
+        replay_step(&state, logs, rooms->count);
+    }
+
+    replay_state_free(&state);
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative integer command line value
+ *
+ * @param text The argument text
+ * @param out Pointer to store the value in
+ * @return true if the whole text was a number
+ */
+static bool parse_count(const char* text, unsigned long long* out) {
+    char* end;
+    *out = strtoull(text, &end, 10);
+    return *text != '\0' && *text != '-' && *end == '\0';
+}
+
+int main(int argc, char* argv[]) {
+    const char* directory = ".";
+    struct ReplayTarget target = {UINT64_MAX, false, false, 0, 0};
+    unsigned long long value;
+    uint32_t interval = 0;
+    bool reindex = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--event") == 0 && has_value) {
+            if (!parse_count(argv[++i], &value)) {
+                fprintf(stderr, "Invalid --event value: %s\n", argv[i]);
+                return 1;
+            }
+            target.event = value;
+        } else if (strcmp(argv[i], "--time") == 0 && has_value) {
+            char* end;
+            const char* text = argv[++i];
+            target.by_time = true;
+            target.relative = text[0] == '+';
+            target.time = strtoll(target.relative ? text + 1 : text, &end, 10);
+            if (text[target.relative] == '\0' || *end != '\0') {
+                fprintf(stderr, "Invalid --time value: %s\n", text);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--events") == 0 && has_value) {
+            if (!parse_count(argv[++i], &value)) {
+                fprintf(stderr, "Invalid --events value: %s\n", argv[i]);
+                return 1;
+            }
+            target.follow = value;
+        } else if (strcmp(argv[i], "--interval") == 0 && has_value) {
+            if (!parse_count(argv[++i], &value) || value == 0 || value > UINT32_MAX) {
+                fprintf(stderr, "Invalid --interval value: %s\n", argv[i]);
+                return 1;
+            }
+            interval = (uint32_t)value;
+        } else if (strcmp(argv[i], "--reindex") == 0) {
+            reindex = true;
+        } else if (argv[i][0] != '-' && i == argc - 1) {
+            directory = argv[i];
+        } else {
+            printf("Usage: %s [--event N | --time [+]T] [--events C] [--interval K] [--reindex] [directory]\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (target.by_time && target.event != UINT64_MAX) {
+        fprintf(stderr, "Use either --event or --time, not both\n");
+        return 1;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", directory, LOG_ROOMS_FILE);
+    struct LogRoomTable rooms;
+    if (log_room_table_load(path, &rooms) != 0) {
+        fprintf(stderr, "Could not read %s\n", path);
+        log_room_table_free(&rooms);
+        return 1;
+    }
+    uint32_t count;
+    struct ReplayLog* logs = replay_open_logs(directory, &count);
+    if (!logs) {
+        log_room_table_free(&rooms);
+        return 1;
+    }
+
+    // reuse the index unless it is stale or was built with another interval than asked for
+    snprintf(path, sizeof(path), "%s/%s", directory, REPLAY_INDEX_FILE);
+    struct ReplayIndexHeader header;
+    FILE* index = reindex ? NULL : replay_open_index(path, logs, count, rooms.count, interval, &header);
+    if (!index && replay_build_index(path, logs, count, rooms.count, interval ? interval : REPLAY_DEFAULT_INTERVAL) == 0) {
+        index = replay_open_index(path, logs, count, rooms.count, 0, &header);
+    }
+
+    int status = 1;
+    if (index) {
+        status = replay_seek(index, &header, logs, count, &rooms, &target);
+        fclose(index);
+    }
+    replay_close_logs(logs, count);
+    log_room_table_free(&rooms);
+    return status;
+}
@@ -4,110 +4,224 @@
 #include <unistd.h>
 #include "defs.h"
 #include "helpers.h"
-#include <time.h>
+#include "batch.h"
+#include "map.h"
+#include "mapgen.h"
+#include "metrics.h"
+#include "check.h"
+#include "snapshot.h"
 
 /**
- * @brief The main function for the Plasmophobia copycat game
+ * @brief Prints the command line usage
  *
- * @return 0 if everything works
+ * @param program Name the program was started with
+ */
+static void print_usage(const char* program) {
+    printf("Usage: %s [log options]                                   (interactive, one hunt)\n", program);
+    printf("       %s --runs N [--jobs J] [--hunters H] [log options] (headless batch)\n", program);
+    printf("  --runs N            number of hunts to simulate\n");
+    printf("  --jobs J            hunts simulated at once, or pool workers with --engine pool (default: number of cores)\n");
+    printf("  --hunters H         hunters per hunt (default: %d)\n", BATCH_DEFAULT_HUNTERS);
+    printf("  --map FILE          load the house layout from a map file (default: built-in Willow, see maps/)\n");
+    printf("  --generate SPEC     generate the layout instead, e.g. rooms=500,depth=12,degree=preferential,\n");
+    printf("                      max-degree=8,loops=0.2,seed=3 (seed defaults to --seed, see mapgen.h)\n");
+    printf("  --save-map FILE     write the layout used (--map or --generate) as a map file\n");
+    printf("  --engine E          threads (real time, default), des (virtual time, single thread per hunt)\n");
+    printf("                      or pool (--jobs workers step every hunter and ghost, no sleeping)\n");
+    printf("  --seed S            master seed (default: fresh); with --engine des the same seed replays the same hunts\n");
+    printf("  --first-run R       index of the first batch run, to split one seeded sweep across processes\n");
+    printf("  --snapshot-at SPEC  run hunt --first-run on the des engine until e.g. fear=4,hunters=2 or time=150\n");
+    printf("                      (keys: time, fear, hunters, evidence) and save it with --snapshot FILE\n");
+    printf("  --fork FILE         run --runs branches of a saved snapshot, each with its own streams from --seed\n");
+    printf("  --log-format FMT    csv, binary or both (default: csv; batch default: no logs)\n");
+    printf("  --log-dir DIR       write logs under DIR (batch: DIR/run_<n>/)\n");
+    printf("  --log-order         end every CSV log line with the event's seq and mono_ns (see eventlog.h)\n");
+    printf("  --log-filter SPEC   log only some events, e.g. ghost:IDLE=0,hunter:MOVE=10 (see helpers.h;\n");
+    printf("                      default: $GHOST_LOG_FILTER)\n");
+    printf("  --log-queue N       events the log queue holds before backpressure (default: 65536)\n");
+    printf("  --log-drop          drop events when the log queue is full instead of waiting\n");
+    printf("  --check             check the hunt invariants on every step (see check.h); exit status 2 on a violation\n");
+    printf("  --metrics FILE      batch: keep FILE up to date with Prometheus text metrics (see metrics.h)\n");
+    printf("  --metrics-interval S  seconds between metrics rewrites (default: %.0f)\n", METRICS_DEFAULT_INTERVAL);
+}
+
+/**
+ * @brief Flushes the logs and reports the log queue counters if anything was logged
+ */
+static void finish_logging() {
+    log_flush_all();
+
+    struct LogQueueStats queue;
+    log_get_queue_stats(&queue);
+    if (queue.pushed > 0) {
+        fprintf(stderr, "Log queue: %zu events written, high water %zu/%zu, %zu dropped\n",
+                queue.written, queue.high_water, queue.capacity, queue.dropped);
+    }
+    log_filter_report(stderr);
+}
+
+/**
+ * @brief Parses a positive integer command line value
+ *
+ * @param text The argument text
+ * @param out Pointer to store the value in
+ * @return true if text was a positive integer
+ */
+static bool parse_positive(const char* text, int* out) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value <= 0 || value > 1000000000L) {
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+/**
+ * @brief Runs one hunt of the batch up to a trigger and saves the snapshot
+ *
+ * @param config Batch settings (the hunt is run config->first_run)
+ * @param trigger When to take the snapshot
+ * @param path File to write
+ * @return 0 on success, 1 if the hunt ended first or the file could not be written
+ */
+static int run_snapshot(const struct BatchConfig* config, const struct SnapshotTrigger* trigger, const char* path) {
+    struct HuntSnapshot snapshot;
+    int status = batch_take_snapshot(config, trigger, &snapshot);
+    if (status == 0) {
+        fprintf(stderr, "Run %d (seed %llu) ended before the trigger; no snapshot taken\n",
+                config->first_run, (unsigned long long)config->seed);
+        return 1;
+    }
+    if (status < 0) {
+        fprintf(stderr, "Could not take the snapshot\n");
+        return 1;
+    }
+    status = snapshot_write(path, &snapshot);
+    snapshot_free(&snapshot);
+    if (status != 0) {
+        fprintf(stderr, "Could not write %s\n", path);
+        return 1;
+    }
+    printf("Snapshot written to %s\n", path);
+    return 0;
+}
+
+/**
+ * @brief Plays a snapshot out with its own streams, then runs the batch of branches
+ *
+ * @param config Batch settings (config->snapshot is set here)
+ * @param path Snapshot file
+ * @return 0 on success, 1 on error
  */
-int main() {
-    
-    // randomness
-    srand(time(NULL)); 
+static int run_fork(struct BatchConfig* config, const char* path) {
+    char error[256];
+    struct HuntSnapshot snapshot;
+    if (snapshot_read(path, &snapshot, error, sizeof(error)) != 0) {
+        fprintf(stderr, "Invalid snapshot: %s\n", error);
+        snapshot_free(&snapshot);
+        return 1;
+    }
 
+    // how the original hunt went on from here, which also checks the layout
     struct House house;
-    house.hunter_count = 0;
-    house.room_count = 0;
-    house_populate_rooms(&house); 
-    house.case_file.collected = 0;
-    house.case_file.solved = false;
-    
-    // casefile semaphore
-    sem_init(&house.case_file.mutex, 0, 1);
-
-	// init ghost
-    int ghost_start_idx = rand_int_threadsafe(1, house.room_count); 
-    if (ghost_start_idx == 0) {
-    	ghost_start_idx = 1; 
-    }
-    const enum GhostType* ghost_types;
-    int num_ghosts = get_all_ghost_types(&ghost_types);
-    enum GhostType g_type = ghost_types[rand_int_threadsafe(0, num_ghosts)];
-    house.ghost = ghost_create(DEFAULT_GHOST_ID, g_type, &house.rooms[ghost_start_idx]);
+    if (snapshot_restore(&snapshot, config->map, snapshot.seed, snapshot.run_id, false, &house, error, sizeof(error)) != 0) {
+        fprintf(stderr, "Invalid snapshot: %s\n", error);
+        snapshot_free(&snapshot);
+        return 1;
+    }
+    snapshot_print(stdout, &snapshot, &house);
+    if (house_resume_des(&house, &snapshot) != 0) {
+        fprintf(stderr, "Out of memory resuming the snapshot\n");
+        house_cleanup(&house);
+        snapshot_free(&snapshot);
+        return 1;
+    }
+    struct HuntResult original;
+    house_get_result(&house, &original);
+    house_cleanup(&house);
+
+    config->snapshot = &snapshot;
+    config->hunter_count = snapshot.hunter_count;
+    struct BatchStats stats;
+    if (batch_run(config, &stats) != 0) {
+        fprintf(stderr, "The branches could not be run.\n");
+        snapshot_free(&snapshot);
+        return 1;
+    }
+    batch_print_report(config, &stats);
+    printf("Original continuation: %s, exits evidence=%d bored=%d afraid=%d, length %d\n",
+           original.won ? "won" : "failed", original.exits[LR_EVIDENCE], original.exits[LR_BORED],
+           original.exits[LR_AFRAID], original.length);
+    batch_stats_free(&stats);
+    snapshot_free(&snapshot);
+    return 0;
+}
+
+/**
+ * @brief Runs one hunt with hunters typed in on stdin and prints the results
+ *
+ * @param engine Engine that drives the hunt
+ * @param workers Worker threads for the pool engine
+ * @param seed Master seed of the hunt
+ * @param map House layout, NULL for the built-in one
+ * @return 0 if everything works
+ */
+static int run_interactive(enum SimEngine engine, int workers, uint64_t seed, const struct HouseMap* map) {
+    struct House house;
+    house_init(&house, map, -1, seed);
 
 	// init hunters
     char name_buffer[MAX_HUNTER_NAME];
     printf("Please enter hunter names ('done' to cancel):\n");
-    while (house.hunter_count < MAX_HUNTERS) {
+    while (1) {
         printf("Name: ");
-        scanf("%63s", name_buffer);
-        if (strcmp(name_buffer, "done") == 0) {
+        if (scanf("%63s", name_buffer) != 1 || strcmp(name_buffer, "done") == 0) {
         	break;
         }
-        
+
         int h_id;
         printf("ID: ");
-        scanf("%d", &h_id);
+        if (scanf("%d", &h_id) != 1) {
+            break;
+        }
 
-        struct Hunter* h = hunter_create(name_buffer, h_id, house.starting_room, &house.case_file);
-        
-        house.hunters[house.hunter_count++] = h;
-        room_add_hunter(house.starting_room, h);
+        house_add_hunter(&house, name_buffer, h_id);
     }
-    
-    // start ghost thread
-    pthread_t ghost_identifier;
-    pthread_create(&ghost_identifier, NULL, ghost_thread, house.ghost);
 
-	// start hunter threads
-    pthread_t hunter_identifiers[MAX_HUNTERS];
-    for (int i = 0; i < house.hunter_count; i++) {
-        pthread_create(&hunter_identifiers[i], NULL, hunter_thread, house.hunters[i]);
-    }
-    
-    // stop hunter threads
-    for (int i = 0; i < house.hunter_count; i++) {
-        pthread_join(hunter_identifiers[i], NULL);
+    if (engine == ENGINE_DES) {
+        house_run_des(&house);
+    } else if (engine == ENGINE_POOL) {
+        house_run_pool(&house, workers);
+    } else {
+        house_run(&house);
     }
-    sem_wait(&house.ghost->mutex);
-    house.ghost->running = false; 
-    sem_post(&house.ghost->mutex);
-    
-    // stop ghost thread
-    pthread_join(ghost_identifier, NULL);
 
 	// results
     printf("\n--- Simulation Results ---\n");
+    printf("Seed: %llu\n", (unsigned long long)seed);
     printf("Type of Ghost: %s\n", ghost_to_string(house.ghost->type));
-    
+
+    EvidenceByte collected = atomic_load(&house.case_file.collected);
     printf("Evidence Collected: ");
     const enum EvidenceType* ev_list;
     int ev_count = get_all_evidence_types(&ev_list);
     for (int i = 0; i < ev_count; i++) {
-        if (house.case_file.collected & ev_list[i]) {
+        if (collected & ev_list[i]) {
             printf("%s ", evidence_to_string(ev_list[i]));
         }
     }
     printf("\n");
-    
+
+    // if the collected evidence matches a ghost type, the mask is that type
     const char* ghost_guess = "N/A";
-    
-    // iterate through all ghosts for evidence match
-    const enum GhostType* all_ghosts;
-    int count = get_all_ghost_types(&all_ghosts);
-    
-    for (int i = 0; i < count; i++) {
-        // if the collected evidence matches a ghost type
-        if (house.case_file.collected == all_ghosts[i]) {
-            ghost_guess = ghost_to_string(all_ghosts[i]);
-            break;
-        }
+    if (evidence_table[collected].is_ghost) {
+        ghost_guess = ghost_to_string((enum GhostType)collected);
     }
 
     printf("Ghost Guess: %s\n", ghost_guess);
-    
-    bool result = house.case_file.solved;
+
+    bool result = atomic_load(&house.case_file.solved);
     if (result) {
     	printf("Result: Hunters WON! :D\n");
     } else {
@@ -117,16 +231,274 @@ int main() {
         struct Hunter* h = house.hunters[i];
         printf("Hunter %s --- Fear %d --- Boredom %d\n", h->name, h->fear, h->boredom);
     }
-    
+
     // free memory
-    ghost_destroy(house.ghost);
-    for (int i = 0; i < house.hunter_count; i++) {
-        hunter_destroy(house.hunters[i]);
-    }
-    sem_destroy(&house.case_file.mutex);
-    for (int i = 0; i < house.room_count; i++) {
-        sem_destroy(&house.rooms[i].mutex);
+    house_cleanup(&house);
+    finish_logging();
+    lock_stats_report(stderr);
+    if (check_report(stderr) > 0) {
+        return 2;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief The main function for the Plasmophobia copycat game
+ *
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments (no arguments runs a single interactive hunt)
+ * @return 0 if everything works
+ */
+int main(int argc, char* argv[]) {
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    struct BatchConfig config;
+    config.runs = 0;
+    config.jobs = cores > 0 ? (int)cores : 1;
+    config.hunter_count = BATCH_DEFAULT_HUNTERS;
+    config.engine = ENGINE_THREADS;
+    config.map = NULL;
+    config.first_run = 0;
+    config.seed = rand_fresh_seed();
+    config.metrics_path = NULL;
+    config.metrics_interval = METRICS_DEFAULT_INTERVAL;
+    config.snapshot = NULL;
+    bool engine_given = false;
+
+    int log_format = LOG_OUTPUT_NONE;   // files requested with --log-format, none = mode default
+    const char* log_dir = NULL;
+    const char* log_filter = getenv("GHOST_LOG_FILTER");    // --log-filter wins over the environment
+    const char* map_path = NULL;
+    const char* generate_spec = NULL;
+    const char* save_map_path = NULL;
+    const char* snapshot_spec = NULL;
+    const char* snapshot_path = NULL;
+    const char* fork_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--runs") == 0 && has_value) {
+            if (!parse_positive(argv[++i], &config.runs)) {
+                fprintf(stderr, "Invalid --runs value: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0 && has_value) {
+            if (!parse_positive(argv[++i], &config.jobs)) {
+                fprintf(stderr, "Invalid --jobs value: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hunters") == 0 && has_value) {
+            if (!parse_positive(argv[++i], &config.hunter_count)) {
+                fprintf(stderr, "Invalid --hunters value: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--map") == 0 && has_value) {
+            map_path = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && has_value) {
+            generate_spec = argv[++i];
+        } else if (strcmp(argv[i], "--save-map") == 0 && has_value) {
+            save_map_path = argv[++i];
+        } else if (strcmp(argv[i], "--engine") == 0 && has_value) {
+            const char* engine = argv[++i];
+            engine_given = true;
+            if (strcmp(engine, "threads") == 0) {
+                config.engine = ENGINE_THREADS;
+            } else if (strcmp(engine, "des") == 0) {
+                config.engine = ENGINE_DES;
+            } else if (strcmp(engine, "pool") == 0) {
+                config.engine = ENGINE_POOL;
+            } else {
+                fprintf(stderr, "Invalid --engine value: %s (threads, des or pool)\n", engine);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            char* end;
+            const char* text = argv[++i];
+            config.seed = strtoull(text, &end, 10);
+            if (*text == '\0' || *end != '\0') {
+                fprintf(stderr, "Invalid --seed value: %s\n", text);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--first-run") == 0 && has_value) {
+            char* end;
+            const char* text = argv[++i];
+            long first = strtol(text, &end, 10);
+            if (*text == '\0' || *end != '\0' || first < 0 || first > 1000000000L) {
+                fprintf(stderr, "Invalid --first-run value: %s\n", text);
+                return 1;
+            }
+            config.first_run = (int)first;
+        } else if (strcmp(argv[i], "--snapshot-at") == 0 && has_value) {
+            snapshot_spec = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && has_value) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--fork") == 0 && has_value) {
+            fork_path = argv[++i];
+        } else if (strcmp(argv[i], "--log-format") == 0 && has_value) {
+            const char* format = argv[++i];
+            if (strcmp(format, "csv") == 0) {
+                log_format = LOG_OUTPUT_CSV;
+            } else if (strcmp(format, "binary") == 0) {
+                log_format = LOG_OUTPUT_BINARY;
+            } else if (strcmp(format, "both") == 0) {
+                log_format = LOG_OUTPUT_CSV | LOG_OUTPUT_BINARY;
+            } else {
+                fprintf(stderr, "Invalid --log-format value: %s (csv, binary or both)\n", format);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--log-dir") == 0 && has_value) {
+            log_dir = argv[++i];
+        } else if (strcmp(argv[i], "--log-order") == 0) {
+            log_set_order_columns(true);
+        } else if (strcmp(argv[i], "--log-filter") == 0 && has_value) {
+            log_filter = argv[++i];
+        } else if (strcmp(argv[i], "--log-queue") == 0 && has_value) {
+            int capacity;
+            if (!parse_positive(argv[++i], &capacity)) {
+                fprintf(stderr, "Invalid --log-queue value: %s\n", argv[i]);
+                return 1;
+            }
+            log_set_queue_capacity((size_t)capacity);
+        } else if (strcmp(argv[i], "--log-drop") == 0) {
+            log_set_backpressure(LOG_BACKPRESSURE_DROP);
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check_set_enabled(true);
+        } else if (strcmp(argv[i], "--metrics") == 0 && has_value) {
+            config.metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && has_value) {
+            char* end;
+            const char* text = argv[++i];
+            config.metrics_interval = strtod(text, &end);
+            if (*text == '\0' || *end != '\0' || !(config.metrics_interval >= 0.1 && config.metrics_interval <= 86400.0)) {
+                fprintf(stderr, "Invalid --metrics-interval value: %s (0.1 to 86400 seconds)\n", text);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (map_path && generate_spec) {
+        fprintf(stderr, "Use either --map or --generate, not both\n");
+        return 1;
+    }
+    if (config.metrics_path && config.runs == 0) {
+        fprintf(stderr, "--metrics needs --runs\n");
+        return 1;
+    }
+    struct SnapshotTrigger trigger;
+    if (snapshot_spec || snapshot_path || fork_path) {
+        char error[256];
+        if ((snapshot_spec != NULL) != (snapshot_path != NULL)) {
+            fprintf(stderr, "--snapshot-at and --snapshot go together\n");
+            return 1;
+        }
+        if (snapshot_spec && fork_path) {
+            fprintf(stderr, "Use either --snapshot-at or --fork, not both\n");
+            return 1;
+        }
+        if (snapshot_spec && snapshot_trigger_parse(snapshot_spec, &trigger, error, sizeof(error)) != 0) {
+            fprintf(stderr, "Invalid --snapshot-at: %s\n", error);
+            return 1;
+        }
+        if (snapshot_spec && config.runs != 0) {
+            fprintf(stderr, "--snapshot-at runs a single hunt; pick it with --first-run instead of --runs\n");
+            return 1;
+        }
+        if (fork_path && config.runs == 0) {
+            fprintf(stderr, "--fork needs --runs (the number of branches)\n");
+            return 1;
+        }
+        if (fork_path && log_format) {
+            fprintf(stderr, "--fork branches start mid-hunt and are not logged\n");
+            return 1;
+        }
+        if (engine_given && config.engine != ENGINE_DES) {
+            fprintf(stderr, "Snapshots are taken and forked on the des engine\n");
+            return 1;
+        }
+        config.engine = ENGINE_DES;
+    }
+    if (save_map_path && !map_path && !generate_spec) {
+        fprintf(stderr, "--save-map needs --map or --generate\n");
+        return 1;
+    }
+
+    struct HouseMap map = {NULL, 0, NULL, 0};
+    if (map_path) {
+        char error[256];
+        if (house_map_load(map_path, &map, error, sizeof(error)) != 0) {
+            fprintf(stderr, "Invalid map: %s\n", error);
+            return 1;
+        }
+        config.map = &map;
+    }
+    if (generate_spec) {
+        char error[256];
+        struct MapGenConfig generator;
+        map_gen_defaults(&generator, config.seed);
+        if (map_gen_parse(generate_spec, &generator, error, sizeof(error)) != 0 ||
+            house_map_generate(&generator, &map, error, sizeof(error)) != 0) {
+            fprintf(stderr, "Invalid --generate: %s\n", error);
+            return 1;
+        }
+        printf("Generated house: %d rooms, %d connections (generator seed %llu)\n",
+               map.room_count, map.edge_count, (unsigned long long)generator.seed);
+        config.map = &map;
+    }
+    if (save_map_path && house_map_save(&map, save_map_path) != 0) {
+        fprintf(stderr, "Could not write the map to %s\n", save_map_path);
+        house_map_free(&map);
+        return 1;
+    }
+
+    log_set_directory(log_dir);
+    if (log_filter && *log_filter) {
+        char error[256];
+        if (log_set_filter(log_filter, error, sizeof(error)) != 0) {
+            fprintf(stderr, "Invalid log filter: %s\n", error);
+            house_map_free(&map);
+            return 1;
+        }
+    }
+
+    if (snapshot_spec) {
+        log_set_outputs(log_format);
+        int status = run_snapshot(&config, &trigger, snapshot_path);
+        finish_logging();
+        house_map_free(&map);
+        return status;
+    }
+
+    if (config.runs == 0) {
+        // single hunt: events go to the console plus CSV (or whatever was asked for)
+        log_set_outputs(LOG_OUTPUT_CONSOLE | (log_format ? log_format : LOG_OUTPUT_CSV));
+        int status = run_interactive(config.engine, config.jobs, config.seed, config.map);
+        house_map_free(&map);
+        return status;
+    }
+
+    // batch hunts never echo events, and only write log files when asked to
+    log_set_outputs(log_format);
+
+    if (fork_path) {
+        int status = run_fork(&config, fork_path);
+        lock_stats_report(stderr);
+        house_map_free(&map);
+        return status != 0 ? status : (check_report(stderr) > 0 ? 2 : 0);
+    }
+
+    struct BatchStats stats;
+    if (batch_run(&config, &stats) != 0) {
+        fprintf(stderr, "The batch could not be run.\n");
+        return 1;
+    }
+    batch_print_report(&config, &stats);
+    batch_stats_free(&stats);
+    finish_logging();
+    lock_stats_report(stderr);
+    house_map_free(&map);
+    return check_report(stderr) > 0 ? 2 : 0;
+}
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "map.h"
+
+// Parser state while a file is being read
+struct MapParser {
+    struct HouseMap* map;
+    int room_capacity;
+    int edge_capacity;
+    int* edge_lines;        // Line of every edge, for error messages
+    int* name_slots;        // Open addressing table of room indices (-1 = empty)
+    int slot_count;         // Power of two, kept at least twice room_count
+    const char* path;
+    char* error;
+    size_t error_size;
+};
+
+/**
+ * @brief Formats a parse error as "path:line: reason"
+ *
+ * @param parser Pointer to the MapParser
+ * @param line Line number, or 0 for errors about the whole file
+ * @param format printf-style reason
+ * @return -1, so callers can return it directly
+ */
+static int map_error(struct MapParser* parser, int line, const char* format, ...) {
+    if (parser->error && parser->error_size > 0) {
+        int used = line > 0 ? snprintf(parser->error, parser->error_size, "%s:%d: ", parser->path, line)
+                            : snprintf(parser->error, parser->error_size, "%s: ", parser->path);
+        if (used >= 0 && (size_t)used < parser->error_size) {
+            va_list args;
+            va_start(args, format);
+            vsnprintf(parser->error + used, parser->error_size - used, format, args);
+            va_end(args);
+        }
+    }
+    return -1;
+}
+
+// FNV-1a
+static unsigned map_hash(const char* name) {
+    unsigned hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Looks a room up by name
+ *
+ * @param parser Pointer to the MapParser
+ * @param name Room name
+ * @return Slot in name_slots holding the room, or the empty slot where it would go
+ */
+static int map_find_slot(const struct MapParser* parser, const char* name) {
+    int mask = parser->slot_count - 1;
+    int slot = (int)(map_hash(name) & (unsigned)mask);
+    while (parser->name_slots[slot] >= 0 && strcmp(parser->map->rooms[parser->name_slots[slot]].name, name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int map_find_room(const struct MapParser* parser, const char* name) {
+    if (parser->slot_count == 0) {
+        return -1;
+    }
+    return parser->name_slots[map_find_slot(parser, name)];
+}
+
+/**
+ * @brief Doubles the name table and re-inserts every room
+ *
+ * @param parser Pointer to the MapParser
+ * @return 0 on success, -1 if out of memory
+ */
+static int map_grow_slots(struct MapParser* parser) {
+    int count = parser->slot_count ? parser->slot_count * 2 : 64;
+    int* slots = malloc(sizeof(int) * count);
+    if (!slots) {
+        return -1;
+    }
+    free(parser->name_slots);
+    parser->name_slots = slots;
+    parser->slot_count = count;
+    for (int i = 0; i < count; i++) {
+        slots[i] = -1;
+    }
+    for (int i = 0; i < parser->map->room_count; i++) {
+        slots[map_find_slot(parser, parser->map->rooms[i].name)] = i;
+    }
+    return 0;
+}
+
+static int map_add_room(struct MapParser* parser, int line, const char* name, bool is_exit) {
+    struct HouseMap* map = parser->map;
+    if (*name == '\0') {
+        return map_error(parser, line, "room has no name");
+    }
+    if (strlen(name) >= MAX_ROOM_NAME) {
+        return map_error(parser, line, "room name longer than %d characters", MAX_ROOM_NAME - 1);
+    }
+    if ((map->room_count + 1) * 2 > parser->slot_count && map_grow_slots(parser) != 0) {
+        return map_error(parser, line, "out of memory");
+    }
+    if (map_find_room(parser, name) >= 0) {
+        return map_error(parser, line, "room \"%s\" declared twice", name);
+    }
+
+    if (map->room_count == parser->room_capacity) {
+        int capacity = parser->room_capacity ? parser->room_capacity * 2 : 32;
+        struct MapRoom* rooms = realloc(map->rooms, sizeof(struct MapRoom) * capacity);
+        if (!rooms) {
+            return map_error(parser, line, "out of memory");
+        }
+        map->rooms = rooms;
+        parser->room_capacity = capacity;
+    }
+
+    struct MapRoom* room = &map->rooms[map->room_count];
+    strcpy(room->name, name);
+    room->is_exit = is_exit;
+    parser->name_slots[map_find_slot(parser, name)] = map->room_count;
+    map->room_count++;
+    return 0;
+}
+
+static int map_add_edge(struct MapParser* parser, int line, char* text) {
+    struct HouseMap* map = parser->map;
+    char* separator = strstr(text, " -- ");
+    if (!separator) {
+        return map_error(parser, line, "edge needs the form \"edge <room> -- <room>\"");
+    }
+    *separator = '\0';
+    const char* names[2] = {text, separator + 4};
+
+    int ends[2];
+    for (int i = 0; i < 2; i++) {
+        ends[i] = map_find_room(parser, names[i]);
+        if (ends[i] < 0) {
+            return map_error(parser, line, "edge to undeclared room \"%s\"", names[i]);
+        }
+    }
+    if (ends[0] == ends[1]) {
+        return map_error(parser, line, "room \"%s\" connected to itself", names[0]);
+    }
+
+    if (map->edge_count == parser->edge_capacity) {
+        int capacity = parser->edge_capacity ? parser->edge_capacity * 2 : 32;
+        int (*edges)[2] = realloc(map->edges, sizeof(map->edges[0]) * capacity);
+        if (!edges) {
+            return map_error(parser, line, "out of memory");
+        }
+        map->edges = edges;
+        int* lines = realloc(parser->edge_lines, sizeof(int) * capacity);
+        if (!lines) {
+            return map_error(parser, line, "out of memory");
+        }
+        parser->edge_lines = lines;
+        parser->edge_capacity = capacity;
+    }
+    map->edges[map->edge_count][0] = ends[0];
+    map->edges[map->edge_count][1] = ends[1];
+    parser->edge_lines[map->edge_count] = line;
+    map->edge_count++;
+    return 0;
+}
+
+/**
+ * @brief Lays the edges out in compressed sparse row form
+ *
+ * Every room keeps its neighbours in the order its edges appear in the map, which is
+ * what the old per-room connection arrays did.
+ *
+ * @param map Pointer to the HouseMap
+ * @param offsets Array of room_count + 1 ints to fill
+ * @param neighbours Array of 2 * edge_count ints to fill
+ */
+static void map_fill_adjacency(const struct HouseMap* map, int* offsets, int* neighbours) {
+    for (int r = 0; r <= map->room_count; r++) {
+        offsets[r] = 0;
+    }
+    for (int e = 0; e < map->edge_count; e++) {
+        offsets[map->edges[e][0]]++;
+        offsets[map->edges[e][1]]++;
+    }
+    // offsets[r] becomes the end of room r, then walking the edges backwards moves it to the start
+    for (int r = 1; r < map->room_count; r++) {
+        offsets[r] += offsets[r - 1];
+    }
+    offsets[map->room_count] = 2 * map->edge_count;
+    for (int e = map->edge_count - 1; e >= 0; e--) {
+        int a = map->edges[e][0];
+        int b = map->edges[e][1];
+        neighbours[--offsets[b]] = a;
+        neighbours[--offsets[a]] = b;
+    }
+}
+
+/**
+ * @brief Checks the layout as a whole: start room, no duplicate edges, every room reachable
+ *
+ * @param parser Pointer to the MapParser (every line already read)
+ * @return 0 if the layout is usable, -1 otherwise
+ */
+static int map_check_graph(struct MapParser* parser) {
+    const struct HouseMap* map = parser->map;
+    if (map->room_count < 2) {
+        return map_error(parser, 0, "a house needs at least two rooms");
+    }
+    if (!map->rooms[0].is_exit) {
+        return map_error(parser, 0, "the first room (\"%s\") is where hunters start and must be an exit", map->rooms[0].name);
+    }
+
+    int* offsets = malloc(sizeof(int) * (map->room_count + 1));
+    int* neighbours = malloc(sizeof(int) * (2 * map->edge_count + 1));
+    int* queue = malloc(sizeof(int) * map->room_count);
+    bool* seen = calloc(map->room_count, sizeof(bool));
+    int status = 0;
+    if (!offsets || !neighbours || !queue || !seen) {
+        status = map_error(parser, 0, "out of memory");
+        goto done;
+    }
+    map_fill_adjacency(map, offsets, neighbours);
+
+    // queue[n] == r while scanning room r means n was already listed as a neighbour
+    for (int r = 0; r < map->room_count; r++) {
+        queue[r] = -1;
+    }
+    for (int r = 0; r < map->room_count && status == 0; r++) {
+        for (int i = offsets[r]; i < offsets[r + 1]; i++) {
+            int n = neighbours[i];
+            if (queue[n] != r) {
+                queue[n] = r;
+                continue;
+            }
+            // report the line of the second edge between r and n
+            bool first = true;
+            for (int e = 0; e < map->edge_count; e++) {
+                if ((map->edges[e][0] == r && map->edges[e][1] == n) || (map->edges[e][0] == n && map->edges[e][1] == r)) {
+                    if (!first) {
+                        status = map_error(parser, parser->edge_lines[e], "rooms \"%s\" and \"%s\" are already connected",
+                                           map->rooms[map->edges[e][0]].name, map->rooms[map->edges[e][1]].name);
+                        break;
+                    }
+                    first = false;
+                }
+            }
+            break;
+        }
+    }
+    if (status != 0) {
+        goto done;
+    }
+
+    // breadth-first search from the start room
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = 0;
+    seen[0] = true;
+    while (head < tail) {
+        int r = queue[head++];
+        for (int i = offsets[r]; i < offsets[r + 1]; i++) {
+            int next = neighbours[i];
+            if (!seen[next]) {
+                seen[next] = true;
+                queue[tail++] = next;
+            }
+        }
+    }
+    for (int r = 0; tail < map->room_count && r < map->room_count; r++) {
+        if (!seen[r]) {
+            status = map_error(parser, 0, "room \"%s\" cannot be reached from \"%s\"", map->rooms[r].name, map->rooms[0].name);
+            break;
+        }
+    }
+
+done:
+    free(seen);
+    free(offsets);
+    free(neighbours);
+    free(queue);
+    return status;
+}
+
+int house_map_load(const char* path, struct HouseMap* map, char* error, size_t error_size) {
+    map->rooms = NULL;
+    map->room_count = 0;
+    map->edges = NULL;
+    map->edge_count = 0;
+
+    struct MapParser parser = {map, 0, 0, NULL, NULL, 0, path, error, error_size};
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return map_error(&parser, 0, "cannot open the file");
+    }
+
+    int status = 0;
+    int line_number = 0;
+    char line[2 * MAX_ROOM_NAME + 32];
+    while (status == 0 && fgets(line, sizeof(line), file)) {
+        line_number++;
+        size_t length = strcspn(line, "\r\n");
+        if (line[length] == '\0' && !feof(file)) {
+            status = map_error(&parser, line_number, "line too long");
+            break;
+        }
+        line[length] = '\0';
+
+        // trim, skip blanks and comments
+        char* text = line;
+        while (*text == ' ' || *text == '\t') {
+            text++;
+        }
+        char* end = text + strlen(text);
+        while (end > text && (end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
+
+        char* argument = text + strcspn(text, " \t");
+        if (*argument != '\0') {
+            *argument++ = '\0';
+            while (*argument == ' ' || *argument == '\t') {
+                argument++;
+            }
+        }
+
+        if (strcmp(text, "room") == 0) {
+            status = map_add_room(&parser, line_number, argument, false);
+        } else if (strcmp(text, "exit") == 0) {
+            status = map_add_room(&parser, line_number, argument, true);
+        } else if (strcmp(text, "edge") == 0) {
+            status = map_add_edge(&parser, line_number, argument);
+        } else {
+            status = map_error(&parser, line_number, "unknown statement \"%s\" (room, exit or edge)", text);
+        }
+    }
+    fclose(file);
+
+    if (status == 0) {
+        status = map_check_graph(&parser);
+    }
+    free(parser.edge_lines);
+    free(parser.name_slots);
+    if (status != 0) {
+        house_map_free(map);
+    }
+    return status;
+}
+
+void house_map_apply(const struct HouseMap* map, struct House* house) {
+    house->room_count = map->room_count;
+    house->rooms = malloc(sizeof(struct Room) * map->room_count);
+    house->room_offsets = malloc(sizeof(int) * (map->room_count + 1));
+    house->room_neighbours = malloc(sizeof(int) * (2 * map->edge_count + 1));
+
+    for (int i = 0; i < map->room_count; i++) {
+        room_init(&house->rooms[i], map->rooms[i].name, map->rooms[i].is_exit);
+        house->rooms[i].id = i;
+        house->rooms[i].house = house;
+    }
+    map_fill_adjacency(map, house->room_offsets, house->room_neighbours);
+    house->starting_room = house->rooms;
+}
+
+int house_map_save(const struct HouseMap* map, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "# %d rooms, %d connections\n", map->room_count, map->edge_count);
+    for (int r = 0; r < map->room_count; r++) {
+        fprintf(file, "%s %s\n", map->rooms[r].is_exit ? "exit" : "room", map->rooms[r].name);
+    }
+    for (int e = 0; e < map->edge_count; e++) {
+        fprintf(file, "edge %s -- %s\n", map->rooms[map->edges[e][0]].name, map->rooms[map->edges[e][1]].name);
+    }
+    bool failed = ferror(file) != 0;
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    return failed ? -1 : 0;
+}
+
+void house_map_free(struct HouseMap* map) {
+    free(map->rooms);
+    free(map->edges);
+    map->rooms = NULL;
+    map->edges = NULL;
+    map->room_count = 0;
+    map->edge_count = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <stddef.h>
+#include "defs.h"
+
+/*
+    House layouts loaded from a text map file (see maps/willow.map), one statement per line:
+
+        # comment
+        exit Van                    a room hunters can leave the house through
+        room Hallway                any other room
+        edge Van -- Hallway         a two-way connection between two declared rooms
+
+    Room names run to the end of the line (spaces allowed). The first room listed is where
+    the hunters start, so it has to be an exit, and every room has to be reachable from it.
+    There is no limit on the number of rooms or connections. validate_logs.py --map reads
+    the same files.
+*/
+
+struct MapRoom {
+    char name[MAX_ROOM_NAME];
+    bool is_exit;
+};
+
+// A parsed and validated layout, shared read-only by every house built from it
+struct HouseMap {
+    struct MapRoom* rooms;  // rooms[0] is the starting room
+    int room_count;
+    int (*edges)[2];        // Room index pairs, in file order
+    int edge_count;
+};
+
+/**
+ * @brief Parse and validate a map file.
+ * @param[in] path Path of the map file.
+ * @param[out] map Layout to fill; release it with house_map_free().
+ * @param[out] error Receives "path:line: reason" when the file is rejected.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 if the file could not be read or is not a valid layout.
+ */
+int house_map_load(const char* path, struct HouseMap* map, char* error, size_t error_size);
+
+/**
+ * @brief Allocate the rooms of a house and lay their connections out in CSR form.
+ * @param[in] map Layout returned by house_map_load() (or built in, see house_populate_rooms()).
+ * @param[in,out] house House to populate; starting_room is set to rooms[0]. house_cleanup() frees it all.
+ */
+void house_map_apply(const struct HouseMap* map, struct House* house);
+
+/**
+ * @brief Write a layout in the map file format, so house_map_load() and validate_logs.py --map read it back.
+ * @param[in] map Layout to write.
+ * @param[in] path Path of the file to create.
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int house_map_save(const struct HouseMap* map, const char* path);
+
+/**
+ * @brief Release memory owned by a layout.
+ * @param[in,out] map Layout returned by house_map_load().
+ */
+void house_map_free(struct HouseMap* map);
+
+#endif // MAP_H
@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "mapgen.h"
+
+#define MAPGEN_PICK_TRIES 32        // Preferential picks of a full room before falling back to uniform
+#define MAPGEN_LOOP_TRIES 32        // Random pairs tried per extra connection
+
+// Generator state while a layout is being built
+struct MapGen {
+    const struct MapGenConfig* config;
+    struct HouseMap* map;
+    struct RandStream rng;
+    int* depth;             // Steps from the van, per room
+    int* degree;            // Connections so far, per room
+    int* eligible;          // Rooms a new room may attach to (depth and degree allow it)
+    int* eligible_at;       // Index of each room in eligible, -1 if it is not there
+    int eligible_count;
+    int* endpoints;         // Both ends of every connection, so a uniform pick is proportional to degree
+    int endpoint_count;
+    long long* edge_keys;   // Open addressing set of connected pairs (a * rooms + b, a < b), -1 = empty
+    long long edge_slots;   // Power of two
+};
+
+/**
+ * @brief Formats an error for the caller
+ *
+ * @param error Buffer to write into (may be NULL)
+ * @param error_size Size of the buffer
+ * @param format printf-style reason
+ * @return -1, so callers can return it directly
+ */
+static int map_gen_error(char* error, size_t error_size, const char* format, ...) {
+    if (error && error_size > 0) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(error, error_size, format, args);
+        va_end(args);
+    }
+    return -1;
+}
+
+static bool map_gen_room_full(const struct MapGen* gen, int room) {
+    return gen->config->max_degree > 0 && gen->degree[room] >= gen->config->max_degree;
+}
+
+static void map_gen_set_eligible(struct MapGen* gen, int room, bool eligible) {
+    if (eligible && gen->eligible_at[room] < 0) {
+        gen->eligible_at[room] = gen->eligible_count;
+        gen->eligible[gen->eligible_count++] = room;
+    } else if (!eligible && gen->eligible_at[room] >= 0) {
+        // swap the last eligible room into the hole
+        int last = gen->eligible[--gen->eligible_count];
+        gen->eligible[gen->eligible_at[room]] = last;
+        gen->eligible_at[last] = gen->eligible_at[room];
+        gen->eligible_at[room] = -1;
+    }
+}
+
+static bool map_gen_can_attach(const struct MapGen* gen, int room) {
+    int limit = gen->config->depth;
+    return (limit == 0 || gen->depth[room] < limit) && !map_gen_room_full(gen, room);
+}
+
+/**
+ * @brief Finds the slot of a pair in the connection set
+ *
+ * @param gen Pointer to the MapGen
+ * @param a One room
+ * @param b The other room
+ * @return Slot holding the pair, or the empty slot where it would go
+ */
+static long long map_gen_edge_slot(const struct MapGen* gen, int a, int b) {
+    long long key = a < b ? (long long)a * gen->map->room_count + b : (long long)b * gen->map->room_count + a;
+    long long mask = gen->edge_slots - 1;
+    long long slot = (long long)(((unsigned long long)key * 0x9E3779B97F4A7C15ull) >> 17) & mask;
+    while (gen->edge_keys[slot] >= 0 && gen->edge_keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static bool map_gen_connected(const struct MapGen* gen, int a, int b) {
+    return gen->edge_keys[map_gen_edge_slot(gen, a, b)] >= 0;
+}
+
+/**
+ * @brief Adds a connection and updates degrees, eligibility and the pair set
+ *
+ * @param gen Pointer to the MapGen (edge array already big enough)
+ * @param a One room
+ * @param b The other room (not yet connected to a)
+ */
+static void map_gen_connect(struct MapGen* gen, int a, int b) {
+    struct HouseMap* map = gen->map;
+    map->edges[map->edge_count][0] = a;
+    map->edges[map->edge_count][1] = b;
+    map->edge_count++;
+
+    long long slot = map_gen_edge_slot(gen, a, b);
+    gen->edge_keys[slot] = a < b ? (long long)a * map->room_count + b : (long long)b * map->room_count + a;
+
+    int ends[2] = {a, b};
+    for (int i = 0; i < 2; i++) {
+        gen->degree[ends[i]]++;
+        gen->endpoints[gen->endpoint_count++] = ends[i];
+        if (map_gen_room_full(gen, ends[i])) {
+            map_gen_set_eligible(gen, ends[i], false);
+        }
+    }
+}
+
+/**
+ * @brief Picks the room a new room attaches to, following the degree distribution
+ *
+ * @param gen Pointer to the MapGen
+ * @return Room index, or -1 if no room can take another connection
+ */
+static int map_gen_pick_parent(struct MapGen* gen) {
+    if (gen->eligible_count == 0) {
+        return -1;
+    }
+    if (gen->config->degree == MAPGEN_PREFERENTIAL && gen->endpoint_count > 0) {
+        for (int i = 0; i < MAPGEN_PICK_TRIES; i++) {
+            int room = gen->endpoints[rand_stream_int(&gen->rng, 0, gen->endpoint_count)];
+            if (gen->eligible_at[room] >= 0) {
+                return room;
+            }
+        }
+    }
+    return gen->eligible[rand_stream_int(&gen->rng, 0, gen->eligible_count)];
+}
+
+/**
+ * @brief Grows the spanning tree: the corridor down to the requested depth, then every other room
+ *
+ * @param gen Pointer to the MapGen
+ * @param error Buffer for the reason of a failure
+ * @param error_size Size of the buffer
+ * @return 0 on success, -1 if the degree limit leaves nowhere to attach a room
+ */
+static int map_gen_tree(struct MapGen* gen, char* error, size_t error_size) {
+    const struct MapGenConfig* config = gen->config;
+    gen->depth[0] = 0;
+    map_gen_set_eligible(gen, 0, map_gen_can_attach(gen, 0));
+
+    for (int room = 1; room < config->rooms; room++) {
+        int parent = room <= config->depth ? room - 1 : map_gen_pick_parent(gen);
+        if (parent < 0 || map_gen_room_full(gen, parent)) {
+            return map_gen_error(error, error_size, "no room can take room %d (max-degree=%d is too low, raise it or depth=%d)",
+                                 room, config->max_degree, config->depth);
+        }
+        gen->depth[room] = gen->depth[parent] + 1;
+        map_gen_connect(gen, parent, room);
+        map_gen_set_eligible(gen, room, map_gen_can_attach(gen, room));
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds the extra connections of a cyclic layout between rooms on the same or neighbouring levels
+ *
+ * @param gen Pointer to the MapGen (tree already built)
+ * @param target Connections to add
+ * @param error Buffer for the reason of a failure
+ * @param error_size Size of the buffer
+ * @return 0 on success, -1 if the degree limit or the house size does not leave enough free pairs
+ */
+static int map_gen_loops(struct MapGen* gen, long long target, char* error, size_t error_size) {
+    int rooms = gen->config->rooms;
+    int levels = 0;
+    for (int r = 0; r < rooms; r++) {
+        if (gen->depth[r] + 1 > levels) {
+            levels = gen->depth[r] + 1;
+        }
+    }
+
+    // rooms grouped by level: level_rooms[level_start[l]] up to level_rooms[level_start[l + 1] - 1]
+    int* level_start = calloc(levels + 1, sizeof(int));
+    int* level_rooms = malloc(sizeof(int) * rooms);
+    int* fill = malloc(sizeof(int) * levels);
+    if (!level_start || !level_rooms || !fill) {
+        free(level_start);
+        free(level_rooms);
+        free(fill);
+        return map_gen_error(error, error_size, "out of memory");
+    }
+    for (int r = 0; r < rooms; r++) {
+        level_start[gen->depth[r] + 1]++;
+    }
+    for (int l = 0; l < levels; l++) {
+        level_start[l + 1] += level_start[l];
+    }
+    for (int l = 0; l < levels; l++) {
+        fill[l] = level_start[l];
+    }
+    for (int r = 0; r < rooms; r++) {
+        level_rooms[fill[gen->depth[r]]++] = r;
+    }
+    free(fill);
+
+    long long added = 0;
+    long long tries = target * MAPGEN_LOOP_TRIES;
+    while (added < target && tries-- > 0) {
+        int a = rand_stream_int(&gen->rng, 0, rooms);
+        int level = gen->depth[a] + rand_stream_int(&gen->rng, 0, 2);
+        if (level >= levels) {
+            level = gen->depth[a];
+        }
+        int b = level_rooms[rand_stream_int(&gen->rng, level_start[level], level_start[level + 1])];
+        if (a == b || map_gen_room_full(gen, a) || map_gen_room_full(gen, b) || map_gen_connected(gen, a, b)) {
+            continue;
+        }
+        map_gen_connect(gen, a, b);
+        added++;
+    }
+    free(level_start);
+    free(level_rooms);
+
+    if (added < target) {
+        return map_gen_error(error, error_size, "only found room for %lld of %lld extra connections (lower loops or raise max-degree)",
+                             added, target);
+    }
+    return 0;
+}
+
+void map_gen_defaults(struct MapGenConfig* config, uint64_t seed) {
+    config->rooms = 64;
+    config->depth = 0;
+    config->degree = MAPGEN_UNIFORM;
+    config->max_degree = 0;
+    config->loops = 0.0;
+    config->seed = seed;
+}
+
+int map_gen_parse(const char* spec, struct MapGenConfig* config, char* error, size_t error_size) {
+    char buffer[256];
+    if (strlen(spec) >= sizeof(buffer)) {
+        return map_gen_error(error, error_size, "spec too long");
+    }
+    strcpy(buffer, spec);
+
+    for (char* item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        char* value = strchr(item, '=');
+        if (!value || value[1] == '\0') {
+            return map_gen_error(error, error_size, "\"%s\" is not key=value", item);
+        }
+        *value++ = '\0';
+
+        char* end;
+        bool valid;
+        if (strcmp(item, "rooms") == 0) {
+            long rooms = strtol(value, &end, 10);
+            valid = *end == '\0' && rooms >= 2 && rooms <= 100000000L;
+            config->rooms = (int)rooms;
+        } else if (strcmp(item, "depth") == 0) {
+            long depth = strtol(value, &end, 10);
+            valid = *end == '\0' && depth >= 0 && depth <= 100000000L;
+            config->depth = (int)depth;
+        } else if (strcmp(item, "max-degree") == 0) {
+            long max_degree = strtol(value, &end, 10);
+            valid = *end == '\0' && max_degree >= 0 && max_degree <= 100000000L;
+            config->max_degree = (int)max_degree;
+        } else if (strcmp(item, "loops") == 0) {
+            config->loops = strtod(value, &end);
+            valid = *end == '\0' && config->loops >= 0.0 && config->loops <= 1000.0;
+        } else if (strcmp(item, "seed") == 0) {
+            config->seed = strtoull(value, &end, 10);
+            valid = *end == '\0';
+        } else if (strcmp(item, "degree") == 0) {
+            valid = true;
+            if (strcmp(value, "uniform") == 0) {
+                config->degree = MAPGEN_UNIFORM;
+            } else if (strcmp(value, "preferential") == 0) {
+                config->degree = MAPGEN_PREFERENTIAL;
+            } else {
+                valid = false;
+            }
+        } else {
+            return map_gen_error(error, error_size, "unknown key \"%s\" (rooms, depth, degree, max-degree, loops or seed)", item);
+        }
+        if (!valid) {
+            return map_gen_error(error, error_size, "invalid %s value \"%s\"", item, value);
+        }
+    }
+
+    if (config->depth >= config->rooms) {
+        return map_gen_error(error, error_size, "depth=%d needs at least %d rooms", config->depth, config->depth + 1);
+    }
+    return 0;
+}
+
+int house_map_generate(const struct MapGenConfig* config, struct HouseMap* map, char* error, size_t error_size) {
+    int rooms = config->rooms;
+    long long extra = (long long)(config->loops * (rooms - 1) + 0.5);
+    long long edge_count = rooms - 1 + extra;
+
+    map->room_count = rooms;
+    map->edge_count = 0;
+    map->rooms = malloc(sizeof(struct MapRoom) * rooms);
+    map->edges = malloc(sizeof(map->edges[0]) * edge_count);
+
+    struct MapGen gen;
+    gen.config = config;
+    gen.map = map;
+    rand_stream_init(&gen.rng, config->seed, 0, RNG_SLOT_MAPGEN);
+    gen.depth = malloc(sizeof(int) * rooms);
+    gen.degree = calloc(rooms, sizeof(int));
+    gen.eligible = malloc(sizeof(int) * rooms);
+    gen.eligible_at = malloc(sizeof(int) * rooms);
+    gen.eligible_count = 0;
+    gen.endpoints = malloc(sizeof(int) * 2 * edge_count);
+    gen.endpoint_count = 0;
+    gen.edge_slots = 64;
+    while (gen.edge_slots < 2 * edge_count) {
+        gen.edge_slots *= 2;
+    }
+    gen.edge_keys = malloc(sizeof(long long) * gen.edge_slots);
+
+    int status = 0;
+    if (!map->rooms || !map->edges || !gen.depth || !gen.degree || !gen.eligible || !gen.eligible_at ||
+        !gen.endpoints || !gen.edge_keys) {
+        status = map_gen_error(error, error_size, "out of memory");
+    } else {
+        for (int r = 0; r < rooms; r++) {
+            gen.eligible_at[r] = -1;
+            map->rooms[r].is_exit = (r == 0);
+            if (r == 0) {
+                strcpy(map->rooms[r].name, "Van");
+            } else {
+                snprintf(map->rooms[r].name, MAX_ROOM_NAME, "Room %d", r);
+            }
+        }
+        memset(gen.edge_keys, -1, sizeof(long long) * gen.edge_slots);
+
+        status = map_gen_tree(&gen, error, error_size);
+        if (status == 0 && extra > 0) {
+            status = map_gen_loops(&gen, extra, error, error_size);
+        }
+    }
+
+    free(gen.depth);
+    free(gen.degree);
+    free(gen.eligible);
+    free(gen.eligible_at);
+    free(gen.endpoints);
+    free(gen.edge_keys);
+    if (status != 0) {
+        house_map_free(map);
+    }
+    return status;
+}
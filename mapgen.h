@@ -0,0 +1,69 @@
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "map.h"
+
+/*
+    Procedural house layouts for scaling experiments (--generate SPEC).
+
+    The generator grows a spanning tree from the van: first a corridor of `depth` rooms so the
+    deepest room really is that far away, then every other room hangs off an existing room that
+    is less than `depth` steps from the van and has fewer than `max-degree` connections. Which
+    room it picks follows the degree distribution:
+
+        uniform         any eligible room (random recursive tree, few rooms with many doors)
+        preferential    proportional to its connections (a few hubs, long tail of dead ends)
+
+    `loops` adds that many extra connections per room on top of the tree (0 = a tree), only
+    between rooms on the same or neighbouring levels, so no room gets closer to the van.
+
+    SPEC is a comma separated list of key=value pairs, e.g.
+        rooms=500,depth=12,degree=preferential,max-degree=8,loops=0.2,seed=3
+    The result is an ordinary HouseMap: every house of a batch is built from it and it can be
+    written out with house_map_save() for validate_logs.py --map.
+*/
+
+enum MapGenDegree {
+    MAPGEN_UNIFORM = 0,
+    MAPGEN_PREFERENTIAL = 1
+};
+
+struct MapGenConfig {
+    int rooms;                  // Rooms including the van (at least 2)
+    int depth;                  // Steps from the van to the deepest room (0 = no limit)
+    enum MapGenDegree degree;   // How rooms pick where to attach
+    int max_degree;             // Connections a room may have (0 = no limit)
+    double loops;               // Extra connections per room beyond the tree
+    uint64_t seed;
+};
+
+/**
+ * @brief Fill in the defaults (64 rooms, no depth or degree limit, uniform, tree).
+ * @param[out] config Settings to initialise.
+ * @param[in] seed Seed used unless the spec sets one.
+ */
+void map_gen_defaults(struct MapGenConfig* config, uint64_t seed);
+
+/**
+ * @brief Read a key=value spec into the settings (keys not listed keep their value).
+ * @param[in] spec Text such as "rooms=500,loops=0.1".
+ * @param[in,out] config Settings to update.
+ * @param[out] error Receives the reason when the spec is rejected.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 on an unknown key or a bad value.
+ */
+int map_gen_parse(const char* spec, struct MapGenConfig* config, char* error, size_t error_size);
+
+/**
+ * @brief Build a connected layout from the settings; the same settings always give the same layout.
+ * @param[in] config Generator settings.
+ * @param[out] map Layout to fill; release it with house_map_free().
+ * @param[out] error Receives the reason when no layout fits the settings.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 if the settings cannot be met or out of memory.
+ */
+int house_map_generate(const struct MapGenConfig* config, struct HouseMap* map, char* error, size_t error_size);
+
+#endif // MAPGEN_H
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "defs.h"
+#include "helpers.h"
+#include "metrics.h"
+
+#define METRICS_PREFIX "ghost_batch_"
+
+/**
+ * @brief Writes the HELP and TYPE lines of a metric family
+ *
+ * @param out Stream to write to
+ * @param name Metric name without the prefix
+ * @param type "counter" or "gauge"
+ * @param help One line description
+ */
+static void metrics_family(FILE* out, const char* name, const char* type, const char* help) {
+    fprintf(out, "# HELP " METRICS_PREFIX "%s %s\n", name, help);
+    fprintf(out, "# TYPE " METRICS_PREFIX "%s %s\n", name, type);
+}
+
+/**
+ * @brief Writes every metric of a sample
+ *
+ * @param out Stream to write to
+ * @param sample Current counters
+ * @param previous Earlier sample for the rates, NULL for the batch start
+ */
+static void metrics_print(FILE* out, const struct MetricsSample* sample, const struct MetricsSample* previous) {
+    double interval = sample->elapsed_seconds - (previous ? previous->elapsed_seconds : 0.0);
+
+    metrics_family(out, "runs", "gauge", "Hunts in the batch.");
+    fprintf(out, METRICS_PREFIX "runs %d\n", sample->runs);
+    metrics_family(out, "hunts_completed_total", "counter", "Hunts finished so far.");
+    fprintf(out, METRICS_PREFIX "hunts_completed_total %d\n", sample->hunts);
+    metrics_family(out, "hunts_won_total", "counter", "Hunts where the hunters identified the ghost.");
+    fprintf(out, METRICS_PREFIX "hunts_won_total %d\n", sample->won);
+    metrics_family(out, "hunts_failed_total", "counter", "Hunts where every hunter left without the ghost.");
+    fprintf(out, METRICS_PREFIX "hunts_failed_total %d\n", sample->hunts - sample->won);
+
+    metrics_family(out, "hunter_exits_total", "counter", "Hunters that left the house, by reason.");
+    for (int i = 0; i < 3; i++) {
+        fprintf(out, METRICS_PREFIX "hunter_exits_total{reason=\"%s\"} %d\n",
+                exit_reason_to_string((enum LogReason)i), sample->exits[i]);
+    }
+
+    long long steps = sample->steps - (previous ? previous->steps : 0);
+    metrics_family(out, "steps_total", "counter", "Hunter and ghost turns of finished hunts.");
+    fprintf(out, METRICS_PREFIX "steps_total %lld\n", sample->steps);
+    metrics_family(out, "steps_per_second", "gauge", "Turns per second since the previous sample.");
+    fprintf(out, METRICS_PREFIX "steps_per_second %.1f\n", interval > 0.0 ? steps / interval : 0.0);
+
+    metrics_family(out, "log_events_total", "counter", "Events queued for the log files.");
+    fprintf(out, METRICS_PREFIX "log_events_total %zu\n", sample->log_events);
+    metrics_family(out, "log_events_dropped_total", "counter", "Events dropped because the log queue was full.");
+    fprintf(out, METRICS_PREFIX "log_events_dropped_total %zu\n", sample->log_dropped);
+
+    metrics_family(out, "worker_busy_seconds_total", "counter", "Time each worker spent on hunts.");
+    for (int i = 0; i < sample->worker_count; i++) {
+        fprintf(out, METRICS_PREFIX "worker_busy_seconds_total{worker=\"%d\"} %.3f\n", i, sample->busy_seconds[i]);
+    }
+    metrics_family(out, "worker_utilisation", "gauge", "Share of the time since the previous sample each worker was busy.");
+    for (int i = 0; i < sample->worker_count; i++) {
+        double busy = sample->busy_seconds[i] - (previous ? previous->busy_seconds[i] : 0.0);
+        double utilisation = interval > 0.0 ? busy / interval : 0.0;
+        fprintf(out, METRICS_PREFIX "worker_utilisation{worker=\"%d\"} %.3f\n", i,
+                utilisation < 0.0 ? 0.0 : (utilisation > 1.0 ? 1.0 : utilisation));
+    }
+
+    metrics_family(out, "elapsed_seconds", "gauge", "Time since the batch started.");
+    fprintf(out, METRICS_PREFIX "elapsed_seconds %.3f\n", sample->elapsed_seconds);
+    metrics_family(out, "finished", "gauge", "1 once every hunt of the batch is done.");
+    fprintf(out, METRICS_PREFIX "finished %d\n", sample->finished ? 1 : 0);
+}
+
+int metrics_write(const char* path, const struct MetricsSample* sample, const struct MetricsSample* previous) {
+    size_t length = strlen(path) + sizeof(".tmp");
+    char* temporary = malloc(length);
+    if (!temporary) {
+        return -1;
+    }
+    snprintf(temporary, length, "%s.tmp", path);
+
+    FILE* out = fopen(temporary, "w");
+    if (!out) {
+        free(temporary);
+        return -1;
+    }
+    metrics_print(out, sample, previous);
+
+    // the new file has to be complete on disk before it takes the old one's name
+    int status = 0;
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        status = -1;
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status == 0 && rename(temporary, path) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        remove(temporary);
+    }
+    free(temporary);
+    return status;
+}
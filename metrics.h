@@ -0,0 +1,54 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Live batch progress as a Prometheus text file (--metrics FILE), for the node_exporter
+    textfile collector (give the file a .prom name inside its --collector.textfile.directory).
+
+    batch.c takes a sample of its counters every --metrics-interval seconds and once more when
+    the batch ends; metrics_write() turns it into the file. The file is written under a
+    temporary name in the same directory and renamed over the old one, so a scrape never sees a
+    half written file. Rates (steps/s, worker utilisation) are over the time since the previous
+    sample, so a stall shows up as a drop within one interval.
+
+    Every metric starts with ghost_batch_:
+        runs                            hunts in the batch (gauge)
+        hunts_completed_total           finished hunts
+        hunts_won_total / hunts_failed_total
+        hunter_exits_total{reason}      evidence, bored, afraid
+        steps_total, steps_per_second   hunter and ghost turns
+        log_events_total, log_events_dropped_total
+        worker_busy_seconds_total{worker}, worker_utilisation{worker}
+        elapsed_seconds, finished       finished is 1 in the last file of the batch
+*/
+
+#define METRICS_DEFAULT_INTERVAL 5.0    // Seconds between rewrites
+
+// Counters of a batch at one moment
+struct MetricsSample {
+    double elapsed_seconds;     // Since the batch started
+    int runs;                   // Hunts in the batch
+    int hunts;                  // Hunts finished so far
+    int won;
+    int exits[3];               // Hunter exits indexed by LogReason
+    long long steps;
+    size_t log_events;          // Events queued for the log files
+    size_t log_dropped;
+    int worker_count;
+    double* busy_seconds;       // Per worker, time spent on hunts since the batch started
+    bool finished;
+};
+
+/**
+ * @brief Replace the metrics file with one sample.
+ * @param[in] path File to write; PATH.tmp is used on the way.
+ * @param[in] sample Current counters.
+ * @param[in] previous Sample the rates are taken against, NULL for the batch start.
+ * @return 0 on success, -1 if the file could not be written (the old one is left alone).
+ */
+int metrics_write(const char* path, const struct MetricsSample* sample, const struct MetricsSample* previous);
+
+#endif // METRICS_H
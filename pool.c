@@ -0,0 +1,567 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "defs.h"
+#include "helpers.h"
+#include "pool.h"
+
+#define POOL_GHOST_TURNS 10         // Ghost turns per hunter turn, like usleep(1000) vs usleep(10000)
+#define POOL_GHOST -1               // Entity index used for the ghost
+#define POOL_DEQUE_INITIAL 64       // Slots in a new deque (power of two, doubles when full)
+#define POOL_IDLE_SWEEPS 64         // Failed searches for work before an idle worker naps
+#define POOL_IDLE_SLEEP_US 100
+
+// One hunter or ghost of a house, scheduled as a unit
+struct StepTask {
+    struct PoolHunt* hunt;
+    int entity;             // Index in house->hunters, or POOL_GHOST
+    atomic_int turns;       // Turns a hunter has finished, INT_MAX once it has left (unused for the ghost)
+};
+
+// Pool bookkeeping for one house
+struct PoolHunt {
+    struct House* house;
+    atomic_int hunters_left;    // The ghost is stopped when this reaches 0
+    atomic_int tasks_left;      // The house is done when this reaches 0
+    long long ghost_allowed;    // ghost->steps the ghost may reach before the hunters catch up (ghost task only)
+    struct StepTask tasks[];    // hunter_count + 1 tasks, the ghost last
+};
+
+// Slots of a deque; replaced by one twice the size when full
+struct DequeArray {
+    long capacity;
+    struct DequeArray* retired;     // The array this one replaced (thieves may still be reading it)
+    _Atomic(struct StepTask*) slots[];
+};
+
+// Chase-Lev deque (C11 version of Le, Pop, Cohen and Zappa Nardelli, PPoPP 2013).
+// Only the owner pushes and takes at the bottom; anyone may steal at the top.
+struct StepDeque {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(struct DequeArray*) array;
+};
+
+struct StepWorker {
+    struct StepPool* pool;
+    int index;
+    pthread_t thread;
+    struct StepDeque deque;
+    struct StepTask** round;    // Tasks that already had their turn this round
+    int round_count;
+    int round_capacity;
+    int victim;                 // Where the next steal attempt starts
+    atomic_llong idle_ns;       // Time spent looking for work, finished idle spells only
+    atomic_llong idle_since;    // CLOCK_MONOTONIC ns the current idle spell began, 0 while busy
+};
+
+static _Thread_local struct StepWorker* step_current_worker = NULL;
+
+static long long step_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static struct DequeArray* deque_array_new(long capacity) {
+    struct DequeArray* array = malloc(sizeof(struct DequeArray) + sizeof(array->slots[0]) * capacity);
+    if (!array) {
+        fprintf(stderr, "Out of memory growing a step deque\n");
+        exit(1);
+    }
+    array->capacity = capacity;
+    array->retired = NULL;
+    return array;
+}
+
+static void deque_init(struct StepDeque* deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, deque_array_new(POOL_DEQUE_INITIAL));
+}
+
+static void deque_free(struct StepDeque* deque) {
+    struct DequeArray* array = atomic_load(&deque->array);
+    while (array) {
+        struct DequeArray* retired = array->retired;
+        free(array);
+        array = retired;
+    }
+}
+
+/**
+ * @brief Pushes a task at the bottom (owner only), doubling the array when it is full
+ *
+ * @param deque Pointer to the worker's own StepDeque
+ * @param task Task to push
+ */
+static void deque_push(struct StepDeque* deque, struct StepTask* task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    struct DequeArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    if (bottom - top > array->capacity - 1) {
+        struct DequeArray* bigger = deque_array_new(array->capacity * 2);
+        for (long i = top; i < bottom; i++) {
+            struct StepTask* moved = atomic_load_explicit(&array->slots[i & (array->capacity - 1)], memory_order_relaxed);
+            atomic_store_explicit(&bigger->slots[i & (bigger->capacity - 1)], moved, memory_order_relaxed);
+        }
+        // the old array is freed with the deque, a thief may have just loaded it
+        bigger->retired = array;
+        atomic_store_explicit(&deque->array, bigger, memory_order_release);
+        array = bigger;
+    }
+
+    atomic_store_explicit(&array->slots[bottom & (array->capacity - 1)], task, memory_order_relaxed);
+    // publishes the slot (and the task's entity) to thieves
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+}
+
+/**
+ * @brief Takes the most recently pushed task (owner only)
+ *
+ * @param deque Pointer to the worker's own StepDeque
+ * @return The task, or NULL if the deque is empty (or a thief got the last one)
+ */
+static struct StepTask* deque_take(struct StepDeque* deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    struct DequeArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+    struct StepTask* task = atomic_load_explicit(&array->slots[bottom & (array->capacity - 1)], memory_order_relaxed);
+    if (top == bottom) {
+        // last task: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * @brief Takes the oldest task of another worker's deque
+ *
+ * @param deque Pointer to the victim's StepDeque
+ * @return The task, or NULL if the deque is empty or another thread won the race
+ */
+static struct StepTask* deque_steal(struct StepDeque* deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    struct DequeArray* array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    struct StepTask* task = atomic_load_explicit(&array->slots[top & (array->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+// Tasks currently in a deque; only a hint when other threads are using it
+static long deque_size(struct StepDeque* deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+}
+
+/**
+ * @brief Pushes tasks so that they are taken in array order
+ *
+ * @param worker Pointer to the StepWorker that owns the deque
+ * @param tasks Tasks to push
+ * @param count Number of tasks
+ */
+static void step_push_all(struct StepWorker* worker, struct StepTask** tasks, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        deque_push(&worker->deque, tasks[i]);
+    }
+}
+
+/**
+ * @brief Drops one reference on the pool (a finished house, or the caller in step_pool_wait)
+ *
+ * @param pool Pointer to the StepPool
+ */
+static void step_pool_release(struct StepPool* pool) {
+    if (atomic_fetch_sub(&pool->active, 1) == 1) {
+        sem_post(&pool->finished);
+    }
+}
+
+/**
+ * @brief Stops the ghost of a house, the same way house_run does once every hunter is out
+ *
+ * @param house Pointer to the House
+ */
+static void step_stop_ghost(struct House* house) {
+    lock_acquire(&house->ghost->mutex);
+    house->ghost->running = false;
+    lock_release(&house->ghost->mutex);
+}
+
+/**
+ * @brief How far the ghost of a house may get: POOL_GHOST_TURNS turns past the slowest hunter
+ *
+ * @param hunt Pointer to the PoolHunt
+ * @return ghost->steps the ghost may reach, LLONG_MAX once every hunter has left
+ */
+static long long step_ghost_allowance(struct PoolHunt* hunt) {
+    int slowest = INT_MAX;
+    for (int i = 0; i < hunt->house->hunter_count; i++) {
+        int turns = atomic_load_explicit(&hunt->tasks[i].turns, memory_order_relaxed);
+        if (turns < slowest) {
+            slowest = turns;
+        }
+    }
+    return slowest == INT_MAX ? LLONG_MAX : (long long)POOL_GHOST_TURNS * (slowest + 1);
+}
+
+/**
+ * @brief Gives an entity its turn. The ghost is paced against its own hunters, which may be on
+ * other workers: it waits while it is a round ahead of the slowest one
+ *
+ * @param task Pointer to the StepTask
+ * @return true if the entity is still in the hunt and needs another turn
+ */
+static bool step_task_run(struct StepTask* task) {
+    struct PoolHunt* hunt = task->hunt;
+    struct House* house = hunt->house;
+    if (task->entity != POOL_GHOST) {
+        bool in_hunt = hunter_step(house->hunters[task->entity]);
+        if (in_hunt) {
+            atomic_fetch_add_explicit(&task->turns, 1, memory_order_relaxed);
+        } else {
+            atomic_store_explicit(&task->turns, INT_MAX, memory_order_relaxed);
+        }
+        return in_hunt;
+    }
+    for (int turn = 0; turn < POOL_GHOST_TURNS; turn++) {
+        if (house->ghost->steps >= hunt->ghost_allowed) {
+            // only rescan the hunters once the last allowance is used up
+            hunt->ghost_allowed = step_ghost_allowance(hunt);
+            if (house->ghost->steps >= hunt->ghost_allowed) {
+                // a hunter is behind (starved or on a busy worker): let it run
+                sched_yield();
+                return true;
+            }
+        }
+        if (!ghost_step(house->ghost)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Retires a task whose entity has left the hunt, finishing the house after the last one
+ *
+ * @param pool Pointer to the StepPool
+ * @param task Pointer to the finished StepTask
+ */
+static void step_task_finish(struct StepPool* pool, struct StepTask* task) {
+    struct PoolHunt* hunt = task->hunt;
+    if (task->entity != POOL_GHOST && atomic_fetch_sub(&hunt->hunters_left, 1) == 1) {
+        step_stop_ghost(hunt->house);
+    }
+    if (atomic_fetch_sub(&hunt->tasks_left, 1) == 1) {
+        // every other worker is done with this house (their decrements came first)
+        if (pool->done) {
+            pool->done(hunt->house, pool->context);
+        }
+        free(hunt);
+        step_pool_release(pool);
+    }
+}
+
+/**
+ * @brief Takes a fair share of the inject queue into the worker's own deque
+ *
+ * @param worker Pointer to the StepWorker
+ * @return true if anything was taken
+ */
+static bool step_take_injected(struct StepWorker* worker) {
+    struct StepPool* pool = worker->pool;
+    sem_wait(&pool->inject_mutex);
+    int waiting = pool->inject_count - pool->inject_head;
+    int share = (waiting + pool->worker_count - 1) / pool->worker_count;
+    step_push_all(worker, pool->injected + pool->inject_head, share);
+    pool->inject_head += share;
+    if (pool->inject_head == pool->inject_count) {
+        pool->inject_head = 0;
+        pool->inject_count = 0;
+    }
+    sem_post(&pool->inject_mutex);
+    return share > 0;
+}
+
+/**
+ * @brief Steals half of the tasks of the first worker that has any
+ *
+ * @param worker Pointer to the StepWorker that ran out of work
+ * @return true if anything was stolen (it is in the worker's own deque)
+ */
+static bool step_steal(struct StepWorker* worker) {
+    struct StepPool* pool = worker->pool;
+    for (int i = 0; i < pool->worker_count - 1; i++) {
+        worker->victim = (worker->victim + 1) % pool->worker_count;
+        if (worker->victim == worker->index) {
+            worker->victim = (worker->victim + 1) % pool->worker_count;
+        }
+        struct StepDeque* victim = &pool->workers[worker->victim].deque;
+
+        long want = (deque_size(victim) + 1) / 2;
+        long stolen = 0;
+        struct StepTask* task;
+        while (stolen < want && (task = deque_steal(victim)) != NULL) {
+            deque_push(&worker->deque, task);
+            stolen++;
+        }
+        if (stolen > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Refills an empty deque: new houses first, then the next round, then other workers' tasks
+ *
+ * @param worker Pointer to the StepWorker whose deque ran empty
+ * @return true if the deque has tasks again
+ */
+static bool step_refill(struct StepWorker* worker) {
+    if (step_take_injected(worker)) {
+        return true;
+    }
+    if (worker->round_count > 0) {
+        step_push_all(worker, worker->round, worker->round_count);
+        worker->round_count = 0;
+        return true;
+    }
+    return step_steal(worker);
+}
+
+/**
+ * @brief Keeps a task for the worker's next round
+ *
+ * @param worker Pointer to the StepWorker
+ * @param task Task that just had its turn
+ */
+static void step_keep(struct StepWorker* worker, struct StepTask* task) {
+    if (worker->round_count == worker->round_capacity) {
+        int capacity = worker->round_capacity ? worker->round_capacity * 2 : POOL_DEQUE_INITIAL;
+        struct StepTask** round = realloc(worker->round, sizeof(struct StepTask*) * capacity);
+        if (!round) {
+            fprintf(stderr, "Out of memory growing a step round\n");
+            exit(1);
+        }
+        worker->round = round;
+        worker->round_capacity = capacity;
+    }
+    worker->round[worker->round_count++] = task;
+}
+
+/**
+ * @brief The thread function for a pool worker. Runs turns until the pool is stopped
+ *
+ * @param arg Void pointer to the StepWorker
+ * @return NULL once the pool stops
+ */
+static void* step_worker(void* arg) {
+    struct StepWorker* worker = (struct StepWorker*)arg;
+    struct StepPool* pool = worker->pool;
+    step_current_worker = worker;
+
+    int idle = 0;
+    while (!atomic_load_explicit(&pool->stopping, memory_order_acquire)) {
+        struct StepTask* task = deque_take(&worker->deque);
+        if (!task) {
+            if (step_refill(worker)) {
+                if (idle > 0) {
+                    // the clock is only read when an idle spell starts and ends
+                    long long since = atomic_load_explicit(&worker->idle_since, memory_order_relaxed);
+                    atomic_fetch_add_explicit(&worker->idle_ns, step_now_ns() - since, memory_order_relaxed);
+                    atomic_store_explicit(&worker->idle_since, 0, memory_order_relaxed);
+                }
+                idle = 0;
+                continue;
+            }
+            if (idle == 0) {
+                atomic_store_explicit(&worker->idle_since, step_now_ns(), memory_order_relaxed);
+            }
+            if (++idle < POOL_IDLE_SWEEPS) {
+                sched_yield();
+            } else {
+                usleep(POOL_IDLE_SLEEP_US);
+            }
+            continue;
+        }
+
+        if (step_task_run(task)) {
+            step_keep(worker, task);
+        } else {
+            step_task_finish(pool, task);
+        }
+    }
+    return NULL;
+}
+
+int step_pool_start(struct StepPool* pool, int workers, StepPoolDone done, void* context) {
+    pool->worker_count = workers > 0 ? workers : 1;
+    pool->done = done;
+    pool->context = context;
+    atomic_init(&pool->active, 1);
+    atomic_init(&pool->stopping, false);
+    pool->injected = NULL;
+    pool->inject_head = 0;
+    pool->inject_count = 0;
+    pool->inject_capacity = 0;
+    pool->workers = calloc(pool->worker_count, sizeof(struct StepWorker));
+    if (!pool->workers) {
+        return -1;
+    }
+    sem_init(&pool->finished, 0, 0);
+    sem_init(&pool->inject_mutex, 0, 1);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+        struct StepWorker* worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker->victim = i;
+        atomic_init(&worker->idle_ns, 0);
+        atomic_init(&worker->idle_since, 0);
+        deque_init(&worker->deque);
+    }
+    // every deque exists before any worker can try to steal from it
+    for (int i = 0; i < pool->worker_count; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, step_worker, &pool->workers[i]) != 0) {
+            atomic_store(&pool->stopping, true);
+            for (int j = 0; j < i; j++) {
+                pthread_join(pool->workers[j].thread, NULL);
+            }
+            for (int j = 0; j < pool->worker_count; j++) {
+                deque_free(&pool->workers[j].deque);
+            }
+            free(pool->workers);
+            sem_destroy(&pool->finished);
+            sem_destroy(&pool->inject_mutex);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int step_pool_add(struct StepPool* pool, struct House* house) {
+    int task_count = house->hunter_count + 1;
+    struct PoolHunt* hunt = malloc(sizeof(struct PoolHunt) + sizeof(struct StepTask) * task_count);
+    if (!hunt) {
+        return -1;
+    }
+    hunt->house = house;
+    atomic_init(&hunt->hunters_left, house->hunter_count);
+    atomic_init(&hunt->tasks_left, task_count);
+    hunt->ghost_allowed = 0;
+
+    // hunters first and the ghost's ten turns after them, the order des.c ends up in
+    // (a hunter's next turn is queued before the ghost's turns at the same time)
+    for (int i = 0; i < task_count; i++) {
+        hunt->tasks[i].hunt = hunt;
+        hunt->tasks[i].entity = i < house->hunter_count ? i : POOL_GHOST;
+        atomic_init(&hunt->tasks[i].turns, 0);
+    }
+    if (house->hunter_count == 0) {
+        step_stop_ghost(house);
+    }
+    atomic_fetch_add(&pool->active, 1);
+
+    struct StepWorker* worker = step_current_worker;
+    if (worker && worker->pool == pool) {
+        for (int i = task_count - 1; i >= 0; i--) {
+            deque_push(&worker->deque, &hunt->tasks[i]);
+        }
+        return 0;
+    }
+
+    sem_wait(&pool->inject_mutex);
+    if (pool->inject_count + task_count > pool->inject_capacity) {
+        int capacity = pool->inject_capacity ? pool->inject_capacity : POOL_DEQUE_INITIAL;
+        while (capacity < pool->inject_count + task_count) {
+            capacity *= 2;
+        }
+        struct StepTask** injected = realloc(pool->injected, sizeof(struct StepTask*) * capacity);
+        if (!injected) {
+            sem_post(&pool->inject_mutex);
+            free(hunt);
+            step_pool_release(pool);
+            return -1;
+        }
+        pool->injected = injected;
+        pool->inject_capacity = capacity;
+    }
+    for (int i = 0; i < task_count; i++) {
+        pool->injected[pool->inject_count++] = &hunt->tasks[i];
+    }
+    sem_post(&pool->inject_mutex);
+    return 0;
+}
+
+void step_pool_wait(struct StepPool* pool) {
+    // drop the caller's reference; the last house to finish posts finished
+    step_pool_release(pool);
+    sem_wait(&pool->finished);
+}
+
+long long step_pool_idle_ns(struct StepPool* pool, int worker) {
+    struct StepWorker* w = &pool->workers[worker];
+    long long idle = atomic_load_explicit(&w->idle_ns, memory_order_relaxed);
+    long long since = atomic_load_explicit(&w->idle_since, memory_order_relaxed);
+    if (since != 0) {
+        long long current = step_now_ns() - since;
+        idle += current > 0 ? current : 0;
+    }
+    return idle;
+}
+
+void step_pool_stop(struct StepPool* pool) {
+    atomic_store_explicit(&pool->stopping, true, memory_order_release);
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->worker_count; i++) {
+        deque_free(&pool->workers[i].deque);
+        free(pool->workers[i].round);
+    }
+    free(pool->workers);
+    free(pool->injected);
+    sem_destroy(&pool->finished);
+    sem_destroy(&pool->inject_mutex);
+}
+
+/**
+ * @brief Runs one hunt to completion on a pool of worker threads
+ *
+ * @param house Pointer to the House (already set up with hunters)
+ * @param workers Number of worker threads
+ */
+void house_run_pool(struct House* house, int workers) {
+    struct StepPool pool;
+    if (step_pool_start(&pool, workers, NULL, NULL) != 0) {
+        return;
+    }
+    step_pool_add(&pool, house);
+    step_pool_wait(&pool);
+    step_pool_stop(&pool);
+}
@@ -0,0 +1,86 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "defs.h"
+
+/*
+    Step scheduler: a fixed set of worker threads that run hunters and ghosts one turn at a
+    time, for any number of houses at once (--engine pool).
+
+    Every hunter and ghost of a house becomes a step task. A worker gives a task one turn
+    (hunter_step(), or up to POOL_GHOST_TURNS ghost_step() calls) and keeps it for the next
+    round while the entity is still in the hunt. The ghost's task may sit on another worker than
+    its hunters, so it is paced per house: it only takes a turn while it is less than
+    POOL_GHOST_TURNS turns ahead of the slowest hunter still in the hunt, which keeps it at 10
+    ghost turns per hunter turn however the tasks are spread. Each worker owns a
+    Chase-Lev work-stealing deque: it takes its own tasks from the bottom, and a worker that
+    runs dry steals half of another worker's tasks from the top. Houses added from outside the
+    pool go through a shared inject queue; houses added by a worker (from the done callback)
+    go straight into its own deque.
+
+    Turns are not paced (nothing sleeps), so a hunt takes as long as its steps do. As with the
+    threaded engine the interleaving depends on timing, so seeded hunts are not reproducible;
+    use --engine des for that.
+*/
+
+// Called on a worker once every task of a house has finished; the house is no longer touched
+typedef void (*StepPoolDone)(struct House* house, void* context);
+
+struct StepTask;
+struct StepWorker;
+
+struct StepPool {
+    struct StepWorker* workers;
+    int worker_count;
+    StepPoolDone done;          // NULL if nobody needs to know
+    void* context;              // Passed to done
+    atomic_int active;          // Houses in flight, plus one held by the caller until step_pool_wait()
+    atomic_bool stopping;
+    sem_t finished;             // Posted when active drops to 0
+    sem_t inject_mutex;         // Protects the inject queue
+    struct StepTask** injected; // Tasks added from outside the pool, taken from inject_head on
+    int inject_head;
+    int inject_count;
+    int inject_capacity;
+};
+
+/**
+ * @brief Start the worker threads.
+ * @param[out] pool Pool to set up.
+ * @param[in] workers Number of worker threads (one per core is plenty).
+ * @param[in] done Called on a worker when a house finishes, may be NULL.
+ * @param[in] context Passed to done.
+ * @return 0 on success, -1 if the workers could not be started.
+ */
+int step_pool_start(struct StepPool* pool, int workers, StepPoolDone done, void* context);
+
+/**
+ * @brief Schedule every hunter and the ghost of a house. Safe to call from the done callback.
+ * @param[in,out] pool Running pool.
+ * @param[in,out] house House already set up with its hunters; it belongs to the pool until done is called.
+ * @return 0 on success, -1 if out of memory (the house was not scheduled).
+ */
+int step_pool_add(struct StepPool* pool, struct House* house);
+
+/**
+ * @brief Wait until every house added so far, and every house the done callback adds, has finished.
+ * @param[in,out] pool Running pool; call once.
+ */
+void step_pool_wait(struct StepPool* pool);
+
+/**
+ * @brief Time a worker has spent finding no work since the pool started, for progress reports.
+ * @param[in] pool Running pool.
+ * @param[in] worker Worker index, 0 to worker_count - 1.
+ * @return Idle nanoseconds, including the idle spell it is in now (may be off by one spell
+ *         while the worker is changing state).
+ */
+long long step_pool_idle_ns(struct StepPool* pool, int worker);
+
+/**
+ * @brief Stop and join the workers and release the pool.
+ * @param[in,out] pool Pool after step_pool_wait().
+ */
+void step_pool_stop(struct StepPool* pool);
+
+#endif // POOL_H
@@ -0,0 +1,83 @@
+#include <time.h>
+#include <unistd.h>
+#include "rng.h"
+
+// Philox4x32 constants (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+void philox4x32_10(uint32_t counter[4], const uint32_t key[2]) {
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * counter[0];
+        uint64_t p1 = (uint64_t)PHILOX_M1 * counter[2];
+        uint32_t c0 = (uint32_t)(p1 >> 32) ^ counter[1] ^ k0;
+        uint32_t c1 = (uint32_t)p1;
+        uint32_t c2 = (uint32_t)(p0 >> 32) ^ counter[3] ^ k1;
+        uint32_t c3 = (uint32_t)p0;
+        counter[0] = c0;
+        counter[1] = c1;
+        counter[2] = c2;
+        counter[3] = c3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+void rand_stream_init(struct RandStream* stream, uint64_t seed, int run, uint32_t slot) {
+    stream->key[0] = (uint32_t)seed;
+    stream->key[1] = (uint32_t)(seed >> 32);
+    stream->run = (uint32_t)run;
+    stream->slot = slot;
+    stream->block = 0;
+    stream->available = 0;
+}
+
+uint32_t rand_stream_next(struct RandStream* stream) {
+    if (stream->available == 0) {
+        // counter = (block, slot, run): one independent sequence per entity per run
+        stream->buffer[0] = (uint32_t)stream->block;
+        stream->buffer[1] = (uint32_t)(stream->block >> 32);
+        stream->buffer[2] = stream->slot;
+        stream->buffer[3] = stream->run;
+        philox4x32_10(stream->buffer, stream->key);
+        stream->block++;
+        stream->available = 4;
+    }
+    return stream->buffer[4 - stream->available--];
+}
+
+int rand_stream_int(struct RandStream* stream, int lower_inclusive, int upper_exclusive) {
+    if (upper_exclusive <= lower_inclusive) {
+        return lower_inclusive;
+    }
+
+    // map into the range with a multiply, rejecting the few values that would bias it
+    uint32_t span = (uint32_t)(upper_exclusive - lower_inclusive);
+    uint64_t product = (uint64_t)rand_stream_next(stream) * span;
+    uint32_t low = (uint32_t)product;
+    if (low < span) {
+        uint32_t threshold = -span % span;
+        while (low < threshold) {
+            product = (uint64_t)rand_stream_next(stream) * span;
+            low = (uint32_t)product;
+        }
+    }
+    return lower_inclusive + (int)(product >> 32);
+}
+
+uint64_t rand_fresh_seed(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t seed = ((uint64_t)now.tv_sec << 32) ^ (uint64_t)now.tv_nsec ^ ((uint64_t)getpid() << 16);
+
+    // splitmix64 finaliser so nearby times give unrelated seeds
+    seed += 0x9E3779B97F4A7C15ull;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+    return seed ^ (seed >> 31);
+}
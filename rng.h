@@ -0,0 +1,69 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+    Counter-based random streams (Philox4x32-10).
+
+    A stream is the pair (key, counter): the key comes from the master seed and the counter
+    says which run and which entity the stream belongs to, plus a block number that just
+    counts up. Every number is a pure function of (seed, run, entity, position), so any
+    hunt can be replayed from its seed and two entities never share or overlap a stream,
+    no matter which thread or worker ends up running them.
+*/
+
+// Entity slots used to derive a house's streams
+#define RNG_SLOT_HOUSE 0        // House setup (ghost placement and type)
+#define RNG_SLOT_GHOST 1
+#define RNG_SLOT_HUNTER(i) (2 + (uint32_t)(i))
+#define RNG_SLOT_MAPGEN UINT32_MAX  // Procedural layout (mapgen.c), with run 0
+
+struct RandStream {
+    uint32_t key[2];        // Master seed
+    uint32_t run;           // Batch run the stream belongs to
+    uint32_t slot;          // Entity within the run (see RNG_SLOT_*)
+    uint64_t block;         // Next counter block to generate
+    uint32_t buffer[4];     // Output of the last block
+    int      available;     // Unused words left in buffer
+};
+
+/**
+ * @brief Set up the stream of one entity of one run.
+ * @param[out] stream Stream to initialise.
+ * @param[in] seed Master seed.
+ * @param[in] run Run index (any value, -1 included).
+ * @param[in] slot Entity slot, see RNG_SLOT_*.
+ */
+void rand_stream_init(struct RandStream* stream, uint64_t seed, int run, uint32_t slot);
+
+/**
+ * @brief Next raw 32-bit value of the stream.
+ * @param[in,out] stream Stream to draw from.
+ * @return Uniform 32-bit value.
+ */
+uint32_t rand_stream_next(struct RandStream* stream);
+
+/**
+ * @brief Unbiased random integer (Lemire's multiply-and-reject).
+ * @param[in,out] stream Stream to draw from.
+ * @param[in] lower_inclusive Minimum value (inclusive).
+ * @param[in] upper_exclusive Maximum value (exclusive).
+ * @return Value in [lower_inclusive, upper_exclusive), lower_inclusive if the range is empty.
+ */
+int rand_stream_int(struct RandStream* stream, int lower_inclusive, int upper_exclusive);
+
+/**
+ * @brief Raw Philox4x32-10 block function (exposed for known-answer checks).
+ * @param[in,out] counter 128-bit counter in, 128 random bits out.
+ * @param[in] key 64-bit key.
+ */
+void philox4x32_10(uint32_t counter[4], const uint32_t key[2]);
+
+/**
+ * @brief Make up a master seed from the clock and process id when none was given.
+ * @return A seed that differs between runs of the program.
+ */
+uint64_t rand_fresh_seed(void);
+
+#endif // RNG_H
@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "defs.h"
+#include "helpers.h"
+#include "snapshot.h"
+
+// Start of a snapshot file; the arrays follow in the order of HuntSnapshot
+struct SnapshotFileHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t record_size;   // sizeof(struct SnapshotHunter), catches builds with another layout
+    uint64_t seed;
+    int32_t  run_id;
+    int32_t  room_count;
+    uint64_t layout_hash;
+    int64_t  virtual_now;
+    int32_t  hunter_count;
+    int32_t  trail_total;
+    int32_t  turn_count;
+    uint8_t  collected;
+    uint8_t  solved;
+    uint8_t  reserved[2];
+    int64_t  next_seq;
+};
+
+__attribute__((format(printf, 3, 4)))
+static int snapshot_error(char* error, size_t error_size, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(error, error_size, format, args);
+    va_end(args);
+    return -1;
+}
+
+/**
+ * @brief Fingerprint of a house layout: room names, exits and connections (64-bit FNV-1a)
+ *
+ * @param house Pointer to the House
+ * @return The fingerprint
+ */
+static uint64_t snapshot_layout_hash(const struct House* house) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int r = 0; r < house->room_count; r++) {
+        const struct Room* room = &house->rooms[r];
+        for (const char* c = room->name; *c; c++) {
+            hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+        }
+        hash = (hash ^ (room->is_exit ? 0x100u : 0x200u)) * 1099511628211ULL;
+        for (int i = 0; i < room_degree(room); i++) {
+            hash = (hash ^ (uint64_t)room_neighbour(room, i)->id) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+int snapshot_trigger_parse(const char* spec, struct SnapshotTrigger* trigger, char* error, size_t error_size) {
+    trigger->time = -1;
+    trigger->fear = -1;
+    trigger->hunters = 1;
+    trigger->evidence = -1;
+
+    char buffer[256];
+    if (strlen(spec) >= sizeof(buffer)) {
+        return snapshot_error(error, error_size, "spec too long");
+    }
+    strcpy(buffer, spec);
+
+    for (char* item = strtok(buffer, ","); item; item = strtok(NULL, ",")) {
+        char* value = strchr(item, '=');
+        if (!value || value[1] == '\0') {
+            return snapshot_error(error, error_size, "\"%s\" is not key=value", item);
+        }
+        *value++ = '\0';
+
+        char* end;
+        long long number = strtoll(value, &end, 10);
+        bool valid = *end == '\0' && number >= 0 && number <= 1000000000LL;
+        if (strcmp(item, "time") == 0) {
+            trigger->time = number;
+        } else if (strcmp(item, "fear") == 0) {
+            trigger->fear = (int)number;
+        } else if (strcmp(item, "hunters") == 0) {
+            trigger->hunters = (int)number;
+            valid = valid && number >= 1;
+        } else if (strcmp(item, "evidence") == 0) {
+            trigger->evidence = (int)number;
+        } else {
+            return snapshot_error(error, error_size, "unknown key \"%s\" (time, fear, hunters or evidence)", item);
+        }
+        if (!valid) {
+            return snapshot_error(error, error_size, "invalid %s value \"%s\"", item, value);
+        }
+    }
+    return 0;
+}
+
+bool snapshot_trigger_hit(const struct SnapshotTrigger* trigger, const struct House* house) {
+    if (trigger->time >= 0 && house->virtual_now < trigger->time) {
+        return false;
+    }
+    if (trigger->evidence >= 0) {
+        EvidenceByte collected = atomic_load_explicit(&house->case_file.collected, memory_order_relaxed);
+        if (evidence_table[collected & (EVIDENCE_MASK_COUNT - 1)].count < trigger->evidence) {
+            return false;
+        }
+    }
+    if (trigger->fear >= 0) {
+        int afraid = 0;
+        for (int i = 0; i < house->hunter_count; i++) {
+            const struct Hunter* h = house->hunters[i];
+            if (h->running && h->fear >= trigger->fear) {
+                afraid++;
+            }
+        }
+        if (afraid < trigger->hunters) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int snapshot_capture(const struct House* house, const struct SnapshotTurn* turns, int turn_count, long long next_seq,
+                     struct HuntSnapshot* snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->seed = house->seed;
+    snapshot->run_id = house->run_id;
+    snapshot->room_count = house->room_count;
+    snapshot->layout_hash = snapshot_layout_hash(house);
+    snapshot->virtual_now = house->virtual_now;
+    snapshot->collected = atomic_load(&house->case_file.collected);
+    snapshot->solved = atomic_load(&house->case_file.solved);
+    snapshot->hunter_count = house->hunter_count;
+    snapshot->turn_count = turn_count;
+    snapshot->next_seq = next_seq;
+
+    int trail_total = 0;
+    for (int i = 0; i < house->hunter_count; i++) {
+        trail_total += house->hunters[i]->path_stack.count;
+    }
+    snapshot->evidence = malloc(house->room_count);
+    snapshot->hunters = calloc(house->hunter_count + 1, sizeof(struct SnapshotHunter));
+    snapshot->trails = malloc(sizeof(int32_t) * (trail_total + 1));
+    snapshot->turns = malloc(sizeof(struct SnapshotTurn) * (turn_count + 1));
+    if (!snapshot->evidence || !snapshot->hunters || !snapshot->trails || !snapshot->turns) {
+        snapshot_free(snapshot);
+        return -1;
+    }
+
+    for (int r = 0; r < house->room_count; r++) {
+        snapshot->evidence[r] = atomic_load(&house->rooms[r].evidence);
+    }
+
+    const struct Ghost* g = house->ghost;
+    struct SnapshotGhost* ghost = &snapshot->ghost;
+    ghost->id = g->id;
+    ghost->type = g->type;
+    ghost->room = g->room->id;
+    ghost->boredom = g->boredom;
+    ghost->steps = g->steps;
+    ghost->running = g->running;
+    ghost->present = g->room->ghost == g;
+    ghost->rng = g->rng;
+
+    int32_t* trail = snapshot->trails;
+    for (int i = 0; i < house->hunter_count; i++) {
+        const struct Hunter* h = house->hunters[i];
+        struct SnapshotHunter* hunter = &snapshot->hunters[i];
+        hunter->id = h->id;
+        memcpy(hunter->name, h->name, sizeof(hunter->name));
+        hunter->room = h->room->id;
+        hunter->device = h->device;
+        hunter->fear = h->fear;
+        hunter->boredom = h->boredom;
+        hunter->steps = h->steps;
+        hunter->exit_reason = h->exit_reason;
+        hunter->trail_count = h->path_stack.count;
+        hunter->running = h->running;
+        hunter->return_to_van = h->return_to_van;
+        hunter->rng = h->rng;
+        for (const struct Hunter* other = h->room->hunters; other; other = other->room_next) {
+            if (other == h) {
+                hunter->listed = 1;
+            }
+        }
+        for (int b = 0; b < h->path_stack.count; b++) {
+            *trail++ = h->path_stack.rooms[b];
+        }
+    }
+
+    memcpy(snapshot->turns, turns, sizeof(struct SnapshotTurn) * turn_count);
+    return 0;
+}
+
+int snapshot_restore(const struct HuntSnapshot* snapshot, const struct HouseMap* map, uint64_t seed, int run, bool reseed,
+                     struct House* house, char* error, size_t error_size) {
+    house_init(house, map, run, seed);
+    for (int i = 0; i < snapshot->hunter_count; i++) {
+        if (!house_add_hunter(house, (char*)snapshot->hunters[i].name, snapshot->hunters[i].id)) {
+            house_cleanup(house);
+            return snapshot_error(error, error_size, "out of memory");
+        }
+    }
+    if (house->room_count != snapshot->room_count || snapshot_layout_hash(house) != snapshot->layout_hash) {
+        house_cleanup(house);
+        return snapshot_error(error, error_size, "the snapshot was taken on another house layout (use the same --map or --generate)");
+    }
+
+    // house_init and house_add_hunter gave every entity the stream of (seed, run); keep those to reseed
+    atomic_store(&house->case_file.collected, snapshot->collected);
+    atomic_store(&house->case_file.solved, snapshot->solved);
+    for (int r = 0; r < house->room_count; r++) {
+        atomic_store(&house->rooms[r].evidence, snapshot->evidence[r]);
+    }
+
+    struct Ghost* g = house->ghost;
+    g->room->ghost = NULL;
+    g->type = (enum GhostType)snapshot->ghost.type;
+    g->room = &house->rooms[snapshot->ghost.room];
+    g->boredom = snapshot->ghost.boredom;
+    g->steps = snapshot->ghost.steps;
+    g->running = snapshot->ghost.running;
+    if (snapshot->ghost.present) {
+        g->room->ghost = g;
+    }
+    if (!reseed) {
+        g->rng = snapshot->ghost.rng;
+    }
+
+    const int32_t* trail = snapshot->trails;
+    for (int i = 0; i < snapshot->hunter_count; i++) {
+        const struct SnapshotHunter* hunter = &snapshot->hunters[i];
+        struct Hunter* h = house->hunters[i];
+        room_remove_hunter(h->room, h);
+        h->room = &house->rooms[hunter->room];
+        if (hunter->listed) {
+            room_add_hunter(h->room, h);
+        }
+        h->device = (enum EvidenceType)hunter->device;
+        h->fear = hunter->fear;
+        h->boredom = hunter->boredom;
+        h->steps = hunter->steps;
+        h->exit_reason = (enum LogReason)hunter->exit_reason;
+        h->running = hunter->running;
+        h->return_to_van = hunter->return_to_van;
+        if (!reseed) {
+            h->rng = hunter->rng;
+        }
+        for (int b = 0; b < hunter->trail_count; b++) {
+            stack_push(&h->path_stack, &house->rooms[*trail++]);
+        }
+    }
+    house->virtual_now = snapshot->virtual_now;
+    return 0;
+}
+
+int snapshot_write(const char* path, const struct HuntSnapshot* snapshot) {
+    int trail_total = 0;
+    for (int i = 0; i < snapshot->hunter_count; i++) {
+        trail_total += snapshot->hunters[i].trail_count;
+    }
+
+    struct SnapshotFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(struct SnapshotHunter);
+    header.seed = snapshot->seed;
+    header.run_id = snapshot->run_id;
+    header.room_count = snapshot->room_count;
+    header.layout_hash = snapshot->layout_hash;
+    header.virtual_now = snapshot->virtual_now;
+    header.hunter_count = snapshot->hunter_count;
+    header.trail_total = trail_total;
+    header.turn_count = snapshot->turn_count;
+    header.collected = snapshot->collected;
+    header.solved = snapshot->solved;
+    header.next_seq = snapshot->next_seq;
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        return -1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(snapshot->evidence, 1, snapshot->room_count, out) == (size_t)snapshot->room_count
+        && fwrite(&snapshot->ghost, sizeof(snapshot->ghost), 1, out) == 1
+        && fwrite(snapshot->hunters, sizeof(struct SnapshotHunter), snapshot->hunter_count, out) == (size_t)snapshot->hunter_count
+        && fwrite(snapshot->trails, sizeof(int32_t), trail_total, out) == (size_t)trail_total
+        && fwrite(snapshot->turns, sizeof(struct SnapshotTurn), snapshot->turn_count, out) == (size_t)snapshot->turn_count;
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    return ok ? 0 : -1;
+}
+
+int snapshot_read(const char* path, struct HuntSnapshot* snapshot, char* error, size_t error_size) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        return snapshot_error(error, error_size, "could not open %s", path);
+    }
+
+    struct SnapshotFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.record_size != sizeof(struct SnapshotHunter)) {
+        fclose(in);
+        return snapshot_error(error, error_size, "%s is not a version %d snapshot", path, SNAPSHOT_VERSION);
+    }
+    if (header.room_count < 1 || header.hunter_count < 1 || header.trail_total < 0 || header.turn_count < 0 ||
+        header.turn_count > header.hunter_count + 1) {
+        fclose(in);
+        return snapshot_error(error, error_size, "%s is damaged", path);
+    }
+
+    snapshot->seed = header.seed;
+    snapshot->run_id = header.run_id;
+    snapshot->room_count = header.room_count;
+    snapshot->layout_hash = header.layout_hash;
+    snapshot->virtual_now = header.virtual_now;
+    snapshot->collected = header.collected;
+    snapshot->solved = header.solved;
+    snapshot->hunter_count = header.hunter_count;
+    snapshot->turn_count = header.turn_count;
+    snapshot->next_seq = header.next_seq;
+    snapshot->evidence = malloc(header.room_count);
+    snapshot->hunters = malloc(sizeof(struct SnapshotHunter) * header.hunter_count);
+    snapshot->trails = malloc(sizeof(int32_t) * (header.trail_total + 1));
+    snapshot->turns = malloc(sizeof(struct SnapshotTurn) * (header.turn_count + 1));
+    bool ok = snapshot->evidence && snapshot->hunters && snapshot->trails && snapshot->turns
+        && fread(snapshot->evidence, 1, header.room_count, in) == (size_t)header.room_count
+        && fread(&snapshot->ghost, sizeof(snapshot->ghost), 1, in) == 1
+        && fread(snapshot->hunters, sizeof(struct SnapshotHunter), header.hunter_count, in) == (size_t)header.hunter_count
+        && fread(snapshot->trails, sizeof(int32_t), header.trail_total, in) == (size_t)header.trail_total
+        && fread(snapshot->turns, sizeof(struct SnapshotTurn), header.turn_count, in) == (size_t)header.turn_count;
+    fclose(in);
+    if (!ok) {
+        return snapshot_error(error, error_size, "%s is truncated", path);
+    }
+
+    // the ghost type and devices index the evidence tables, so they have to be real ones
+    if (snapshot->ghost.type < 0 || snapshot->ghost.type >= EVIDENCE_MASK_COUNT ||
+        !evidence_is_valid_ghost((EvidenceByte)snapshot->ghost.type)) {
+        return snapshot_error(error, error_size, "%s is damaged (unknown ghost type %d)", path, snapshot->ghost.type);
+    }
+
+    // every room index has to fit the layout, and the trails have to add up; a stream's
+    // available count indexes its buffer, so it has to be one rand_stream_next() could leave
+    int trail_total = 0;
+    bool valid = snapshot->ghost.room >= 0 && snapshot->ghost.room < header.room_count &&
+                 snapshot->ghost.rng.available >= 0 && snapshot->ghost.rng.available <= 4;
+    for (int i = 0; valid && i < header.hunter_count; i++) {
+        const struct SnapshotHunter* hunter = &snapshot->hunters[i];
+        snapshot->hunters[i].name[MAX_HUNTER_NAME - 1] = '\0';
+        valid = hunter->room >= 0 && hunter->room < header.room_count && hunter->trail_count >= 0 &&
+                hunter->exit_reason >= LR_EVIDENCE && hunter->exit_reason <= LR_AFRAID &&
+                hunter->device > 0 && hunter->device < EVIDENCE_MASK_COUNT && evidence_table[hunter->device].count == 1 &&
+                hunter->rng.available >= 0 && hunter->rng.available <= 4;
+        trail_total += hunter->trail_count;
+    }
+    valid = valid && trail_total == header.trail_total;
+    for (int i = 0; valid && i < header.trail_total; i++) {
+        valid = snapshot->trails[i] >= 0 && snapshot->trails[i] < header.room_count;
+    }
+    for (int i = 0; valid && i < header.turn_count; i++) {
+        valid = snapshot->turns[i].entity >= -1 && snapshot->turns[i].entity < header.hunter_count;
+    }
+    if (!valid) {
+        return snapshot_error(error, error_size, "%s is damaged", path);
+    }
+    return 0;
+}
+
+void snapshot_free(struct HuntSnapshot* snapshot) {
+    free(snapshot->evidence);
+    free(snapshot->hunters);
+    free(snapshot->trails);
+    free(snapshot->turns);
+    snapshot->evidence = NULL;
+    snapshot->hunters = NULL;
+    snapshot->trails = NULL;
+    snapshot->turns = NULL;
+}
+
+void snapshot_print(FILE* out, const struct HuntSnapshot* snapshot, const struct House* house) {
+    const struct EvidenceInfo* info = &evidence_table[snapshot->collected & (EVIDENCE_MASK_COUNT - 1)];
+    fprintf(out, "Snapshot of run %d (seed %llu) at %lld ms: case file %d/3",
+            snapshot->run_id, (unsigned long long)snapshot->seed, (long long)snapshot->virtual_now, info->count);
+    for (int bit = 0; bit < 8; bit++) {
+        if (snapshot->collected & (1 << bit)) {
+            fprintf(out, " %s", evidence_to_string((enum EvidenceType)(1 << bit)));
+        }
+    }
+    fprintf(out, "\n");
+
+    const struct SnapshotGhost* ghost = &snapshot->ghost;
+    fprintf(out, "  Ghost (%s): %s, boredom %d\n", ghost_to_string((enum GhostType)ghost->type),
+            ghost->present ? house->rooms[ghost->room].name : "left", ghost->boredom);
+    for (int i = 0; i < snapshot->hunter_count; i++) {
+        const struct SnapshotHunter* hunter = &snapshot->hunters[i];
+        fprintf(out, "  Hunter %d %-12s %-8s fear %2d boredom %2d  ", hunter->id, hunter->name,
+                evidence_to_string((enum EvidenceType)hunter->device), hunter->fear, hunter->boredom);
+        if (hunter->running) {
+            fprintf(out, "%s%s\n", house->rooms[hunter->room].name, hunter->return_to_van ? " (returning to the van)" : "");
+        } else {
+            fprintf(out, "left (%s)\n", exit_reason_to_string((enum LogReason)hunter->exit_reason));
+        }
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "defs.h"
+
+/*
+    Snapshots of a hunt in progress (--snapshot-at, --fork).
+
+    A snapshot holds everything the discrete-event engine needs to carry a hunt on: the room
+    evidence and case file, the ghost, every hunter with its breadcrumb trail, each entity's
+    random stream and the pending turns of the engine. Resuming a snapshot with its own
+    streams plays out exactly like the original hunt; forking gives every branch fresh
+    streams from (seed, branch), so a batch of branches estimates the odds from that moment
+    without simulating the hunt up to it again.
+
+    The layout is not stored, only a fingerprint of it: load a snapshot with the same --map
+    or --generate it was taken with. Snapshot files are written in the native byte order,
+    like the binary logs.
+*/
+
+#define SNAPSHOT_MAGIC "GHSN"
+#define SNAPSHOT_VERSION 1
+
+// When to take the snapshot; every condition that is set must hold
+struct SnapshotTrigger {
+    long long time;     // Virtual ms since the hunt started, -1 for any
+    int fear;           // Hunter fear, -1 for any
+    int hunters;        // Hunters in the house that need at least that fear
+    int evidence;       // Evidence types in the case file, -1 for any
+};
+
+// One pending turn of the discrete-event engine
+struct SnapshotTurn {
+    int64_t time;       // Virtual ms
+    int64_t seq;        // Tie breaker, in scheduling order
+    int32_t entity;     // Hunter index, -1 for the ghost
+    int32_t reserved;
+};
+
+struct SnapshotGhost {
+    int32_t id;
+    int32_t type;
+    int32_t room;
+    int32_t boredom;
+    int32_t steps;
+    uint8_t running;
+    uint8_t present;    // Still listed in its room (false once it left)
+    uint8_t reserved[2];
+    struct RandStream rng;
+};
+
+struct SnapshotHunter {
+    int32_t id;
+    char    name[MAX_HUNTER_NAME];
+    int32_t room;
+    int32_t device;
+    int32_t fear;
+    int32_t boredom;
+    int32_t steps;
+    int32_t exit_reason;
+    int32_t trail_count;    // Breadcrumbs, stored in HuntSnapshot.trails
+    uint8_t running;
+    uint8_t return_to_van;
+    uint8_t listed;         // On its room's list of hunters (hunters that left by evidence stay in the van's)
+    uint8_t reserved;
+    struct RandStream rng;
+};
+
+// A hunt paused between two turns
+struct HuntSnapshot {
+    uint64_t seed;          // Where it came from: run run_id of the sweep with this seed
+    int32_t run_id;
+    int32_t room_count;
+    uint64_t layout_hash;   // Fingerprint of the rooms and connections
+    int64_t virtual_now;
+    uint8_t collected;      // Case file
+    uint8_t solved;
+    EvidenceByte* evidence;         // Per room
+    struct SnapshotGhost ghost;
+    int32_t hunter_count;
+    struct SnapshotHunter* hunters;
+    int32_t* trails;                // Every hunter's breadcrumbs in turn, oldest first
+    int32_t turn_count;
+    int64_t next_seq;
+    struct SnapshotTurn* turns;
+};
+
+/**
+ * @brief Read a trigger spec such as "fear=4,hunters=2" or "time=150,evidence=1".
+ * @param[in] spec Comma separated key=value pairs: time, fear, hunters, evidence.
+ * @param[out] trigger Trigger to fill; keys not given match anything.
+ * @param[out] error Receives the reason when the spec is rejected.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 on an unknown key or a bad value.
+ */
+int snapshot_trigger_parse(const char* spec, struct SnapshotTrigger* trigger, char* error, size_t error_size);
+
+/**
+ * @brief Whether a hunt has reached the moment a trigger describes.
+ * @param[in] trigger The trigger.
+ * @param[in] house Hunt between two turns.
+ * @return true once every condition of the trigger holds.
+ */
+bool snapshot_trigger_hit(const struct SnapshotTrigger* trigger, const struct House* house);
+
+/**
+ * @brief Copy the state of a hunt between two turns.
+ * @param[in] house The hunt.
+ * @param[in] turns Pending turns of the engine.
+ * @param[in] turn_count Number of pending turns.
+ * @param[in] next_seq Sequence number the engine gives its next turn.
+ * @param[out] snapshot Snapshot to fill; release it with snapshot_free().
+ * @return 0 on success, -1 if out of memory.
+ */
+int snapshot_capture(const struct House* house, const struct SnapshotTurn* turns, int turn_count, long long next_seq,
+                     struct HuntSnapshot* snapshot);
+
+/**
+ * @brief Set up a house in the state of a snapshot, ready for house_resume_des().
+ * @param[in] snapshot The snapshot.
+ * @param[in] map Layout the snapshot was taken on, NULL for Willow House.
+ * @param[in] seed Master seed of the branch.
+ * @param[in] run Branch number; with reseed the streams come from (seed, run).
+ * @param[in] reseed Give every entity a fresh stream instead of the snapshot's.
+ * @param[out] house House to set up; clean it up with house_cleanup().
+ * @param[out] error Receives the reason on failure.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 if the layout does not match (the house is already cleaned up).
+ */
+int snapshot_restore(const struct HuntSnapshot* snapshot, const struct HouseMap* map, uint64_t seed, int run, bool reseed,
+                     struct House* house, char* error, size_t error_size);
+
+/**
+ * @brief Write a snapshot file.
+ * @param[in] path File to write.
+ * @param[in] snapshot The snapshot.
+ * @return 0 on success, -1 on error.
+ */
+int snapshot_write(const char* path, const struct HuntSnapshot* snapshot);
+
+/**
+ * @brief Read a snapshot file.
+ * @param[in] path File to read.
+ * @param[out] snapshot Snapshot to fill; release it with snapshot_free() even on failure.
+ * @param[out] error Receives the reason when the file is rejected.
+ * @param[in] error_size Size of the error buffer.
+ * @return 0 on success, -1 on error.
+ */
+int snapshot_read(const char* path, struct HuntSnapshot* snapshot, char* error, size_t error_size);
+
+/**
+ * @brief Release what a snapshot owns.
+ * @param[in,out] snapshot Snapshot filled by snapshot_capture() or snapshot_read().
+ */
+void snapshot_free(struct HuntSnapshot* snapshot);
+
+/**
+ * @brief Print where everyone is and what has been found.
+ * @param[in] out Stream to print to.
+ * @param[in] snapshot The snapshot.
+ * @param[in] house A house with the snapshot's layout, for the room names.
+ */
+void snapshot_print(FILE* out, const struct HuntSnapshot* snapshot, const struct House* house);
+
+/**
+ * @brief Run a hunt on the discrete-event engine until a trigger fires.
+ * @param[in,out] house House set up with hunters, as for house_run_des().
+ * @param[in] trigger When to stop.
+ * @param[out] snapshot Filled when the trigger fired; release it with snapshot_free().
+ * @return 1 if the trigger fired (the hunt is left unfinished), 0 if the hunt ended first, -1 on error.
+ */
+int house_run_des_until(struct House* house, const struct SnapshotTrigger* trigger, struct HuntSnapshot* snapshot);
+
+/**
+ * @brief Carry on a restored hunt on the discrete-event engine until it ends.
+ * @param[in,out] house House set up by snapshot_restore().
+ * @param[in] snapshot Snapshot it was restored from (for the pending turns).
+ * @return 0 once the hunt has ended, -1 if out of memory (the hunt did not run).
+ */
+int house_resume_des(struct House* house, const struct HuntSnapshot* snapshot);
+
+#endif // SNAPSHOT_H
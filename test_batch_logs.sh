@@ -0,0 +1,45 @@
+#!/bin/sh
+# Batch logging on a single worker (make test).
+#
+# One des or pool worker logs every hunter and ghost of every hunt it runs, so a batch like
+# this one writes far more than LOG_EVENT_CAP (helpers.c) events from one thread. The cap is
+# per log file: the batch has to finish, write every run and pass validate_logs.py.
+
+RUNS=3000
+ROOT=$(pwd)
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+status=0
+
+for engine in des pool; do
+    out="$DIR/$engine"
+    ./simulation --runs $RUNS --jobs 1 --engine $engine --seed 7 --log-format csv --log-dir "$out" \
+        > "$out.txt" 2> "$out.err"
+    code=$?
+    if [ $code -ne 0 ]; then
+        echo "FAIL $engine: exited with status $code"; cat "$out.err"; status=1; continue
+    fi
+
+    runs=$(ls "$out" | grep -c '^run_')
+    events=$(cat "$out"/run_*/log_*.csv | wc -l)
+    if [ "$runs" -ne $RUNS ]; then
+        echo "FAIL $engine: $runs of $RUNS run directories"; status=1; continue
+    fi
+    if [ "$events" -le 100000 ]; then
+        echo "FAIL $engine: only $events events, the test needs more than 100000 on one worker"; status=1; continue
+    fi
+    if grep -q capped "$out.err"; then
+        echo "FAIL $engine: a log was capped"; cat "$out.err"; status=1; continue
+    fi
+
+    # a few hunts from across the batch, checked on their own
+    for run in 0 1499 2999; do
+        report=$(cd "$out/run_$run" && python3 "$ROOT/validate_logs.py")
+        if echo "$report" | grep -E '(issues|mismatches|initialisation entries): [1-9]' > /dev/null; then
+            echo "FAIL $engine: run $run does not validate"; echo "$report"; status=1
+        fi
+    done
+    [ $status -eq 0 ] && echo "ok   $engine: $RUNS runs, $events events on one worker"
+done
+
+exit $status
@@ -6,45 +6,68 @@
 // stack functions
 
 /**
- * @brief Pushes a room onto a linked list stack
+ * @brief Sets up an empty breadcrumb stack
  *
- * @param head Double pointer to the head of the stack
+ * @param stack Pointer to the PathStack
+ * @param capacity Rooms to make space for up front (the room count of the house is a good guess)
+ */
+void stack_init(struct PathStack* stack, int capacity) {
+    stack->rooms = capacity > 0 ? malloc(sizeof(int) * capacity) : NULL;
+    stack->count = 0;
+    stack->capacity = stack->rooms ? capacity : 0;
+}
+
+/**
+ * @brief Pushes a room onto the stack, growing the array only when it is full
+ *
+ * @param stack Pointer to the PathStack
  * @param room Pointer to the Room to push onto the stack
  */
-void stack_push(struct RoomNode** head, struct Room* room) {
-    struct RoomNode* new_node = malloc(sizeof(struct RoomNode));
-    if (new_node) {
-        new_node->room = room;
-        new_node->next = *head;
-        *head = new_node;
+void stack_push(struct PathStack* stack, struct Room* room) {
+    if (stack->count == stack->capacity) {
+        int capacity = stack->capacity ? stack->capacity * 2 : 16;
+        int* rooms = realloc(stack->rooms, sizeof(int) * capacity);
+        if (!rooms) {
+            return;
+        }
+        stack->rooms = rooms;
+        stack->capacity = capacity;
     }
+    stack->rooms[stack->count++] = room->id;
 }
 
 /**
- * @brief Pops a room from the front of the linked list stack
+ * @brief Pops the most recently pushed room
  *
- * @param head Double pointer to the head of the stack
+ * @param stack Pointer to the PathStack
+ * @param house Pointer to the House the rooms belong to
  * @return Pointer to the Room popped from the stack/NULL (if empty)
  */
-struct Room* stack_pop(struct RoomNode** head) {
-    if (*head == NULL) return NULL;
-    
-    struct RoomNode* temp = *head;
-    struct Room* room = temp->room;
-    *head = temp->next;
-    free(temp);
-    return room;
+struct Room* stack_pop(struct PathStack* stack, struct House* house) {
+    if (stack->count == 0) return NULL;
+
+    return &house->rooms[stack->rooms[--stack->count]];
 }
 
 /**
- * @brief Itererates through and frees all nodes in the linked list stack
+ * @brief Empties the stack in O(1), keeping the array for the next trip
  *
- * @param head Double pointer to the head of the stack
+ * @param stack Pointer to the PathStack
  */
-void stack_clean(struct RoomNode** head) {
-    while (*head != NULL) {
-        stack_pop(head);
-    }
+void stack_clear(struct PathStack* stack) {
+    stack->count = 0;
+}
+
+/**
+ * @brief Frees the array of the stack
+ *
+ * @param stack Pointer to the PathStack
+ */
+void stack_free(struct PathStack* stack) {
+    free(stack->rooms);
+    stack->rooms = NULL;
+    stack->count = 0;
+    stack->capacity = 0;
 }
 
 // evidence helper functions
@@ -56,11 +79,6 @@ void stack_clean(struct RoomNode** head) {
  * @return True if 3 or more bits are set, false otherwise
  */
 bool evidence_has_three_unique(EvidenceByte mask) {
-    int count = 0;
-    for (int i = 0; i < 8; i++) {
-        if ((mask >> i) & 1) {
-            count++;
-        }
-    }
-    return count >= 3;
+    // the eighth bit is never evidence, so the 128 entry table covers every mask
+    return evidence_table[mask & (EVIDENCE_MASK_COUNT - 1)].count >= 3;
 }
\ No newline at end of file
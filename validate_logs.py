@@ -9,6 +9,12 @@ Usage:
 Command Line Arguments:
 - --limit <number> limits the number of logs that it looks at for quick tests
 - --export <filename> exports a combined log, sorted by timestamp
+- --map <filename> checks movement against a map file (see maps/willow.map) instead of Willow House
+
+The log files are merged as a stream (each file is already in timestamp order), and events are
+checked one timestamp at a time, so memory stays flat however long the logs are. Logs written
+with --log-order end every line in the event's seq and mono_ns; when every file has them the
+merge follows seq instead, which is the exact order the events happened in.
 
 Note: This code might be updated throughout the project to modify or add additional verifications.
 """
@@ -18,9 +24,12 @@ from __future__ import annotations
 import argparse
 import csv
 import glob
+import heapq
+import itertools
+import os
 from collections import defaultdict
 from dataclasses import dataclass, field
-from typing import Dict, List, Optional, Set, Tuple
+from typing import Callable, Dict, Iterable, Iterator, List, Optional, Set, Tuple
 
 
 # Willow house layout
@@ -41,6 +50,31 @@ WILLOW_ROOMS: Dict[str, List[str]] = {
 }
 
 
+def load_map(path: str) -> Dict[str, List[str]]:
+    """Read a map file in the simulation's format (room/exit/edge lines) into an adjacency dict."""
+    layout: Dict[str, List[str]] = {}
+    with open(path, encoding="utf-8") as handle:
+        for number, raw in enumerate(handle, start=1):
+            text = raw.strip()
+            if not text or text.startswith("#"):
+                continue
+            keyword, _, argument = text.partition(" ")
+            argument = argument.strip()
+            if keyword in ("room", "exit"):
+                if not argument or argument in layout:
+                    raise ValueError(f"{path}:{number}: bad or duplicate room {argument!r}")
+                layout[argument] = []
+            elif keyword == "edge":
+                a, separator, b = argument.partition(" -- ")
+                if not separator or a not in layout or b not in layout or a == b:
+                    raise ValueError(f"{path}:{number}: bad edge {argument!r}")
+                layout[a].append(b)
+                layout[b].append(a)
+            else:
+                raise ValueError(f"{path}:{number}: unknown statement {keyword!r}")
+    return layout
+
+
 @dataclass
 class LogEntry:
     timestamp: int
@@ -54,6 +88,8 @@ class LogEntry:
     extra: str
     source: str
     line: int
+    sequence: Optional[int] = None
+    monotonic_ns: Optional[int] = None
     issues: Set[str] = field(default_factory=set)
 
     def to_row(self, include_issues: bool = False) -> List[str]:
@@ -122,57 +158,94 @@ def compute_pending_evidence(entries: List[LogEntry]) -> Dict[Tuple[int, str, st
     return pending
 
 
-def parse_logs(limit: Optional[int] = None) -> List[LogEntry]:
-    entries: List[LogEntry] = []
+# Files up to this size are parsed whole and closed at once. A hunt with thousands of hunters
+# has thousands of short logs, and an open file and its reader cost more than their entries.
+SMALL_LOG_BYTES = 64 * 1024
+
+
+def read_log_file(path: str) -> Iterator[LogEntry]:
+    """Iterate over the entries of one log file in file order (which is timestamp order)."""
+    if os.path.getsize(path) <= SMALL_LOG_BYTES:
+        with open(path, "r", encoding="utf-8", newline="") as handle:
+            return iter(list(read_log_rows(path, handle)))
+    return stream_log_file(path)
+
+
+def stream_log_file(path: str) -> Iterator[LogEntry]:
+    """Yield the entries of a long log file, keeping it open until they are used up."""
+    with open(path, "r", encoding="utf-8", newline="") as handle:
+        yield from read_log_rows(path, handle)
+
+
+def read_log_rows(path: str, lines: Iterable[str]) -> Iterator[LogEntry]:
+    """Turn the CSV lines of one log file into entries."""
     try:
-        for path in sorted(glob.glob("log_*.csv")):
-            with open(path, "r", encoding="utf-8", newline="") as handle:
-                reader = csv.reader(handle)
-                for line_number, row in enumerate(reader, start=1):
-                    if not row:
-                        continue
-
-                    timestamp = int(row[0])
-                    entity_type = row[1].strip()
-                    entity_id = int(row[2])
-                    room = row[3].strip()
-                    device = row[4].strip()
-                    boredom = int(row[5])
-                    fear = int(row[6])
-                    action = row[7].strip()
-                    extra = row[8].strip()
-
-                    entries.append(
-                        LogEntry(
-                            timestamp=timestamp,
-                            entity_type=entity_type,
-                            entity_id=entity_id,
-                            room=room,
-                            device=device,
-                            boredom=boredom,
-                            fear=fear,
-                            action=action,
-                            extra=extra,
-                            source=path,
-                            line=line_number,
-                        )
-                    )
+        for line_number, row in enumerate(csv.reader(lines), start=1):
+            if not row:
+                continue
+
+            yield LogEntry(
+                timestamp=int(row[0]),
+                entity_type=row[1].strip(),
+                entity_id=int(row[2]),
+                room=row[3].strip(),
+                device=row[4].strip(),
+                boredom=int(row[5]),
+                fear=int(row[6]),
+                action=row[7].strip(),
+                extra=row[8].strip(),
+                source=path,
+                line=line_number,
+                sequence=int(row[9]) if len(row) > 10 else None,
+                monotonic_ns=int(row[10]) if len(row) > 10 else None,
+            )
     except Exception:
         print("Something was wrong while parsing.")
         raise
 
-    entries.sort(key=lambda entry: entry.timestamp)
+
+def has_order_columns(path: str) -> bool:
+    """Whether the first line of a log file carries the seq and mono_ns columns."""
+    with open(path, "r", encoding="utf-8", newline="") as handle:
+        row = next(csv.reader(handle), None)
+    return row is None or len(row) > 10
+
+
+def parse_logs(limit: Optional[int] = None) -> Iterator[LogEntry]:
+    """Stream every log_*.csv merged by seq, or by timestamp when some file has no seq column.
+
+    The merge is a heap over the files, one entry each. Timestamp ties keep the order a stable
+    sort would give: file name order, then line order.
+    """
+    paths = sorted(glob.glob("log_*.csv"))
+    if paths and all(has_order_columns(path) for path in paths):
+        key: Callable[[LogEntry], int] = lambda entry: entry.sequence
+    else:
+        key = lambda entry: entry.timestamp
+    entries = heapq.merge(*(read_log_file(path) for path in paths), key=key)
     if limit is not None:
-        entries = entries[:limit]
+        entries = itertools.islice(entries, limit)
     return entries
 
 
+def group_by_timestamp(entries: Iterable[LogEntry]) -> Iterator[List[LogEntry]]:
+    """Yield runs of entries that share a timestamp: the lookahead the same-timestamp checks need."""
+    for _, group in itertools.groupby(entries, key=lambda entry: entry.timestamp):
+        yield list(group)
+
+
 def simulate(
-    entries: List[LogEntry],
-    change_timestamps: Set[int],
-    pending_evidence: Dict[Tuple[int, str, str], int],
+    entries: Iterable[LogEntry],
+    layout: Dict[str, List[str]] = WILLOW_ROOMS,
+    on_group: Optional[Callable[[List[LogEntry]], None]] = None,
 ) -> (Dict[str, int], Dict[str, List[str]]):
-    rooms = {name: RoomState(name=name, neighbors=neighbors) for name, neighbors in WILLOW_ROOMS.items()}
+    """Replay the entries (in timestamp order) in a single pass and count the issues.
+
+    Entries are taken one timestamp at a time; on_group is called with each group once its
+    checks are done (its entries' issues are final).
+    """
+    rooms = {name: RoomState(name=name, neighbors=neighbors) for name, neighbors in layout.items()}
+    start_room = next(iter(layout))  # the first room listed is the van
     hunters: Dict[int, HunterState] = {}
     ghosts: Dict[int, GhostState] = {}
 
@@ -185,221 +258,215 @@ def simulate(
             samples[issue].append(f"{entry.timestamp} | {detail}")
         entry.issues.add(issue)
 
-    for index, entry in enumerate(entries):
-        if entry.entity_type == "hunter":
-            state = hunters.get(entry.entity_id)
-
-            if entry.action == "INIT":
-                state = HunterState(
-                    hunter_id=entry.entity_id,
-                    name=entry.extra,
-                    room=entry.room,
-                    device=entry.device,
-                    boredom=entry.boredom,
-                    fear=entry.fear,
-                    returning=False,
-                )
-                hunters[entry.entity_id] = state
-                if entry.room in rooms:
-                    rooms[entry.room].hunters.add(entry.entity_id)
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} unknown room '{entry.room}' during INIT")
-                continue
+    entry_count = 0
+    for group in group_by_timestamp(entries):
+        # events at the same timestamp may be logged in either order, so look at the whole group
+        change_timestamps = compute_room_change_timestamps(group)
+        pending_evidence = compute_pending_evidence(group)
+        entry_count += len(group)
+
+        for entry in group:
+            if entry.entity_type == "hunter":
+                state = hunters.get(entry.entity_id)
+
+                if entry.action == "INIT":
+                    state = HunterState(
+                        hunter_id=entry.entity_id,
+                        name=entry.extra,
+                        room=entry.room,
+                        device=entry.device,
+                        boredom=entry.boredom,
+                        fear=entry.fear,
+                        returning=False,
+                    )
+                    hunters[entry.entity_id] = state
+                    if entry.room in rooms:
+                        rooms[entry.room].hunters.add(entry.entity_id)
+                    else:
+                        report("movement", entry, f"{entry.source}:{entry.line} unknown room '{entry.room}' during INIT")
+                    continue
 
-            if state is None:
-                report("missing_init", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} seen before INIT")
-                continue
+                if state is None:
+                    report("missing_init", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} seen before INIT")
+                    continue
+
+                state.boredom = entry.boredom
+                state.fear = entry.fear
 
-            state.boredom = entry.boredom
-            state.fear = entry.fear
+                if entry.action == "MOVE":
+                    from_room = entry.room
+                    to_room = entry.extra
 
-            if entry.action == "MOVE":
-                from_room = entry.room
-                to_room = entry.extra
+                    if state.room != from_room:
+                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected in {state.room}, log shows {from_room}")
 
-                if state.room != from_room:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected in {state.room}, log shows {from_room}")
+                    if from_room not in rooms or to_room not in rooms:
+                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} unknown room in move {from_room}->{to_room}")
+                    else:
+                        if to_room not in rooms[from_room].neighbors:
+                            report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} invalid edge {from_room}->{to_room}")
 
-                if from_room not in rooms or to_room not in rooms:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} unknown room in move {from_room}->{to_room}")
-                else:
-                    if to_room not in rooms[from_room].neighbors:
-                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} invalid edge {from_room}->{to_room}")
+                        if entry.entity_id in rooms[from_room].hunters:
+                            rooms[from_room].hunters.remove(entry.entity_id)
+                        else:
+                            report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} not recorded in {from_room} before move")
 
-                    if entry.entity_id in rooms[from_room].hunters:
-                        rooms[from_room].hunters.remove(entry.entity_id)
+                        rooms[to_room].hunters.add(entry.entity_id)
+
+                    if state.returning:
+                        if state.return_stack:
+                            expected = state.return_stack.pop()
+                            if expected != to_room:
+                                report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected {expected} on return, got {to_room}")
+                        else:
+                            if to_room != start_room:
+                                report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack empty but moved to {to_room}")
                     else:
-                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} not recorded in {from_room} before move")
+                        if from_room:
+                            state.return_stack.append(from_room)
 
-                    rooms[to_room].hunters.add(entry.entity_id)
+                    state.room = to_room
+                    if to_room == start_room:
+                        state.return_stack.clear()
 
-                if state.returning:
-                    if state.return_stack:
-                        expected = state.return_stack.pop()
-                        if expected != to_room:
-                            report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} expected {expected} on return, got {to_room}")
+                elif entry.action == "EVIDENCE":
+                    room = entry.room
+                    device = entry.device
+
+                    if device and device != state.device:
+                        report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} logged device {device} but state has {state.device}")
+
+                    if room != start_room:
+                        state.returning = True
+
+                    if room in rooms:
+                        if rooms[room].evidence[device] > 0:
+                            rooms[room].evidence[device] -= 1
+                        else:
+                            key = (entry.timestamp, room, device)
+                            if pending_evidence.get(key, 0) > 0:
+                                pending_evidence[key] -= 1
+                            else:
+                                report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} collected {device} but room missing evidence")
                     else:
-                        if to_room != "Van":
-                            report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack empty but moved to {to_room}")
-                else:
-                    if from_room:
-                        state.return_stack.append(from_room)
-
-                state.room = to_room
-                if to_room == "Van":
-                    state.return_stack.clear()
+                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} evidence in unknown room {room}")
 
-            elif entry.action == "EVIDENCE":
-                room = entry.room
-                device = entry.device
+                elif entry.action == "SWAP":
+                    if "->" in entry.extra:
+                        _, to_device = entry.extra.split("->", 1)
+                        state.device = to_device.strip()
 
-                if device and device != state.device:
-                    report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} logged device {device} but state has {state.device}")
+                elif entry.action == "RETURN_START":
+                    if state.room != start_room:
+                        state.returning = True
 
-                if room != "Van":
-                    state.returning = True
+                elif entry.action == "RETURN_COMPLETE":
+                    if state.room != start_room:
+                        report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} completed return outside van in {state.room}")
+                    if state.return_stack:
+                        report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack not empty on completion")
+                    state.return_stack.clear()
+                    state.returning = False
 
-                if room in rooms:
-                    if rooms[room].evidence[device] > 0:
-                        rooms[room].evidence[device] -= 1
+                elif entry.action == "EXIT":
+                    room = entry.room
+                    if room in rooms and entry.entity_id in rooms[room].hunters:
+                        rooms[room].hunters.remove(entry.entity_id)
                     else:
-                        key = (entry.timestamp, room, device)
-                        if pending_evidence.get(key, 0) > 0:
-                            pending_evidence[key] -= 1
-                        else:
-                            report("evidence", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} collected {device} but room missing evidence")
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} evidence in unknown room {room}")
-
-            elif entry.action == "SWAP":
-                if "->" in entry.extra:
-                    _, to_device = entry.extra.split("->", 1)
-                    state.device = to_device.strip()
-
-            elif entry.action == "RETURN_START":
-                if state.room != "Van":
-                    state.returning = True
-
-            elif entry.action == "RETURN_COMPLETE":
-                if state.room != "Van":
-                    report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} completed return outside van in {state.room}")
-                if state.return_stack:
-                    report("return", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} return stack not empty on completion")
-                state.return_stack.clear()
-                state.returning = False
-
-            elif entry.action == "EXIT":
-                room = entry.room
-                if room in rooms and entry.entity_id in rooms[room].hunters:
-                    rooms[room].hunters.remove(entry.entity_id)
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} exit from room without occupancy ({room})")
-                state.room = None
-                state.return_stack.clear()
-                state.returning = False
-
-            # Boredom reset check
-            ghost_state = next(iter(ghosts.values()), None)
-            if (
-                ghost_state
-                and ghost_state.room
-                and state.room == ghost_state.room
-                and state.boredom != 0
-                and entry.timestamp not in change_timestamps
-            ):
-                report("boredom", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} boredom {state.boredom} with ghost in {state.room}")
-
-        elif entry.entity_type == "ghost":
-            state = ghosts.get(entry.entity_id)
-
-            if entry.action == "INIT":
-                state = GhostState(
-                    ghost_id=entry.entity_id,
-                    ghost_type=entry.extra,
-                    room=entry.room,
-                    boredom=entry.boredom,
-                )
-                ghosts[entry.entity_id] = state
-                if entry.room in rooms:
-                    rooms[entry.room].ghost_present = True
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} init unknown room {entry.room}")
-                continue
+                        report("movement", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} exit from room without occupancy ({room})")
+                    state.room = None
+                    state.return_stack.clear()
+                    state.returning = False
+
+                # Boredom reset check
+                ghost_state = next(iter(ghosts.values()), None)
+                if (
+                    ghost_state
+                    and ghost_state.room
+                    and state.room == ghost_state.room
+                    and state.boredom != 0
+                    and entry.timestamp not in change_timestamps
+                ):
+                    report("boredom", entry, f"{entry.source}:{entry.line} hunter {entry.entity_id} boredom {state.boredom} with ghost in {state.room}")
+
+            elif entry.entity_type == "ghost":
+                state = ghosts.get(entry.entity_id)
+
+                if entry.action == "INIT":
+                    state = GhostState(
+                        ghost_id=entry.entity_id,
+                        ghost_type=entry.extra,
+                        room=entry.room,
+                        boredom=entry.boredom,
+                    )
+                    ghosts[entry.entity_id] = state
+                    if entry.room in rooms:
+                        rooms[entry.room].ghost_present = True
+                    else:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} init unknown room {entry.room}")
+                    continue
 
-            if state is None:
-                report("missing_init", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} seen before INIT")
-                continue
+                if state is None:
+                    report("missing_init", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} seen before INIT")
+                    continue
+
+                state.boredom = entry.boredom
 
-            state.boredom = entry.boredom
+                if entry.action == "MOVE":
+                    from_room = entry.room
+                    to_room = entry.extra
 
-            if entry.action == "MOVE":
-                from_room = entry.room
-                to_room = entry.extra
+                    if state.room != from_room:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} expected in {state.room}, log shows {from_room}")
 
-                if state.room != from_room:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} expected in {state.room}, log shows {from_room}")
+                    if from_room in rooms:
+                        rooms[from_room].ghost_present = False
+                    else:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} left unknown room {from_room}")
 
-                if from_room in rooms:
-                    rooms[from_room].ghost_present = False
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} left unknown room {from_room}")
+                    if to_room in rooms:
+                        rooms[to_room].ghost_present = True
+                    else:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} entered unknown room {to_room}")
 
-                if to_room in rooms:
-                    rooms[to_room].ghost_present = True
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} entered unknown room {to_room}")
+                    if from_room not in rooms or to_room not in rooms or to_room not in rooms[from_room].neighbors:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} invalid edge {from_room}->{to_room}")
 
-                if from_room not in rooms or to_room not in rooms or to_room not in rooms[from_room].neighbors:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} invalid edge {from_room}->{to_room}")
+                    state.room = to_room
 
-                state.room = to_room
+                elif entry.action == "EVIDENCE":
+                    room = entry.room
+                    device = entry.extra
+                    if room in rooms:
+                        rooms[room].evidence[device] += 1
+                        key = (entry.timestamp, room, device)
+                        if pending_evidence.get(key, 0) > 0:
+                            pending_evidence[key] -= 1
+                    else:
+                        report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} dropped evidence in unknown room {room}")
 
-            elif entry.action == "EVIDENCE":
-                room = entry.room
-                device = entry.extra
-                if room in rooms:
-                    rooms[room].evidence[device] += 1
-                    key = (entry.timestamp, room, device)
-                    if pending_evidence.get(key, 0) > 0:
-                        pending_evidence[key] -= 1
-                else:
-                    report("movement", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} dropped evidence in unknown room {room}")
+                elif entry.action == "EXIT":
+                    room = entry.room
+                    if room in rooms:
+                        rooms[room].ghost_present = False
+                    state.room = None
 
-            elif entry.action == "EXIT":
-                room = entry.room
-                if room in rooms:
-                    rooms[room].ghost_present = False
-                state.room = None
+                if state.room and state.room in rooms:
+                    hunters_here = rooms[state.room].hunters
+                    if hunters_here and state.boredom != 0 and entry.timestamp not in change_timestamps:
+                        report("boredom", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} boredom {state.boredom} with hunters in {state.room}")
 
-            if state.room and state.room in rooms:
-                hunters_here = rooms[state.room].hunters
-                if hunters_here and state.boredom != 0 and entry.timestamp not in change_timestamps:
-                    report("boredom", entry, f"{entry.source}:{entry.line} ghost {entry.entity_id} boredom {state.boredom} with hunters in {state.room}")
+            else:
+                report("unknown_entity", entry, f"{entry.source}:{entry.line} unknown entity type '{entry.entity_type}'")
 
-        else:
-            report("unknown_entity", entry, f"{entry.source}:{entry.line} unknown entity type '{entry.entity_type}'")
+        if on_group:
+            on_group(group)
 
-    stats["entries"] = len(entries)
+    stats["entries"] = entry_count
     return stats, samples
 
 
-def export_entries(entries: List[LogEntry], path: str) -> None:
-    with open(path, "w", encoding="utf-8", newline="") as handle:
-        writer = csv.writer(handle)
-        writer.writerow([
-            "timestamp",
-            "entity_type",
-            "entity_id",
-            "room",
-            "device",
-            "boredom",
-            "fear",
-            "action",
-            "extra",
-            "issues",
-        ])
-        for entry in entries:
-            writer.writerow(entry.to_row(include_issues=True))
+EXPORT_HEADER = ["timestamp", "entity_type", "entity_id", "room", "device", "boredom", "fear", "action", "extra", "issues"]
 
 
 def main() -> None:
@@ -408,7 +475,7 @@ def main() -> None:
         "--limit",
         type=int,
         default=None,
-        help="Process at most this many log entries (after sorting).",
+        help="Process at most this many log entries (in timestamp order).",
     )
     parser.add_argument(
         "--export",
@@ -416,13 +483,29 @@ def main() -> None:
         default=None,
         help="Optional output CSV path containing the combined, ordered logs.",
     )
+    parser.add_argument(
+        "--map",
+        type=str,
+        default=None,
+        help="Map file the hunt was run with (default: the built-in Willow House layout).",
+    )
 
     args = parser.parse_args()
+    layout = load_map(args.map) if args.map else WILLOW_ROOMS
 
     entries = parse_logs(limit=args.limit)
-    change_timestamps = compute_room_change_timestamps(entries)
-    pending_evidence = compute_pending_evidence(entries)
-    stats, samples = simulate(entries, change_timestamps, pending_evidence)
+    if args.export:
+        # the combined timeline is written as the groups are checked, never held in memory
+        with open(args.export, "w", encoding="utf-8", newline="") as handle:
+            writer = csv.writer(handle)
+            writer.writerow(EXPORT_HEADER)
+
+            def export_group(group: List[LogEntry]) -> None:
+                writer.writerows(entry.to_row(include_issues=True) for entry in group)
+
+            stats, samples = simulate(entries, layout, on_group=export_group)
+    else:
+        stats, samples = simulate(entries, layout)
 
     print(f"Processed entries: {stats['entries']}")
     print(f"Movement issues: {stats['movement']}")
@@ -451,7 +534,6 @@ def main() -> None:
             print(f"  - {sample}")
 
     if args.export:
-        export_entries(entries, args.export)
         print(f"Combined timeline exported to {args.export}")
 
 